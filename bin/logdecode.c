@@ -0,0 +1,346 @@
+/*****************************************************************************
+ * logdecode.c: VLC binary log decoder
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Converts logs written by the binary logger module back to text.
+ * See modules/logger/binary.c for a description of the format.
+ *
+ * The binary logger test (BINARY_TEST) includes this file for Decode().
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BINARY_MAGIC "VLCBLOG"
+#define BINARY_VERSION 1
+#define BINARY_HEADER 0xFF
+
+static const char msg_type[4][9] = { "", " error", " warning", " debug" };
+
+struct string
+{
+    const char *str;
+    size_t len;
+};
+
+struct session
+{
+    uint64_t freq;
+    uint64_t ts; /* relative to the session start */
+    bool valid;
+
+    char **strings;
+    size_t count;
+    size_t size;
+};
+
+struct reader
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    bool error;
+};
+
+static uint64_t GetVarint(struct reader *r)
+{
+    uint64_t value = 0;
+
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        if (r->p >= r->end)
+            break;
+
+        unsigned char byte = *(r->p++);
+
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    r->error = true;
+    return 0;
+}
+
+static void SessionReset(struct session *s)
+{
+    for (size_t i = 0; i < s->count; i++)
+        free(s->strings[i]);
+    s->count = 0;
+    s->ts = 0;
+    s->valid = false;
+}
+
+static struct string GetString(struct reader *r, struct session *s)
+{
+    struct string ret = { "", 0 };
+    uint64_t v = GetVarint(r);
+
+    if (r->error)
+        return ret;
+
+    if ((v & 3) == 1)
+    {
+        if ((v >> 2) >= s->count)
+        {
+            r->error = true;
+            return ret;
+        }
+        ret.str = s->strings[v >> 2];
+        ret.len = strlen(ret.str);
+        return ret;
+    }
+
+    uint64_t len = v >> 2;
+    if ((v & 3) > 2 || len > (uint64_t)(r->end - r->p))
+    {
+        r->error = true;
+        return ret;
+    }
+
+    ret.str = (const char *)r->p;
+    ret.len = len;
+    r->p += len;
+
+    if ((v & 3) == 2)
+    {
+        if (s->count == s->size)
+        {
+            size_t size = s->size ? 2 * s->size : 64;
+            char **tab = realloc(s->strings, size * sizeof (*tab));
+
+            if (tab == NULL)
+            {
+                r->error = true;
+                return ret;
+            }
+            s->strings = tab;
+            s->size = size;
+        }
+
+        char *dup = malloc(len + 1);
+        if (dup == NULL)
+        {
+            r->error = true;
+            return ret;
+        }
+        memcpy(dup, ret.str, len);
+        dup[len] = '\0';
+        s->strings[s->count++] = dup;
+    }
+    return ret;
+}
+
+static int DecodeHeader(struct reader *r, struct session *s, FILE *out)
+{
+    size_t magic_len = strlen(BINARY_MAGIC);
+
+    if ((size_t)(r->end - r->p) < magic_len + 1
+     || memcmp(r->p, BINARY_MAGIC, magic_len))
+        return -1;
+    r->p += magic_len;
+
+    if (*(r->p++) != BINARY_VERSION)
+        return -1;
+
+    SessionReset(s);
+    s->freq = GetVarint(r);
+    (void) GetVarint(r); /* session start tick */
+    if (r->error || s->freq == 0)
+        return -1;
+
+    s->valid = true;
+    fputs("-- session started --\n", out);
+    return 0;
+}
+
+static int DecodeMessage(struct reader *r, struct session *s, int type,
+                         FILE *out, bool verbose)
+{
+    if (!s->valid || type < 0 || type > 3)
+        return -1;
+
+    s->ts += GetVarint(r);
+
+    uint64_t tid = GetVarint(r);
+    uint64_t id = GetVarint(r);
+    struct string objtype = GetString(r, s);
+    struct string module = GetString(r, s);
+    struct string header = GetString(r, s);
+    struct string file = GetString(r, s);
+    uint64_t line = GetVarint(r);
+    struct string func = GetString(r, s);
+
+    if (r->error)
+        return -1;
+
+    uint64_t sec = s->ts / s->freq;
+    uint64_t usec = (s->ts % s->freq) * 1000000 / s->freq;
+
+    fprintf(out, "%"PRIu64".%06"PRIu64" [%016"PRIx64"] [%"PRIu64"] ", sec,
+            usec, id, tid);
+    if (header.len > 0)
+        fprintf(out, "[%.*s] ", (int)header.len, header.str);
+    fprintf(out, "%.*s %.*s%s: %.*s", (int)module.len, module.str,
+            (int)objtype.len, objtype.str, msg_type[type],
+            (int)(r->end - r->p), (const char *)r->p);
+    if (verbose && file.len > 0)
+    {
+        fprintf(out, " (%.*s", (int)file.len, file.str);
+        if (line > 0)
+            fprintf(out, ":%"PRIu64, line - 1);
+        if (func.len > 0)
+            fprintf(out, " in %.*s()", (int)func.len, func.str);
+        fputc(')', out);
+    }
+    fputc('\n', out);
+    return 0;
+}
+
+static int Decode(FILE *stream, FILE *out, bool verbose)
+{
+    struct session session = { .strings = NULL, .count = 0, .size = 0 };
+    unsigned char *buf = NULL;
+    size_t size = 0;
+    int ret = 0;
+
+    for (;;)
+    {
+        unsigned char hdr[4];
+        size_t len = fread(hdr, 1, sizeof (hdr), stream);
+
+        if (len == 0)
+            break;
+        if (len < sizeof (hdr))
+        {
+            fputs("Truncated record\n", stderr);
+            ret = -1;
+            break;
+        }
+
+        len = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16)
+            | ((uint32_t)hdr[3] << 24);
+        if (len == 0)
+        {
+            fputs("Empty record\n", stderr);
+            ret = -1;
+            break;
+        }
+
+        if (len > size)
+        {
+            unsigned char *p = realloc(buf, len);
+            if (p == NULL)
+            {
+                perror("realloc");
+                ret = -1;
+                break;
+            }
+            buf = p;
+            size = len;
+        }
+
+        if (fread(buf, 1, len, stream) < len)
+        {
+            fputs("Truncated record\n", stderr);
+            ret = -1;
+            break;
+        }
+
+        struct reader r = { buf + 1, buf + len, false };
+        int val;
+
+        if (buf[0] == BINARY_HEADER)
+            val = DecodeHeader(&r, &session, out);
+        else
+            val = DecodeMessage(&r, &session, buf[0], out, verbose);
+
+        if (val)
+        {
+            fputs("Invalid record\n", stderr);
+            ret = -1;
+            break;
+        }
+    }
+
+    SessionReset(&session);
+    free(session.strings);
+    free(buf);
+    return ret;
+}
+
+#ifndef BINARY_TEST
+static void usage(const char *path)
+{
+    printf(
+"Usage: %s [-v] [file]\n"
+"Convert a VLC binary log to text. If no file is specified, the log is read\n"
+"from the standard input.\n"
+"  -v  include the source code location of each message\n", path);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-v"))
+            verbose = true;
+        else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help"))
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (path == NULL)
+            path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *stream = stdin;
+
+    if (path != NULL && strcmp(path, "-"))
+    {
+        stream = fopen(path, "rb");
+        if (stream == NULL)
+        {
+            perror(path);
+            return 1;
+        }
+    }
+
+    int ret = Decode(stream, stdout, verbose);
+
+    if (stream != stdin)
+        fclose(stream);
+    return ret ? 1 : 0;
+}
+#endif /* !BINARY_TEST */
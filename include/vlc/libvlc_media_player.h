@@ -500,6 +500,34 @@ void libvlc_video_set_format_callbacks( libvlc_media_player_t *mp,
                                         libvlc_video_format_cb setup,
                                         libvlc_video_cleanup_cb cleanup );
 
+/**
+ * Render video directly into a fixed set of application buffers.
+ * This only works in combination with libvlc_video_set_callbacks().
+ *
+ * When the video output starts, the lock callback is invoked count times in a
+ * row: each call must return a distinct picture buffer, which then remains
+ * in use by LibVLC until the video output stops (and the cleanup callback,
+ * if any, is invoked). Video format converters and filters render into
+ * those buffers directly, so that pictures are handed over to the display
+ * callback without being copied. The unlock callback is invoked once a buffer
+ * holds a complete picture, and the buffer may be reused for another picture
+ * after the display callback returns.
+ *
+ * \warning Only the pictures output by a format converter or a video filter
+ * are rendered into the application buffers: decoders do not use them. If
+ * the decoded pictures need no conversion to the configured format, each
+ * picture is always copied, as in the regular mode: the lock callback is
+ * invoked and the picture is copied into the returned buffer (and a warning
+ * is logged).
+ *
+ * \param mp the media player
+ * \param count number of buffers (0 to disable, 6 or more recommended)
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API
+void libvlc_video_set_buffer_pool( libvlc_media_player_t *mp,
+                                   unsigned count );
+
 
 typedef struct libvlc_video_setup_device_cfg_t
 {
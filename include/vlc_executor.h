@@ -60,6 +60,7 @@ struct vlc_runnable {
 
     /* Private data used by the vlc_executor_t (do not touch) */
     struct vlc_list node;
+    struct vlc_executor_queue *queue;
 };
 
 /**
@@ -141,6 +141,13 @@ VLC_API httpd_stream_t * httpd_StreamNew( httpd_host_t *, const char *psz_url, c
 VLC_API void httpd_StreamDelete( httpd_stream_t * );
 VLC_API int httpd_StreamHeader( httpd_stream_t *, uint8_t *p_data, int i_data );
 VLC_API int httpd_StreamSend( httpd_stream_t *, const block_t *p_block );
+/**
+ * Sends a block to all the clients of a stream, without copying it.
+ *
+ * The block is shared by all the clients, its ownership is transferred.
+ * It must not be part of a chain.
+ */
+VLC_API int httpd_StreamSendBlock( httpd_stream_t *, block_t *p_block );
 VLC_API int httpd_StreamSetHTTPHeaders(httpd_stream_t *, const httpd_header *, size_t);
 
 /* Msg functions facilities */
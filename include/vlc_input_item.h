@@ -524,6 +524,8 @@ struct input_stats_t
     int64_t i_read_packets;
     int64_t i_read_bytes;
     float f_input_bitrate;
+    int64_t i_cache_hits; /* reads served by the prefetch cache */
+    int64_t i_cache_misses; /* reads that waited for the network */
 
     /* Demux */
     int64_t i_demux_read_packets;
@@ -535,6 +537,7 @@ struct input_stats_t
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    int64_t i_pool_waits; /* waits for a free decoder picture */
 
     /* Vout */
     int64_t i_displayed_pictures;
@@ -124,9 +124,70 @@ static inline module_t *module_need_var(vlc_object_t *obj, const char *cap,
 }
 #define module_need_var(a,b,c) module_need_var(VLC_OBJECT(a),b,c)
 
+/**
+ * Description of the media being probed, for the probe results cache.
+ *
+ * The candidates ranked before the module that last accepted media with the
+ * same description are not probed, unless that module rejects the media.
+ * Unknown fields are left zero or NULL.
+ */
+struct vlc_probe_key
+{
+    vlc_fourcc_t fourcc; /**< Codec */
+    int profile; /**< Codec profile */
+    const char *mime; /**< Content type */
+    const char *extension; /**< File name extension (without the dot) */
+    const void *signature; /**< First bytes of the media */
+    size_t signature_size; /**< Byte size of the signature */
+};
+
+/**
+ * Finds and instantiates the best module of a certain type, skipping the
+ * modules which rejected similar media.
+ *
+ * This is the same as vlc_module_load(), using the probe results cache if
+ * the key is not NULL.
+ */
+VLC_API module_t *vlc_module_load_cached(struct vlc_logger *log,
+                                         const char *cap, const char *name,
+                                         bool strict,
+                                         const struct vlc_probe_key *key,
+                                         vlc_activate_t probe, ...) VLC_USED;
+
+/**
+ * Finds and instantiates the best module of a certain type from a list in a
+ * variable, skipping the modules which rejected similar media.
+ *
+ * This is the same as module_need_var(), using the probe results cache if
+ * the key is not NULL.
+ */
+VLC_API module_t *module_need_cached(vlc_object_t *, const char *cap,
+                                     const char *varname,
+                                     const struct vlc_probe_key *key) VLC_USED;
+
 VLC_API void module_unneed( vlc_object_t *, module_t * );
 #define module_unneed(a,b) module_unneed(VLC_OBJECT(a),b)
 
+/**
+ * Module probe results cache statistics.
+ */
+struct vlc_probe_stats
+{
+    uint64_t hits; /**< Probes won by the remembered module */
+    uint64_t misses; /**< Probes without a remembered module */
+    uint64_t stale; /**< Probes that the remembered module rejected */
+};
+
+/**
+ * Gets the module probe results cache statistics.
+ *
+ * Demuxers and packetizers that rejected similar media before are skipped if
+ * the module-probe-cache option is enabled.
+ *
+ * \param stats statistics since the process started [OUT]
+ */
+VLC_API void vlc_module_GetProbeStats(struct vlc_probe_stats *stats);
+
 /**
  * Get a pointer to a module_t given it's name.
  *
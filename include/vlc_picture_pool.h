@@ -127,6 +127,13 @@ VLC_USED;
  */
 unsigned picture_pool_GetSize(const picture_pool_t *);
 
+/**
+ * Returns how many times picture_pool_Wait() had to block because no
+ * picture was available, and resets that counter.
+ * @note This function is thread-safe.
+ */
+unsigned picture_pool_GetResetWaits(picture_pool_t *);
+
 
 #endif /* VLC_PICTURE_POOL_H */
 
@@ -178,6 +178,19 @@ VLC_USED static inline bool vlc_queue_IsEmpty(const vlc_queue_t *q)
     return q->first == NULL;
 }
 
+/**
+ * Gets the oldest entry without dequeuing it (without locking).
+ *
+ * @warning It is assumed that the caller already holds the queue lock;
+ * otherwise the behaviour is undefined.
+ *
+ * @return the first entry in the queue, or NULL if the queue is empty
+ */
+VLC_USED static inline void *vlc_queue_PeekUnlocked(const vlc_queue_t *q)
+{
+    return q->first;
+}
+
 /** @} */
 
 /**
@@ -223,6 +223,19 @@ struct stream_t
     void *p_sys;
 };
 
+/**
+ * Read-ahead statistics of a caching stream filter
+ */
+struct vlc_stream_cache_stats
+{
+    uint64_t fetched;  /**< bytes read from the underlying stream */
+    uint64_t served;   /**< bytes returned to the reader */
+    uint64_t retained; /**< buffered bytes kept across backward seeks */
+    unsigned hits;     /**< reads served without waiting */
+    unsigned misses;   /**< reads that had to wait for data */
+    unsigned seeks;    /**< seeks of the underlying stream */
+};
+
 /**
  * Possible commands to send to vlc_stream_Control() and vlc_stream_vaControl()
  */
@@ -246,6 +259,7 @@ enum stream_query_e
     STREAM_GET_SIGNAL,      /**< arg1=double *pf_quality, arg2=double *pf_strength   res=can fail */
     STREAM_GET_TAGS,        /**< arg1=const block_t ** res=can fail */
     STREAM_GET_TYPE,        /**< arg1=int*             res=can fail */
+    STREAM_GET_CACHE_STATS, /**< arg1=struct vlc_stream_cache_stats * res=can fail */
 
     STREAM_SET_PAUSE_STATE = 0x200, /**< arg1= bool        res=can fail */
     STREAM_SET_TITLE,       /**< arg1= int          res=can fail */
@@ -469,6 +483,12 @@ VLC_USED static inline int vlc_stream_GetType(stream_t *s, int *type)
     return vlc_stream_Control(s, STREAM_GET_TYPE, type);
 }
 
+VLC_USED static inline int vlc_stream_GetCacheStats(stream_t *s,
+                                    struct vlc_stream_cache_stats *stats)
+{
+    return vlc_stream_Control(s, STREAM_GET_CACHE_STATS, stats);
+}
+
 /**
  * Get the size of the stream.
  */
@@ -43,6 +43,25 @@ typedef struct vlc_thumbnailer_request_t vlc_thumbnailer_request_t;
  */
 typedef void(*vlc_thumbnailer_cb)( void* data, picture_t* thumbnail );
 
+/**
+ * \brief vlc_thumbnailer_batch_cb defines a callback invoked for each
+ * thumbnail of a batch request
+ *
+ * This callback is called once per requested timestamp, in the order of the
+ * request, provided the request is not cancelled before its completion. The
+ * call with index count - 1 is therefore the last one for the request.
+ * In case of failure for a given timestamp, thumbnail will be NULL.
+ * The picture, if any, is owned by the thumbnailer, and must be acquired by
+ * using \link picture_Hold \endlink to use it past the callback's scope.
+ *
+ * \param data Is the opaque pointer passed as the request last parameter
+ * \param index The index of the timestamp in the request
+ * \param thumbnail The generated thumbnail, or NULL in case of failure or
+ * timeout
+ */
+typedef void(*vlc_thumbnailer_batch_cb)( void* data, size_t index,
+                                         picture_t* thumbnail );
+
 
 /**
  * \brief vlc_thumbnailer_Create Creates a thumbnailer object
@@ -53,6 +72,23 @@ VLC_API vlc_thumbnailer_t*
 vlc_thumbnailer_Create( vlc_object_t* p_parent )
 VLC_USED;
 
+/**
+ * \brief vlc_thumbnailer_CreateWithThreads Creates a thumbnailer object
+ * processing several requests in parallel
+ *
+ * Each request runs on its own input, so that requests for different items
+ * (or batches) proceed concurrently, up to max_threads at a time.
+ *
+ * \param parent A VLC object
+ * \param max_threads The maximum number of requests processed concurrently
+ * (must be strictly positive)
+ * \return A thumbnailer object, or NULL in case of failure
+ */
+VLC_API vlc_thumbnailer_t*
+vlc_thumbnailer_CreateWithThreads( vlc_object_t* p_parent,
+                                   unsigned max_threads )
+VLC_USED;
+
 enum vlc_thumbnailer_seek_speed
 {
     /** Precise, but potentially slow */
@@ -112,6 +148,60 @@ vlc_thumbnailer_RequestByPos( vlc_thumbnailer_t *thumbnailer,
                               input_item_t *input_item, vlc_tick_t timeout,
                               vlc_thumbnailer_cb cb, void* user_data );
 
+/**
+ * \brief vlc_thumbnailer_RequestBatch Requests thumbnails at several times
+ * \param thumbnailer A thumbnailer object
+ * \param times The times at which the thumbnails should be taken
+ * \param count The number of times (must be strictly positive)
+ * \param speed The seeking speed \sa{enum vlc_thumbnailer_seek_speed}
+ * \param input_item The input item to generate the thumbnails for
+ * \param timeout A timeout value for each thumbnail, or VLC_TICK_INVALID to
+ * disable timeout
+ * \param cb A user callback to be called for each time (success & error)
+ * \param user_data An opaque value, provided as cb's first parameter
+ * \return An opaque request object, or NULL in case of failure
+ *
+ * All the thumbnails are taken from a single input, which is opened once
+ * and then seeked from one time to the next. With
+ * VLC_THUMBNAILER_SEEK_FAST, only the keyframes nearest to the requested
+ * times are decoded, which makes this suitable for seek bar previews.
+ *
+ * The times array is copied and can be released after calling this
+ * function. The other rules are the same as vlc_thumbnailer_RequestByTime().
+ */
+VLC_API vlc_thumbnailer_request_t*
+vlc_thumbnailer_RequestBatch( vlc_thumbnailer_t *thumbnailer,
+                              const vlc_tick_t *times, size_t count,
+                              enum vlc_thumbnailer_seek_speed speed,
+                              input_item_t *input_item, vlc_tick_t timeout,
+                              vlc_thumbnailer_batch_cb cb, void* user_data );
+
+/**
+ * \brief vlc_thumbnailer_RequestByInterval Requests thumbnails at regular
+ * intervals
+ * \param thumbnailer A thumbnailer object
+ * \param start The time of the first thumbnail
+ * \param interval The duration between two consecutive thumbnails
+ * \param count The number of thumbnails (must be strictly positive)
+ * \param speed The seeking speed \sa{enum vlc_thumbnailer_seek_speed}
+ * \param input_item The input item to generate the thumbnails for
+ * \param timeout A timeout value for each thumbnail, or VLC_TICK_INVALID to
+ * disable timeout
+ * \param cb A user callback to be called for each time (success & error)
+ * \param user_data An opaque value, provided as cb's first parameter
+ * \return An opaque request object, or NULL in case of failure
+ *
+ * This is equivalent to vlc_thumbnailer_RequestBatch() with the times
+ * start, start + interval, ..., start + (count - 1) * interval.
+ */
+VLC_API vlc_thumbnailer_request_t*
+vlc_thumbnailer_RequestByInterval( vlc_thumbnailer_t *thumbnailer,
+                                   vlc_tick_t start, vlc_tick_t interval,
+                                   size_t count,
+                                   enum vlc_thumbnailer_seek_speed speed,
+                                   input_item_t *input_item, vlc_tick_t timeout,
+                                   vlc_thumbnailer_batch_cb cb, void* user_data );
+
 /**
  * \brief vlc_thumbnailer_DestroyRequest Destroy a thumbnail request
  * \param thumbnailer A thumbnailer object
@@ -195,6 +195,29 @@ static inline void vlc_tracer_TraceEvent(struct vlc_tracer *tracer, const char *
                      VLC_TRACE("event", event), VLC_TRACE_END);
 }
 
+/**
+ * Trace the beginning of a duration event.
+ *
+ * Each call must be paired with a vlc_tracer_TraceEnd() call with the same
+ * event from the same thread. Durations may be nested.
+ */
+static inline void vlc_tracer_TraceBegin(struct vlc_tracer *tracer, const char *type,
+                                         const char *id, const char *event)
+{
+    vlc_tracer_Trace(tracer, VLC_TRACE("type", type), VLC_TRACE("id", id),
+                     VLC_TRACE("begin", event), VLC_TRACE_END);
+}
+
+/**
+ * Trace the end of a duration event started with vlc_tracer_TraceBegin().
+ */
+static inline void vlc_tracer_TraceEnd(struct vlc_tracer *tracer, const char *type,
+                                       const char *id, const char *event)
+{
+    vlc_tracer_Trace(tracer, VLC_TRACE("type", type), VLC_TRACE("id", id),
+                     VLC_TRACE("end", event), VLC_TRACE_END);
+}
+
 static inline void vlc_tracer_TracePCR( struct vlc_tracer *tracer, const char *type,
                                     const char *id, vlc_tick_t pcr)
 {
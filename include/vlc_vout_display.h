@@ -25,6 +25,7 @@
 
 #include <vlc_es.h>
 #include <vlc_picture.h>
+#include <vlc_picture_pool.h>
 #include <vlc_subpicture.h>
 #include <vlc_mouse.h>
 #include <vlc_vout.h>
@@ -331,6 +332,20 @@ struct vlc_display_operations
      */
     int (*update_format)(vout_display_t *, const video_format_t *fmt,
                          vlc_video_context *ctx);
+
+    /**
+     * Allocates the pictures to render into (optional).
+     *
+     * If provided, the video converters and filters render directly into
+     * pictures from this pool, so that the display does not need to copy
+     * them. The pictures must be in the display format (\ref vout_display_t.fmt).
+     *
+     * May be NULL. The returned pool is owned by the caller.
+     *
+     * \param count number of pictures requested
+     * \return a picture pool, or NULL to use pictures allocated by the core
+     */
+    picture_pool_t *(*pool)(vout_display_t *, unsigned count);
 };
 
 struct vout_display_t {
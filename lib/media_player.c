@@ -629,6 +629,7 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_Create (mp, "vmem-width", VLC_VAR_INTEGER);
     var_Create (mp, "vmem-height", VLC_VAR_INTEGER);
     var_Create (mp, "vmem-pitch", VLC_VAR_INTEGER);
+    var_Create (mp, "vmem-pool", VLC_VAR_INTEGER);
 
     var_Create (mp, "vout-cb-type", VLC_VAR_INTEGER );
     var_Create( mp, "vout-cb-opaque", VLC_VAR_ADDRESS );
@@ -1057,6 +1058,11 @@ void libvlc_video_set_format( libvlc_media_player_t *mp, const char *chroma,
     var_SetInteger( mp, "vmem-pitch", pitch );
 }
 
+void libvlc_video_set_buffer_pool( libvlc_media_player_t *mp, unsigned count )
+{
+    var_SetInteger( mp, "vmem-pool", count );
+}
+
 bool libvlc_video_set_output_callbacks(libvlc_media_player_t *mp,
                                        libvlc_video_engine_t engine,
                                        libvlc_video_output_setup_cb setup_cb,
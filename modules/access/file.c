@@ -44,6 +44,10 @@
 #   include <linux/magic.h>
 #endif
 
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
+
 #if defined( _WIN32 )
 #   include <io.h>
 #   include <ctype.h>
@@ -60,12 +64,24 @@
 #include <vlc_fs.h>
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
+#include <vlc_atomic.h>
+
+#ifdef HAVE_MMAP
+typedef struct file_mmap_window file_mmap_window_t;
+#endif
 
 typedef struct
 {
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    /* memory-mapped mode */
+    file_mmap_window_t *window;
+    uint64_t offset;
+    uint64_t readahead; /* file offset up to which read-ahead was requested */
+    size_t page_mask;
+#endif
 } access_sys_t;
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -168,6 +184,11 @@ static bool IsRemote (const char *path)
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
+#ifdef HAVE_MMAP
+static block_t *BlockMmap (stream_t *, bool *);
+static int FileSeekMmap (stream_t *, uint64_t);
+static void MmapWindowRelease (file_mmap_window_t *);
+#endif
 
 /*****************************************************************************
  * FileOpen: open the file
@@ -252,12 +273,32 @@ int FileOpen( vlc_object_t *p_this )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+#ifdef HAVE_MMAP
+    p_sys->window = NULL;
+#endif
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
         p_access->pf_seek = FileSeek;
         p_sys->b_pace_control = true;
 
+#ifdef HAVE_MMAP
+        /* Hand out blocks pointing directly into the page cache instead of
+         * copying. Remote file systems can fail mapped accesses at any
+         * time, so they always use plain reads. */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = BlockMmap;
+            p_access->pf_seek = FileSeekMmap;
+            p_sys->offset = 0;
+            p_sys->readahead = 0;
+            p_sys->page_mask = sysconf (_SC_PAGESIZE) - 1;
+            msg_Dbg (p_access, "using memory-mapped reads");
+        }
+#endif
+
         /* Demuxers will need the beginning of the file for probing. */
         posix_fadvise (fd, 0, 4096, POSIX_FADV_WILLNEED);
         /* In most cases, we only read the file once. */
@@ -292,7 +333,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -300,6 +341,11 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_MMAP
+    /* Blocks still in use keep their own reference to the mapping */
+    if (p_sys->window != NULL)
+        MmapWindowRelease (p_sys->window);
+#endif
     vlc_close (p_sys->fd);
 }
 
@@ -326,6 +372,209 @@ static ssize_t Read (stream_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+/* Size of the file region mapped at once */
+#define MMAP_WINDOW_SIZE (32 << 20)
+/* Size of the blocks handed out to the stream layer */
+#define MMAP_BLOCK_SIZE (256 << 10)
+/* How far ahead of the read position the kernel is asked to page in */
+#define MMAP_READAHEAD (4 << 20)
+
+#ifndef POSIX_MADV_SEQUENTIAL
+# define posix_madvise(addr, len, adv)
+#endif
+
+struct file_mmap_window
+{
+    vlc_atomic_rc_t rc;
+    uint64_t offset; /* file offset of the mapping */
+    void *addr;
+    size_t length;
+};
+
+typedef struct
+{
+    block_t self;
+    file_mmap_window_t *window;
+} file_mmap_block_t;
+
+static void MmapWindowRelease (file_mmap_window_t *w)
+{
+    if (vlc_atomic_rc_dec (&w->rc))
+    {
+        munmap (w->addr, w->length);
+        free (w);
+    }
+}
+
+static void MmapBlockRelease (block_t *block)
+{
+    file_mmap_block_t *mb = container_of (block, file_mmap_block_t, self);
+
+    MmapWindowRelease (mb->window);
+    free (mb);
+}
+
+static const struct vlc_block_callbacks mmap_block_cbs =
+{
+    MmapBlockRelease,
+};
+
+/* Used if the file cannot be mapped (anymore) */
+static block_t *BlockPread (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+    block_t *block = block_Alloc (MMAP_BLOCK_SIZE);
+
+    if (unlikely(block == NULL))
+        return NULL;
+
+    ssize_t val = pread (sys->fd, block->p_buffer, block->i_buffer,
+                         sys->offset);
+    if (val <= 0)
+    {
+        if (val < 0 && errno != EINTR && errno != EAGAIN)
+            msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        if (val == 0 || (errno != EINTR && errno != EAGAIN))
+            *eof = true;
+        block_Release (block);
+        return NULL;
+    }
+
+    block->i_buffer = val;
+    sys->offset += val;
+    return block;
+}
+
+static file_mmap_window_t *MmapWindowNew (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct stat st;
+
+    /* The file may be growing, check its size on every new window */
+    if (fstat (sys->fd, &st))
+    {
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    if ((uint64_t)st.st_size <= sys->offset)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    uint64_t start = sys->offset & ~(uint64_t)sys->page_mask;
+    size_t length = __MIN((uint64_t)st.st_size - start, MMAP_WINDOW_SIZE);
+
+    file_mmap_window_t *w = malloc (sizeof (*w));
+    if (unlikely(w == NULL))
+        return NULL;
+
+    /* Read-only: blocks are only ever copied out by the stream layer, which
+     * duplicates them before growing or modifying them. */
+    w->addr = mmap (NULL, length, PROT_READ, MAP_SHARED, sys->fd, start);
+    if (w->addr == MAP_FAILED)
+    {
+        msg_Warn (p_access, "cannot map file at %"PRIu64": %s", start,
+                  vlc_strerror_c(errno));
+        free (w);
+        return NULL;
+    }
+
+    vlc_atomic_rc_init (&w->rc);
+    w->offset = start;
+    w->length = length;
+    posix_madvise (w->addr, length, POSIX_MADV_SEQUENTIAL);
+    sys->readahead = start;
+    return w;
+}
+
+static block_t *BlockMmap (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+    file_mmap_window_t *w = sys->window;
+
+    if (w == NULL || sys->offset < w->offset
+     || sys->offset >= w->offset + w->length)
+    {
+        if (w != NULL)
+        {
+            MmapWindowRelease (w);
+            sys->window = NULL;
+        }
+
+        w = MmapWindowNew (p_access, eof);
+        if (w == NULL)
+        {
+            if (*eof)
+                return NULL;
+            /* Do not retry mapping on every block */
+            p_access->pf_block = BlockPread;
+            return BlockPread (p_access, eof);
+        }
+        sys->window = w;
+    }
+
+    size_t pos = sys->offset - w->offset;
+    size_t len = __MIN(w->length - pos, MMAP_BLOCK_SIZE);
+
+    /* Touching pages past the end of a truncated file raises SIGBUS. Do not
+     * hand out any of them. This leaves a window between this check and the
+     * consumption of the block, hence the option documentation. */
+    struct stat st;
+
+    if (fstat (sys->fd, &st) == 0)
+    {
+        if ((uint64_t)st.st_size <= sys->offset)
+        {
+            *eof = true;
+            return NULL;
+        }
+        if ((uint64_t)st.st_size - sys->offset < len)
+            len = st.st_size - sys->offset;
+    }
+
+    /* Keep the kernel paging in ahead of the demuxer */
+    if (sys->offset + MMAP_READAHEAD / 2 >= sys->readahead)
+    {
+        size_t from = __MAX(sys->readahead, sys->offset) - w->offset;
+        from &= ~sys->page_mask;
+
+        if (from < w->length)
+        {
+            size_t count = __MIN(w->length - from, MMAP_READAHEAD);
+
+            posix_madvise ((char *)w->addr + from, count,
+                           POSIX_MADV_WILLNEED);
+            sys->readahead = w->offset + from + count;
+        }
+    }
+
+    file_mmap_block_t *mb = malloc (sizeof (*mb));
+    if (unlikely(mb == NULL))
+        return NULL;
+
+    /* The block covers exactly its slice, so that reallocating it can never
+     * spill into the rest of the mapping. */
+    block_Init (&mb->self, &mmap_block_cbs, (char *)w->addr + pos, len);
+    vlc_atomic_rc_inc (&w->rc);
+    mb->window = w;
+    sys->offset += len;
+    return &mb->self;
+}
+
+static int FileSeekMmap (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    sys->offset = i_pos;
+    sys->readahead = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
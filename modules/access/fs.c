@@ -37,6 +37,12 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+#ifdef HAVE_MMAP
+    add_bool( "file-mmap", false, N_("Memory-map local files"),
+              N_("Read local regular files through memory mappings instead "
+                 "of read() calls. The file must not be truncated while it "
+                 "is being read, otherwise VLC may crash.") )
+#endif
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
@@ -36,6 +36,7 @@ struct vlc_http_conn_cbs
                                            const struct vlc_http_msg *,
                                            bool has_data);
     void (*release)(struct vlc_http_conn *);
+    bool (*idle)(struct vlc_http_conn *);
 };
 
 struct vlc_http_conn
@@ -56,6 +57,14 @@ static inline void vlc_http_conn_release(struct vlc_http_conn *conn)
     conn->cbs->release(conn);
 }
 
+/**
+ * Checks whether a connection has no open streams.
+ */
+static inline bool vlc_http_conn_idle(struct vlc_http_conn *conn)
+{
+    return conn->cbs->idle(conn);
+}
+
 void vlc_http_err(void *, const char *msg, ...) VLC_FORMAT(2, 3);
 void vlc_http_dbg(void *, const char *msg, ...) VLC_FORMAT(2, 3);
 
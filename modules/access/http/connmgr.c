@@ -24,6 +24,7 @@
 
 #include <assert.h>
 #include <vlc_common.h>
+#include <vlc_list.h>
 #include <vlc_network.h>
 #include <vlc_tls.h>
 #include <vlc_url.h>
@@ -96,50 +97,179 @@ static char *vlc_http_proxy_find(const char *hostname, unsigned port,
 }
 
 
+/** Maximum number of connections kept open by a manager */
+#define VLC_HTTP_MGR_MAX_CONNS 4
+/** Delay after which an unused connection is closed */
+#define VLC_HTTP_MGR_IDLE_TIMEOUT VLC_TICK_FROM_SEC(30)
+
+struct vlc_http_mgr_conn
+{
+    struct vlc_http_conn *conn;
+    struct vlc_list node;
+    vlc_tick_t last_used;
+    bool secure;
+    bool http2;
+    unsigned port;
+    char *proxy;
+    char host[];
+};
+
 struct vlc_http_mgr
 {
     struct vlc_logger *logger;
     vlc_object_t *obj;
     vlc_tls_client_t *creds;
     struct vlc_http_cookie_jar_t *jar;
-    struct vlc_http_conn *conn;
+    struct vlc_list conns; /**< Connections, most recently used first */
+    unsigned count;
 };
 
-static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
-                                               const char *host, unsigned port)
+static bool vlc_http_mgr_match(const struct vlc_http_mgr_conn *c, bool secure,
+                               const char *host, unsigned port,
+                               const char *proxy)
 {
-    (void) host; (void) port;
-    return mgr->conn;
+    if (c->secure != secure || c->port != port || strcasecmp(c->host, host))
+        return false;
+    if (c->proxy == NULL || proxy == NULL)
+        return c->proxy == proxy;
+    return !strcmp(c->proxy, proxy);
 }
 
 static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
-                                 struct vlc_http_conn *conn)
+                                 struct vlc_http_mgr_conn *c)
+{
+    assert(mgr->count > 0);
+    vlc_list_remove(&c->node);
+    mgr->count--;
+
+    vlc_http_conn_release(c->conn);
+    free(c->proxy);
+    free(c);
+}
+
+/**
+ * Closes connections that have not carried any stream for too long.
+ * The server has most likely timed them out already anyway.
+ */
+static void vlc_http_mgr_prune(struct vlc_http_mgr *mgr)
+{
+    vlc_tick_t now = vlc_tick_now();
+    struct vlc_http_mgr_conn *c;
+
+    vlc_list_foreach(c, &mgr->conns, node)
+    {
+        if (!vlc_http_conn_idle(c->conn))
+            c->last_used = now;
+        else if (now - c->last_used >= VLC_HTTP_MGR_IDLE_TIMEOUT)
+        {
+            vlc_http_dbg(mgr->logger, "closing idle connection to %s",
+                         c->host);
+            vlc_http_mgr_release(mgr, c);
+        }
+    }
+}
+
+static struct vlc_http_mgr_conn *
+vlc_http_mgr_add(struct vlc_http_mgr *mgr, struct vlc_http_conn *conn,
+                 bool secure, bool http2, const char *host, unsigned port,
+                 const char *proxy)
 {
-    assert(mgr->conn == conn);
-    mgr->conn = NULL;
+    size_t len = strlen(host) + 1;
+    struct vlc_http_mgr_conn *c = malloc(sizeof (*c) + len);
+    if (unlikely(c == NULL))
+        goto error;
+
+    c->proxy = NULL;
+    if (proxy != NULL)
+    {
+        c->proxy = strdup(proxy);
+        if (unlikely(c->proxy == NULL))
+        {
+            free(c);
+            goto error;
+        }
+    }
+
+    c->conn = conn;
+    c->last_used = vlc_tick_now();
+    c->secure = secure;
+    c->http2 = http2;
+    c->port = port;
+    memcpy(c->host, host, len);
+
+    if (mgr->count >= VLC_HTTP_MGR_MAX_CONNS)
+    {   /* Evict the least recently used connection, preferably an idle one */
+        struct vlc_http_mgr_conn *victim = NULL, *old;
+
+        vlc_list_reverse_foreach(old, &mgr->conns, node)
+            if (vlc_http_conn_idle(old->conn))
+            {
+                victim = old;
+                break;
+            }
+
+        if (victim == NULL)
+            victim = vlc_list_last_entry_or_null(&mgr->conns,
+                                                 struct vlc_http_mgr_conn,
+                                                 node);
+        vlc_http_mgr_release(mgr, victim);
+    }
+
+    vlc_list_prepend(&c->node, &mgr->conns);
+    mgr->count++;
+    return c;
 
+error:
     vlc_http_conn_release(conn);
+    return NULL;
 }
 
 static
-struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
+struct vlc_http_msg *vlc_http_mgr_open(struct vlc_http_mgr *mgr,
+                                       struct vlc_http_mgr_conn *c,
+                                       const struct vlc_http_msg *req,
+                                       bool payload)
+{
+    struct vlc_http_stream *stream = vlc_http_stream_open(c->conn, req,
+                                                          payload);
+    if (stream != NULL)
+    {
+        struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+        if (m != NULL)
+        {
+            c->last_used = vlc_tick_now();
+            vlc_list_remove(&c->node);
+            vlc_list_prepend(&c->node, &mgr->conns);
+            return m;
+        }
+    }
+    /* Get rid of closing or reset connection */
+    vlc_http_mgr_release(mgr, c);
+    return NULL;
+}
+
+static
+struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr, bool secure,
                                         const char *host, unsigned port,
+                                        const char *proxy,
                                         const struct vlc_http_msg *req,
                                         bool payload)
 {
-    struct vlc_http_conn *conn = vlc_http_mgr_find(mgr, host, port);
-    if (conn == NULL)
-        return NULL;
+    struct vlc_http_mgr_conn *c;
 
-    struct vlc_http_stream *stream = vlc_http_stream_open(conn, req, payload);
-    if (stream != NULL)
+    vlc_list_foreach(c, &mgr->conns, node)
     {
-        struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+        if (!vlc_http_mgr_match(c, secure, host, port, proxy))
+            continue;
+
+        /* HTTP/2 multiplexes streams, HTTP/1.x carries only one at a time */
+        if (!c->http2 && !vlc_http_conn_idle(c->conn))
+            continue;
+
+        struct vlc_http_msg *m = vlc_http_mgr_open(mgr, c, req, payload);
         if (m != NULL)
             return m;
     }
-    /* Get rid of closing or reset connection */
-    vlc_http_mgr_release(mgr, conn);
     return NULL;
 }
 
@@ -148,12 +278,10 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
                                               const struct vlc_http_msg *req,
                                               bool idempotent, bool payload)
 {
+    struct vlc_http_msg *resp = NULL;
     vlc_tls_t *tls;
     bool http2 = true;
 
-    if (mgr->creds == NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTP to HTTPS not implemented */
-
     if (mgr->creds == NULL)
     {   /* First TLS connection: load x509 credentials */
         mgr->creds = vlc_tls_ClientCreate(mgr->obj);
@@ -161,30 +289,27 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
             return NULL;
     }
 
+    char *proxy = vlc_http_proxy_find(host, port, true);
+
     if (idempotent)
     {   /* If the request is idempotent, try to reuse an existing connection.
          * Otherwise, it is possible but unadvisable as we would not know if
          * the nonidempotent request was processed if the connection fails
          * before the response is received.
          */
-        struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req,
-                                                       payload);
+        resp = vlc_http_mgr_reuse(mgr, true, host, port, proxy, req, payload);
         if (resp != NULL)
-            return resp; /* existing connection reused */
+            goto out; /* existing connection reused */
     }
 
-    char *proxy = vlc_http_proxy_find(host, port, true);
     if (proxy != NULL)
-    {
         tls = vlc_https_connect_proxy(mgr->creds, mgr->creds,
                                       host, port, &http2, proxy);
-        free(proxy);
-    }
     else
         tls = vlc_https_connect(mgr->creds, host, port, &http2);
 
     if (tls == NULL)
-        return NULL;
+        goto out;
 
     struct vlc_http_conn *conn;
 
@@ -203,14 +328,16 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
     if (unlikely(conn == NULL))
     {
         vlc_tls_Close(tls);
-        return NULL;
+        goto out;
     }
 
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
-
-    mgr->conn = conn;
-    return vlc_http_mgr_reuse(mgr, host, port, req, payload);
+    struct vlc_http_mgr_conn *c = vlc_http_mgr_add(mgr, conn, true, http2,
+                                                   host, port, proxy);
+    if (likely(c != NULL))
+        resp = vlc_http_mgr_open(mgr, c, req, payload);
+out:
+    free(proxy);
+    return resp;
 }
 
 static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
@@ -218,27 +345,25 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
                                              const struct vlc_http_msg *req,
                                              bool idempotent, bool payload)
 {
-    if (mgr->creds != NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTPS to HTTP not implemented */
+    struct vlc_http_msg *resp = NULL;
+    char *proxy = vlc_http_proxy_find(host, port, false);
 
     if (idempotent)
     {
-        struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req,
-                                                       payload);
+        resp = vlc_http_mgr_reuse(mgr, false, host, port, proxy, req,
+                                  payload);
         if (resp != NULL)
-            return resp;
+            goto out;
     }
 
     struct vlc_http_conn *conn;
     struct vlc_http_stream *stream;
 
-    char *proxy = vlc_http_proxy_find(host, port, false);
     if (proxy != NULL)
     {
         vlc_url_t url;
 
         vlc_UrlParse(&url, proxy);
-        free(proxy);
 
         if (url.psz_host != NULL)
             stream = vlc_h1_request(mgr->logger, url.psz_host,
@@ -254,19 +379,19 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
                                 req, idempotent, payload, &conn);
 
     if (stream == NULL)
-        return NULL;
+        goto out;
 
-    struct vlc_http_msg *resp = vlc_http_msg_get_initial(stream);
+    resp = vlc_http_msg_get_initial(stream);
     if (resp == NULL)
     {
         vlc_http_conn_release(conn);
-        return NULL;
+        goto out;
     }
 
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
-
-    mgr->conn = conn;
+    /* The stream outlives the connection if it cannot be kept. */
+    vlc_http_mgr_add(mgr, conn, false, false, host, port, proxy);
+out:
+    free(proxy);
     return resp;
 }
 
@@ -278,6 +403,8 @@ struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
     if (port && vlc_http_port_blocked(port))
         return NULL;
 
+    vlc_http_mgr_prune(mgr);
+
     return (https ? vlc_https_request : vlc_http_request)(mgr, host, port, m,
                                                           idempotent, payload);
 }
@@ -298,14 +425,17 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->obj = obj;
     mgr->creds = NULL;
     mgr->jar = jar;
-    mgr->conn = NULL;
+    vlc_list_init(&mgr->conns);
+    mgr->count = 0;
     return mgr;
 }
 
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
 {
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
+    struct vlc_http_mgr_conn *c;
+
+    vlc_list_foreach(c, &mgr->conns, node)
+        vlc_http_mgr_release(mgr, c);
     if (mgr->creds != NULL)
         vlc_tls_ClientDelete(mgr->creds);
     free(mgr);
@@ -340,10 +340,18 @@ static void vlc_h1_conn_release(struct vlc_http_conn *c)
         vlc_h1_conn_destroy(conn);
 }
 
+static bool vlc_h1_conn_idle(struct vlc_http_conn *c)
+{
+    struct vlc_h1_conn *conn = container_of(c, struct vlc_h1_conn, conn);
+
+    return !conn->active;
+}
+
 static const struct vlc_http_conn_cbs vlc_h1_conn_callbacks =
 {
     vlc_h1_stream_open,
     vlc_h1_conn_release,
+    vlc_h1_conn_idle,
 };
 
 struct vlc_http_conn *vlc_h1_conn_create(void *ctx, vlc_tls_t *tls, bool proxy)
@@ -152,8 +152,10 @@ int main(void)
 
     /* Test HTTP/1.0 stream */
     conn_create();
+    assert(vlc_http_conn_idle(conn));
     s = stream_open(false);
     assert(s != NULL);
+    assert(!vlc_http_conn_idle(conn));
     conn_send("HTTP/1.0 200 OK\r\n\r\n");
     m = vlc_http_msg_get_initial(s);
     assert(m != NULL);
@@ -168,6 +170,7 @@ int main(void)
     b = vlc_http_msg_read(m);
     assert(b == NULL);
     vlc_http_msg_destroy(m);
+    assert(vlc_http_conn_idle(conn));
     conn_destroy();
 
     /* Test HTTP/1.1 with closed connection */
@@ -861,10 +861,22 @@ static void vlc_h2_conn_release(struct vlc_http_conn *c)
         vlc_h2_conn_destroy(conn);
 }
 
+static bool vlc_h2_conn_idle(struct vlc_http_conn *c)
+{
+    struct vlc_h2_conn *conn = container_of(c, struct vlc_h2_conn, conn);
+    bool idle;
+
+    vlc_mutex_lock(&conn->lock);
+    idle = (conn->streams == NULL);
+    vlc_mutex_unlock(&conn->lock);
+    return idle;
+}
+
 static const struct vlc_http_conn_cbs vlc_h2_conn_callbacks =
 {
     vlc_h2_stream_open,
     vlc_h2_conn_release,
+    vlc_h2_conn_idle,
 };
 
 struct vlc_http_conn *vlc_h2_conn_create(void *ctx, struct vlc_tls *tls)
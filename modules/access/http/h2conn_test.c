@@ -175,8 +175,10 @@ int main(void)
 
     /* Test rejected stream */
     sid += 2;
+    assert(vlc_http_conn_idle(conn));
     s = stream_open(false);
     assert(s != NULL);
+    assert(!vlc_http_conn_idle(conn));
     conn_expect(HEADERS);
     conn_send(vlc_h2_frame_rst_stream(sid, VLC_H2_REFUSED_STREAM));
     m = vlc_http_stream_read_headers(s);
@@ -184,6 +186,7 @@ int main(void)
     b = vlc_http_stream_read(s);
     assert(b == vlc_http_error);
     vlc_http_stream_close(s, false);
+    assert(vlc_http_conn_idle(conn));
     conn_expect(RST_STREAM);
 
     /* Test accepted stream */
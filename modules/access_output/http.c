@@ -437,10 +437,10 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
             memcpy( p_buffer->p_buffer, &hdr, sizeof( hdr ) );
         }
 
-        /* send data */
-        i_err = httpd_StreamSend( p_sys->p_httpd_stream, p_buffer );
+        /* send data, shared by all the clients */
+        p_buffer->p_next = NULL;
+        i_err = httpd_StreamSendBlock( p_sys->p_httpd_stream, p_buffer );
 
-        block_Release( p_buffer );
         p_buffer = p_next;
 
         if( i_err < 0 )
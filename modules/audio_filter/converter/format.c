@@ -39,6 +39,8 @@
 #include <vlc_block.h>
 #include <vlc_filter.h>
 
+#include "samples.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -58,6 +60,35 @@ vlc_module_end()
 typedef block_t *(*cvt_t)(filter_t *, block_t *);
 static const struct vlc_filter_operations *FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst);
 
+static block_t *Convert(filter_t *filter, block_t *bsrc)
+{
+    const struct pcm_converter *cvt = filter->p_sys;
+    size_t samples = bsrc->i_buffer / cvt->src_size;
+    block_t *bdst = bsrc;
+
+    if (cvt->dst_size > cvt->src_size)
+    {
+        bdst = block_Alloc(samples * cvt->dst_size);
+        if (unlikely(bdst == NULL))
+        {
+            block_Release(bsrc);
+            return NULL;
+        }
+        block_CopyProperties(bdst, bsrc);
+    }
+
+    cvt->convert(bdst->p_buffer, bsrc->p_buffer, samples);
+    bdst->i_buffer = samples * cvt->dst_size;
+
+    if (bdst != bsrc)
+        block_Release(bsrc);
+    return bdst;
+}
+
+static const struct vlc_filter_operations convert_ops = {
+    .filter_audio = Convert,
+};
+
 static int Open(vlc_object_t *object)
 {
     filter_t     *filter = (filter_t *)object;
@@ -70,11 +101,23 @@ static int Open(vlc_object_t *object)
     if (src->i_codec == dst->i_codec)
         return VLC_EGENERIC;
 
-    const struct vlc_filter_operations *filter_ops = FindConversion(src->i_codec, dst->i_codec);
-    if (filter_ops == NULL)
-        return VLC_EGENERIC;
+    /* Common conversions have vectorized kernels */
+    const struct pcm_converter *cvt = pcm_FindConverter(src->i_codec,
+                                                        dst->i_codec);
+    if (cvt != NULL)
+    {
+        filter->p_sys = (void *)cvt;
+        filter->ops = &convert_ops;
+    }
+    else
+    {
+        const struct vlc_filter_operations *filter_ops =
+            FindConversion(src->i_codec, dst->i_codec);
+        if (filter_ops == NULL)
+            return VLC_EGENERIC;
 
-    filter->ops = filter_ops;
+        filter->ops = filter_ops;
+    }
 
     msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i",
             (char *)&src->i_codec, (char *)&dst->i_codec,
@@ -166,51 +209,6 @@ static block_t *S16toU8(filter_t *filter, block_t *b)
     return b;
 }
 
-static block_t *S16toFl32(filter_t *filter, block_t *bsrc)
-{
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
-    if (unlikely(bdst == NULL))
-        goto out;
-
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
-#if 0
-        /* Slow version */
-        *dst++ = (float)*src++ / 32768.f;
-#else
-    {   /* This is Walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.f;
-    }
-#endif
-out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
-    return bdst;
-}
-
-static block_t *S16toS32(filter_t *filter, block_t *bsrc)
-{
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
-    if (unlikely(bdst == NULL))
-        goto out;
-
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    int32_t *dst = (int32_t *)bdst->p_buffer;
-    for (int i = bsrc->i_buffer / 2; i--;)
-        *dst++ = *src++ << 16;
-out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
-    return bdst;
-}
-
 static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
 {
     block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
@@ -250,70 +248,6 @@ static block_t *Fl32toU8(filter_t *filter, block_t *b)
     return b;
 }
 
-static block_t *Fl32toS16(filter_t *filter, block_t *b)
-{
-    VLC_UNUSED(filter);
-    float   *src = (float *)b->p_buffer;
-    int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = lroundf(*src * 32768.f);
-        src++; dst++;
-#else
-        /* This is Walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.f;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
-    b->i_buffer /= 2;
-    return b;
-}
-
-static block_t *Fl32toS32(filter_t *filter, block_t *b)
-{
-    float   *src = (float *)b->p_buffer;
-    int32_t *dst = (int32_t *)src;
-    for (size_t i = b->i_buffer / 4; i--;)
-    {
-        float s = *(src++) * -((float)INT32_MIN);
-        if (s >= ((float)INT32_MAX))
-            *(dst++) = INT32_MAX;
-        else
-        if (s <= ((float)INT32_MIN))
-            *(dst++) = INT32_MIN;
-        else
-            *(dst++) = lroundf(s);
-    }
-    VLC_UNUSED(filter);
-    return b;
-}
-
-static block_t *Fl32toFl64(filter_t *filter, block_t *bsrc)
-{
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
-    if (unlikely(bdst == NULL))
-        goto out;
-
-    block_CopyProperties(bdst, bsrc);
-    float  *src = (float *)bsrc->p_buffer;
-    double *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 4; i--;)
-        *(dst++) = *(src++);
-out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
-    return bdst;
-}
-
 
 /*** from S32N ***/
 static block_t *S32toU8(filter_t *filter, block_t *b)
@@ -328,28 +262,6 @@ static block_t *S32toU8(filter_t *filter, block_t *b)
     return b;
 }
 
-static block_t *S32toS16(filter_t *filter, block_t *b)
-{
-    VLC_UNUSED(filter);
-    int32_t *src = (int32_t *)b->p_buffer;
-    int16_t *dst = (int16_t *)src;
-    for (size_t i = b->i_buffer / 4; i--;)
-        *dst++ = (*src++) >> 16;
-
-    b->i_buffer /= 2;
-    return b;
-}
-
-static block_t *S32toFl32(filter_t *filter, block_t *b)
-{
-    VLC_UNUSED(filter);
-    int32_t *src = (int32_t*)b->p_buffer;
-    float   *dst = (float *)src;
-    for (int i = b->i_buffer / 4; i--;)
-        *dst++ = (float)(*src++) / -((float)INT32_MIN);
-    return b;
-}
-
 static block_t *S32toFl64(filter_t *filter, block_t *bsrc)
 {
     block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
@@ -408,18 +320,6 @@ static block_t *Fl64toS16(filter_t *filter, block_t *b)
     return b;
 }
 
-static block_t *Fl64toFl32(filter_t *filter, block_t *b)
-{
-    double *src = (double *)b->p_buffer;
-    float  *dst = (float *)src;
-    for (size_t i = b->i_buffer / 8; i--;)
-        *(dst++) = *(src++);
-    b->i_buffer /= 2;
-
-    VLC_UNUSED(filter);
-    return b;
-}
-
 static block_t *Fl64toS32(filter_t *filter, block_t *b)
 {
     double  *src = (double *)b->p_buffer;
@@ -454,23 +354,15 @@ static const struct {
     { VLC_CODEC_U8,   VLC_CODEC_FL64, { .filter_audio = U8toFl64 }   },
 
     { VLC_CODEC_S16N, VLC_CODEC_U8,   { .filter_audio = S16toU8 }    },
-    { VLC_CODEC_S16N, VLC_CODEC_FL32, { .filter_audio = S16toFl32 }  },
-    { VLC_CODEC_S16N, VLC_CODEC_S32N, { .filter_audio = S16toS32 }   },
     { VLC_CODEC_S16N, VLC_CODEC_FL64, { .filter_audio = S16toFl64 }  },
 
     { VLC_CODEC_FL32, VLC_CODEC_U8,   { .filter_audio = Fl32toU8 }   },
-    { VLC_CODEC_FL32, VLC_CODEC_S16N, { .filter_audio = Fl32toS16 }  },
-    { VLC_CODEC_FL32, VLC_CODEC_S32N, { .filter_audio = Fl32toS32 }  },
-    { VLC_CODEC_FL32, VLC_CODEC_FL64, { .filter_audio = Fl32toFl64 } },
 
     { VLC_CODEC_S32N, VLC_CODEC_U8,   { .filter_audio = S32toU8 }    },
-    { VLC_CODEC_S32N, VLC_CODEC_S16N, { .filter_audio = S32toS16 }   },
-    { VLC_CODEC_S32N, VLC_CODEC_FL32, { .filter_audio = S32toFl32 }  },
     { VLC_CODEC_S32N, VLC_CODEC_FL64, { .filter_audio = S32toFl64 }  },
 
     { VLC_CODEC_FL64, VLC_CODEC_U8,   { .filter_audio = Fl64toU8 }   },
     { VLC_CODEC_FL64, VLC_CODEC_S16N, { .filter_audio = Fl64toS16 }  },
-    { VLC_CODEC_FL64, VLC_CODEC_FL32, { .filter_audio = Fl64toFl32 } },
     { VLC_CODEC_FL64, VLC_CODEC_S32N, { .filter_audio = Fl64toS32 }  },
 
     { 0, 0, { .filter_audio = NULL } }
@@ -0,0 +1,970 @@
+/*****************************************************************************
+ * samples.c : PCM sample conversion and amplification kernels
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef SAMPLES_TEST
+# undef NDEBUG
+#endif
+
+#include <math.h>
+#include <stdint.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_fourcc.h>
+
+#include "samples.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined (__aarch64__) && defined (__ARM_NEON)
+# include <arm_neon.h>
+# define HAVE_NEON_INTRINSICS 1
+#endif
+
+/*
+ * All the kernels of a given pair must produce bit-exact results. The vector
+ * kernels process the bulk of the samples and leave the tail to the C ones.
+ *
+ * Narrowing kernels may run in place: a vector is always fully loaded before
+ * the (smaller or equal) output vector is stored.
+ */
+
+/*** C ***/
+static void S16toFl32_C(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    float *d = dst;
+
+    while (n--)
+    {   /* Walken's trick based on IEEE float format */
+        union { float f; int32_t i; } u;
+        u.i = *s++ + 0x43c00000;
+        *d++ = u.f - 384.f;
+    }
+}
+
+static void S16toS32_C(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    int32_t *d = dst;
+
+    while (n--)
+        *d++ = *s++ * 65536;
+}
+
+static void Fl32toS16_C(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int16_t *d = dst;
+
+    while (n--)
+    {   /* Walken's trick based on IEEE float format */
+        union { float f; int32_t i; } u;
+        u.f = *s++ + 384.f;
+        if (u.i > 0x43c07fff)
+            *d++ = 32767;
+        else if (u.i < 0x43bf8000)
+            *d++ = -32768;
+        else
+            *d++ = u.i - 0x43c00000;
+    }
+}
+
+static void Fl32toS32_C(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int32_t *d = dst;
+
+    while (n--)
+    {
+        float v = *s++ * -((float)INT32_MIN);
+        if (v >= ((float)INT32_MAX))
+            *d++ = INT32_MAX;
+        else
+        if (v <= ((float)INT32_MIN))
+            *d++ = INT32_MIN;
+        else
+            *d++ = lroundf(v);
+    }
+}
+
+static void Fl32toFl64_C(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    double *d = dst;
+
+    while (n--)
+        *d++ = *s++;
+}
+
+static void S32toS16_C(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    int16_t *d = dst;
+
+    while (n--)
+        *d++ = *s++ >> 16;
+}
+
+static void S32toFl32_C(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    float *d = dst;
+
+    while (n--)
+        *d++ = (float)*s++ / -((float)INT32_MIN);
+}
+
+static void Fl64toFl32_C(void *dst, const void *src, size_t n)
+{
+    const double *s = src;
+    float *d = dst;
+
+    while (n--)
+        *d++ = *s++;
+}
+
+static void AmplifyFl32_C(void *buf, size_t n, float gain)
+{
+    float *p = buf;
+
+    while (n--)
+        *p++ *= gain;
+}
+
+static void AmplifyFl64_C(void *buf, size_t n, float gain)
+{
+    double *p = buf;
+    const double mult = gain;
+
+    while (n--)
+        *p++ *= mult;
+}
+
+/*** SSE2 ***/
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE2
+static void S16toFl32_SSE2(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    float *d = dst;
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)s);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+
+        _mm_storeu_ps(d, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(d + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    S16toFl32_C(d, s, n);
+}
+
+VLC_SSE2
+static void S16toS32_SSE2(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    int32_t *d = dst;
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)s);
+
+        _mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi16(zero, x));
+        _mm_storeu_si128((__m128i *)(d + 4), _mm_unpackhi_epi16(zero, x));
+    }
+    S16toS32_C(d, s, n);
+}
+
+VLC_SSE2
+static void Fl32toS16_SSE2(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int16_t *d = dst;
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+
+    /* Rounds to nearest even like the Walken's trick does */
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m128 lo = _mm_mul_ps(_mm_loadu_ps(s), scale);
+        __m128 hi = _mm_mul_ps(_mm_loadu_ps(s + 4), scale);
+
+        lo = _mm_min_ps(_mm_max_ps(lo, min), max);
+        hi = _mm_min_ps(_mm_max_ps(hi, min), max);
+        _mm_storeu_si128((__m128i *)d,
+                         _mm_packs_epi32(_mm_cvtps_epi32(lo),
+                                         _mm_cvtps_epi32(hi)));
+    }
+    Fl32toS16_C(d, s, n);
+}
+
+VLC_SSE2
+static void Fl32toS32_SSE2(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int32_t *d = dst;
+    const __m128 scale = _mm_set1_ps(-((float)INT32_MIN));
+    const __m128 min = _mm_set1_ps((float)INT32_MIN);
+    const __m128 half = _mm_set1_ps(.5f);
+    const __m128 abs = _mm_castsi128_ps(_mm_set1_epi32(INT32_MAX));
+
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+    {
+        __m128 v = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(s), scale), min);
+        __m128i r = _mm_cvttps_epi32(v);
+        __m128 frac = _mm_sub_ps(v, _mm_cvtepi32_ps(r));
+
+        /* Round half-way cases away from zero, as lroundf() does */
+        __m128i away = _mm_srli_epi32(
+            _mm_castps_si128(_mm_cmpge_ps(_mm_and_ps(frac, abs), half)), 31);
+        __m128i sign = _mm_srai_epi32(_mm_castps_si128(frac), 31);
+        r = _mm_add_epi32(r, _mm_sub_epi32(_mm_xor_si128(away, sign), sign));
+
+        /* Saturate positive overflows to INT32_MAX */
+        __m128i over = _mm_castps_si128(_mm_cmpge_ps(v, scale));
+        r = _mm_or_si128(_mm_andnot_si128(over, r), _mm_srli_epi32(over, 1));
+        _mm_storeu_si128((__m128i *)d, r);
+    }
+    Fl32toS32_C(d, s, n);
+}
+
+VLC_SSE2
+static void Fl32toFl64_SSE2(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    double *d = dst;
+
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+    {
+        __m128 x = _mm_loadu_ps(s);
+
+        _mm_storeu_pd(d, _mm_cvtps_pd(x));
+        _mm_storeu_pd(d + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+    Fl32toFl64_C(d, s, n);
+}
+
+VLC_SSE2
+static void S32toS16_SSE2(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    int16_t *d = dst;
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)s);
+        __m128i hi = _mm_loadu_si128((const __m128i *)(s + 4));
+
+        _mm_storeu_si128((__m128i *)d,
+                         _mm_packs_epi32(_mm_srai_epi32(lo, 16),
+                                         _mm_srai_epi32(hi, 16)));
+    }
+    S32toS16_C(d, s, n);
+}
+
+VLC_SSE2
+static void S32toFl32_SSE2(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    float *d = dst;
+    const __m128 scale = _mm_set1_ps(1.f / -((float)INT32_MIN));
+
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)s);
+
+        _mm_storeu_ps(d, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+    S32toFl32_C(d, s, n);
+}
+
+VLC_SSE2
+static void Fl64toFl32_SSE2(void *dst, const void *src, size_t n)
+{
+    const double *s = src;
+    float *d = dst;
+
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+    {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(s));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(s + 2));
+
+        _mm_storeu_ps(d, _mm_movelh_ps(lo, hi));
+    }
+    Fl64toFl32_C(d, s, n);
+}
+
+VLC_SSE2
+static void AmplifyFl32_SSE2(void *buf, size_t n, float gain)
+{
+    float *p = buf;
+    const __m128 mult = _mm_set1_ps(gain);
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), mult));
+        _mm_storeu_ps(p + 4, _mm_mul_ps(_mm_loadu_ps(p + 4), mult));
+    }
+    AmplifyFl32_C(p, n, gain);
+}
+
+VLC_SSE2
+static void AmplifyFl64_SSE2(void *buf, size_t n, float gain)
+{
+    double *p = buf;
+    const __m128d mult = _mm_set1_pd(gain);
+
+    for (; n >= 4; n -= 4, p += 4)
+    {
+        _mm_storeu_pd(p, _mm_mul_pd(_mm_loadu_pd(p), mult));
+        _mm_storeu_pd(p + 2, _mm_mul_pd(_mm_loadu_pd(p + 2), mult));
+    }
+    AmplifyFl64_C(p, n, gain);
+}
+#endif
+
+/*** AVX2 ***/
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void S16toFl32_AVX2(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    float *d = dst;
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+
+    for (; n >= 16; n -= 16, s += 16, d += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)s));
+        __m256i hi = _mm256_cvtepi16_epi32(
+                                _mm_loadu_si128((const __m128i *)(s + 8)));
+
+        _mm256_storeu_ps(d, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(d + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    S16toFl32_C(d, s, n);
+}
+
+VLC_AVX2
+static void S16toS32_AVX2(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    int32_t *d = dst;
+
+    for (; n >= 16; n -= 16, s += 16, d += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)s));
+        __m256i hi = _mm256_cvtepi16_epi32(
+                                _mm_loadu_si128((const __m128i *)(s + 8)));
+
+        _mm256_storeu_si256((__m256i *)d, _mm256_slli_epi32(lo, 16));
+        _mm256_storeu_si256((__m256i *)(d + 8), _mm256_slli_epi32(hi, 16));
+    }
+    S16toS32_C(d, s, n);
+}
+
+VLC_AVX2
+static void Fl32toS16_AVX2(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int16_t *d = dst;
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+
+    for (; n >= 16; n -= 16, s += 16, d += 16)
+    {
+        __m256 lo = _mm256_mul_ps(_mm256_loadu_ps(s), scale);
+        __m256 hi = _mm256_mul_ps(_mm256_loadu_ps(s + 8), scale);
+
+        lo = _mm256_min_ps(_mm256_max_ps(lo, min), max);
+        hi = _mm256_min_ps(_mm256_max_ps(hi, min), max);
+
+        /* Packing works per 128-bits lane: restore the sample order */
+        __m256i x = _mm256_packs_epi32(_mm256_cvtps_epi32(lo),
+                                       _mm256_cvtps_epi32(hi));
+        _mm256_storeu_si256((__m256i *)d,
+                            _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    Fl32toS16_C(d, s, n);
+}
+
+VLC_AVX2
+static void Fl32toS32_AVX2(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int32_t *d = dst;
+    const __m256 scale = _mm256_set1_ps(-((float)INT32_MIN));
+    const __m256 min = _mm256_set1_ps((float)INT32_MIN);
+    const __m256 half = _mm256_set1_ps(.5f);
+    const __m256 abs = _mm256_castsi256_ps(_mm256_set1_epi32(INT32_MAX));
+    const __m256i max = _mm256_set1_epi32(INT32_MAX);
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m256 v = _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(s), scale), min);
+        __m256i r = _mm256_cvttps_epi32(v);
+        __m256 frac = _mm256_sub_ps(v, _mm256_cvtepi32_ps(r));
+
+        /* Round half-way cases away from zero, as lroundf() does */
+        __m256i away = _mm256_srli_epi32(_mm256_castps_si256(
+            _mm256_cmp_ps(_mm256_and_ps(frac, abs), half, _CMP_GE_OQ)), 31);
+        __m256i sign = _mm256_srai_epi32(_mm256_castps_si256(frac), 31);
+        r = _mm256_add_epi32(r, _mm256_sub_epi32(_mm256_xor_si256(away, sign),
+                                                 sign));
+
+        /* Saturate positive overflows to INT32_MAX */
+        __m256 over = _mm256_cmp_ps(v, scale, _CMP_GE_OQ);
+        r = _mm256_blendv_epi8(r, max, _mm256_castps_si256(over));
+        _mm256_storeu_si256((__m256i *)d, r);
+    }
+    Fl32toS32_C(d, s, n);
+}
+
+VLC_AVX2
+static void Fl32toFl64_AVX2(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    double *d = dst;
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m256 x = _mm256_loadu_ps(s);
+
+        _mm256_storeu_pd(d, _mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+        _mm256_storeu_pd(d + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+    }
+    Fl32toFl64_C(d, s, n);
+}
+
+VLC_AVX2
+static void S32toS16_AVX2(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    int16_t *d = dst;
+
+    for (; n >= 16; n -= 16, s += 16, d += 16)
+    {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)s);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(s + 8));
+        __m256i x = _mm256_packs_epi32(_mm256_srai_epi32(lo, 16),
+                                       _mm256_srai_epi32(hi, 16));
+
+        _mm256_storeu_si256((__m256i *)d,
+                            _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    S32toS16_C(d, s, n);
+}
+
+VLC_AVX2
+static void S32toFl32_AVX2(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    float *d = dst;
+    const __m256 scale = _mm256_set1_ps(1.f / -((float)INT32_MIN));
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)s);
+
+        _mm256_storeu_ps(d, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    S32toFl32_C(d, s, n);
+}
+
+VLC_AVX2
+static void Fl64toFl32_AVX2(void *dst, const void *src, size_t n)
+{
+    const double *s = src;
+    float *d = dst;
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(s));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(s + 4));
+
+        _mm_storeu_ps(d, lo);
+        _mm_storeu_ps(d + 4, hi);
+    }
+    Fl64toFl32_C(d, s, n);
+}
+
+VLC_AVX2
+static void AmplifyFl32_AVX2(void *buf, size_t n, float gain)
+{
+    float *p = buf;
+    const __m256 mult = _mm256_set1_ps(gain);
+
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), mult));
+        _mm256_storeu_ps(p + 8, _mm256_mul_ps(_mm256_loadu_ps(p + 8), mult));
+    }
+    AmplifyFl32_C(p, n, gain);
+}
+
+VLC_AVX2
+static void AmplifyFl64_AVX2(void *buf, size_t n, float gain)
+{
+    double *p = buf;
+    const __m256d mult = _mm256_set1_pd(gain);
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        _mm256_storeu_pd(p, _mm256_mul_pd(_mm256_loadu_pd(p), mult));
+        _mm256_storeu_pd(p + 4, _mm256_mul_pd(_mm256_loadu_pd(p + 4), mult));
+    }
+    AmplifyFl64_C(p, n, gain);
+}
+#endif
+
+/*** NEON ***/
+#ifdef HAVE_NEON_INTRINSICS
+static void S16toFl32_NEON(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    float *d = dst;
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        int16x8_t x = vld1q_s16(s);
+
+        vst1q_f32(d, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))),
+                                 1.f / 32768.f));
+        vst1q_f32(d + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_high_s16(x)),
+                                     1.f / 32768.f));
+    }
+    S16toFl32_C(d, s, n);
+}
+
+static void S16toS32_NEON(void *dst, const void *src, size_t n)
+{
+    const int16_t *s = src;
+    int32_t *d = dst;
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        int16x8_t x = vld1q_s16(s);
+
+        vst1q_s32(d, vshll_n_s16(vget_low_s16(x), 16));
+        vst1q_s32(d + 4, vshll_high_n_s16(x, 16));
+    }
+    S16toS32_C(d, s, n);
+}
+
+static void Fl32toS16_NEON(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int16_t *d = dst;
+
+    /* Conversions round to nearest even and saturate */
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        int32x4_t lo = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(s), 32768.f));
+        int32x4_t hi = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(s + 4), 32768.f));
+
+        vst1q_s16(d, vqmovn_high_s32(vqmovn_s32(lo), hi));
+    }
+    Fl32toS16_C(d, s, n);
+}
+
+static void Fl32toS32_NEON(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    int32_t *d = dst;
+
+    /* Conversion rounds half-way cases away from zero and saturates */
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+        vst1q_s32(d, vcvtaq_s32_f32(vmulq_n_f32(vld1q_f32(s),
+                                                -((float)INT32_MIN))));
+    Fl32toS32_C(d, s, n);
+}
+
+static void Fl32toFl64_NEON(void *dst, const void *src, size_t n)
+{
+    const float *s = src;
+    double *d = dst;
+
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+    {
+        float32x4_t x = vld1q_f32(s);
+
+        vst1q_f64(d, vcvt_f64_f32(vget_low_f32(x)));
+        vst1q_f64(d + 2, vcvt_high_f64_f32(x));
+    }
+    Fl32toFl64_C(d, s, n);
+}
+
+static void S32toS16_NEON(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    int16_t *d = dst;
+
+    for (; n >= 8; n -= 8, s += 8, d += 8)
+    {
+        int32x4_t lo = vld1q_s32(s);
+        int32x4_t hi = vld1q_s32(s + 4);
+
+        vst1q_s16(d, vshrn_high_n_s32(vshrn_n_s32(lo, 16), hi, 16));
+    }
+    S32toS16_C(d, s, n);
+}
+
+static void S32toFl32_NEON(void *dst, const void *src, size_t n)
+{
+    const int32_t *s = src;
+    float *d = dst;
+
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+        vst1q_f32(d, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(s)),
+                                 1.f / -((float)INT32_MIN)));
+    S32toFl32_C(d, s, n);
+}
+
+static void Fl64toFl32_NEON(void *dst, const void *src, size_t n)
+{
+    const double *s = src;
+    float *d = dst;
+
+    for (; n >= 4; n -= 4, s += 4, d += 4)
+    {
+        float64x2_t lo = vld1q_f64(s);
+        float64x2_t hi = vld1q_f64(s + 2);
+
+        vst1q_f32(d, vcvt_high_f32_f64(vcvt_f32_f64(lo), hi));
+    }
+    Fl64toFl32_C(d, s, n);
+}
+
+static void AmplifyFl32_NEON(void *buf, size_t n, float gain)
+{
+    float *p = buf;
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        vst1q_f32(p, vmulq_n_f32(vld1q_f32(p), gain));
+        vst1q_f32(p + 4, vmulq_n_f32(vld1q_f32(p + 4), gain));
+    }
+    AmplifyFl32_C(p, n, gain);
+}
+
+static void AmplifyFl64_NEON(void *buf, size_t n, float gain)
+{
+    double *p = buf;
+    const double mult = gain;
+
+    for (; n >= 4; n -= 4, p += 4)
+    {
+        vst1q_f64(p, vmulq_n_f64(vld1q_f64(p), mult));
+        vst1q_f64(p + 2, vmulq_n_f64(vld1q_f64(p + 2), mult));
+    }
+    AmplifyFl64_C(p, n, gain);
+}
+#endif
+
+/*** Dispatch ***/
+struct pcm_amplifier
+{
+    vlc_fourcc_t format;
+    pcm_amplify_t amplify;
+};
+
+#define CONVERTERS(isa) \
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, 2, 4, S16toFl32_##isa }, \
+    { VLC_CODEC_S16N, VLC_CODEC_S32N, 2, 4, S16toS32_##isa }, \
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, 4, 2, Fl32toS16_##isa }, \
+    { VLC_CODEC_FL32, VLC_CODEC_S32N, 4, 4, Fl32toS32_##isa }, \
+    { VLC_CODEC_FL32, VLC_CODEC_FL64, 4, 8, Fl32toFl64_##isa }, \
+    { VLC_CODEC_S32N, VLC_CODEC_S16N, 4, 2, S32toS16_##isa }, \
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, 4, 4, S32toFl32_##isa }, \
+    { VLC_CODEC_FL64, VLC_CODEC_FL32, 8, 4, Fl64toFl32_##isa }, \
+    { 0, 0, 0, 0, NULL }
+
+#define AMPLIFIERS(isa) \
+    { VLC_CODEC_FL32, AmplifyFl32_##isa }, \
+    { VLC_CODEC_FL64, AmplifyFl64_##isa }, \
+    { 0, NULL }
+
+static const struct pcm_converter converters_c[] = { CONVERTERS(C) };
+static const struct pcm_amplifier amplifiers_c[] = { AMPLIFIERS(C) };
+#ifdef HAVE_SSE2_INTRINSICS
+static const struct pcm_converter converters_sse2[] = { CONVERTERS(SSE2) };
+static const struct pcm_amplifier amplifiers_sse2[] = { AMPLIFIERS(SSE2) };
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+static const struct pcm_converter converters_avx2[] = { CONVERTERS(AVX2) };
+static const struct pcm_amplifier amplifiers_avx2[] = { AMPLIFIERS(AVX2) };
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+static const struct pcm_converter converters_neon[] = { CONVERTERS(NEON) };
+static const struct pcm_amplifier amplifiers_neon[] = { AMPLIFIERS(NEON) };
+#endif
+
+static unsigned GetISA(void)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return 2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return 1;
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+    if (vlc_CPU_ARM_NEON())
+        return 3;
+#endif
+    return 0;
+}
+
+static const struct pcm_converter *GetConverters(unsigned isa)
+{
+    switch (isa)
+    {
+#ifdef HAVE_SSE2_INTRINSICS
+        case 1:
+            return converters_sse2;
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        case 2:
+            return converters_avx2;
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+        case 3:
+            return converters_neon;
+#endif
+        default:
+            return converters_c;
+    }
+}
+
+static const struct pcm_amplifier *GetAmplifiers(unsigned isa)
+{
+    switch (isa)
+    {
+#ifdef HAVE_SSE2_INTRINSICS
+        case 1:
+            return amplifiers_sse2;
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        case 2:
+            return amplifiers_avx2;
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+        case 3:
+            return amplifiers_neon;
+#endif
+        default:
+            return amplifiers_c;
+    }
+}
+
+const struct pcm_converter *pcm_FindConverter(vlc_fourcc_t src,
+                                              vlc_fourcc_t dst)
+{
+    for (const struct pcm_converter *cvt = GetConverters(GetISA());
+         cvt->convert != NULL; cvt++)
+        if (cvt->src == src && cvt->dst == dst)
+            return cvt;
+    return NULL;
+}
+
+pcm_amplify_t pcm_FindAmplifier(vlc_fourcc_t format)
+{
+    for (const struct pcm_amplifier *amp = GetAmplifiers(GetISA());
+         amp->amplify != NULL; amp++)
+        if (amp->format == format)
+            return amp->amplify;
+    return NULL;
+}
+
+#ifdef SAMPLES_TEST
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_rand.h>
+#include <vlc_tick.h>
+
+#define SAMPLES 4099 /* not a multiple of any vector size */
+#define ROUNDS 1000
+
+static const char *const isa_names[] = { "C", "SSE2", "AVX2", "NEON" };
+
+static bool IsAvailable(unsigned isa)
+{
+    switch (isa)
+    {
+        case 0:
+            return true;
+#ifdef HAVE_SSE2_INTRINSICS
+        case 1:
+            return vlc_CPU_SSE2();
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        case 2:
+            return vlc_CPU_AVX2();
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+        case 3:
+            return vlc_CPU_ARM_NEON();
+#endif
+        default:
+            return false;
+    }
+}
+
+/* Random samples, with the clipping and rounding corner cases first */
+static void FillSamples(void *buf, vlc_fourcc_t format, size_t n)
+{
+    static const float specials[] = {
+        0.f, -0.f, 1.f, -1.f, 1.5f, -1.5f, 2.f, -2.f, 1e10f, -1e10f,
+        32767.5f / 32768.f, -32768.5f / 32768.f, 0.5f / 32768.f,
+        -0.5f / 32768.f, 1.5f / 32768.f, -2.5f / 32768.f,
+        0x1.8p-31f, -0x1.8p-31f, 0x1.4p-30f, -0x1.4p-30f, 0x1p-32f,
+    };
+
+    vlc_rand_bytes(buf, n * (format == VLC_CODEC_S16N ? 2
+                           : format == VLC_CODEC_FL64 ? 8 : 4));
+
+    switch (format)
+    {
+        case VLC_CODEC_FL32:
+        {
+            float *p = buf;
+            for (size_t i = 0; i < n; i++)
+                p[i] = i < ARRAY_SIZE(specials) ? specials[i]
+                     : (vlc_lrand48() / (float)(1 << 30)) - 1.f;
+            break;
+        }
+        case VLC_CODEC_FL64:
+        {
+            double *p = buf;
+            for (size_t i = 0; i < n; i++)
+                p[i] = i < ARRAY_SIZE(specials) ? specials[i]
+                     : (vlc_lrand48() / (double)(1 << 30)) - 1.;
+            break;
+        }
+    }
+}
+
+static void TestConverter(const struct pcm_converter *ref,
+                          const struct pcm_converter *cvt, const char *isa)
+{
+    size_t ssize = SAMPLES * ref->src_size, dsize = SAMPLES * ref->dst_size;
+    unsigned char *src = malloc(ssize), *buf = malloc(ssize);
+    unsigned char *expected = malloc(dsize), *out = malloc(dsize);
+    assert(src && buf && expected && out);
+
+    FillSamples(src, ref->src, SAMPLES);
+    ref->convert(expected, src, SAMPLES);
+    cvt->convert(out, src, SAMPLES);
+    assert(!memcmp(expected, out, dsize));
+
+    if (ref->dst_size <= ref->src_size)
+    {   /* in place */
+        memcpy(buf, src, ssize);
+        cvt->convert(buf, buf, SAMPLES);
+        assert(!memcmp(expected, buf, dsize));
+    }
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < ROUNDS; i++)
+        cvt->convert(out, src, SAMPLES);
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    printf("%4.4s->%4.4s %-4s: %6.3f ns/sample\n",
+           (const char *)&ref->src, (const char *)&ref->dst, isa,
+           (double)NS_FROM_VLC_TICK(elapsed) / (ROUNDS * SAMPLES));
+    free(out);
+    free(expected);
+    free(buf);
+    free(src);
+}
+
+static void TestAmplifier(const struct pcm_amplifier *ref,
+                          const struct pcm_amplifier *amp, const char *isa)
+{
+    size_t size = SAMPLES * (ref->format == VLC_CODEC_FL64 ? 8 : 4);
+    unsigned char *expected = malloc(size), *out = malloc(size);
+    assert(expected && out);
+
+    FillSamples(expected, ref->format, SAMPLES);
+    memcpy(out, expected, size);
+    ref->amplify(expected, SAMPLES, .7071f);
+    amp->amplify(out, SAMPLES, .7071f);
+    assert(!memcmp(expected, out, size));
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < ROUNDS; i++)
+        amp->amplify(out, SAMPLES, (i & 1) ? 2.f : .5f);
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    printf("%4.4s gain  %-4s: %6.3f ns/sample\n",
+           (const char *)&ref->format, isa,
+           (double)NS_FROM_VLC_TICK(elapsed) / (ROUNDS * SAMPLES));
+    free(out);
+    free(expected);
+}
+
+int main(void)
+{
+#ifndef _WIN32
+    alarm(10);
+#endif
+    for (unsigned isa = 0; isa < ARRAY_SIZE(isa_names); isa++)
+    {
+        if (!IsAvailable(isa))
+        {
+            printf("%s: not available\n", isa_names[isa]);
+            continue;
+        }
+
+        const struct pcm_converter *cvt = GetConverters(isa);
+        for (size_t i = 0; converters_c[i].convert != NULL; i++)
+        {
+            assert(cvt[i].src == converters_c[i].src
+                && cvt[i].dst == converters_c[i].dst);
+            TestConverter(&converters_c[i], &cvt[i], isa_names[isa]);
+        }
+
+        const struct pcm_amplifier *amp = GetAmplifiers(isa);
+        for (size_t i = 0; amplifiers_c[i].amplify != NULL; i++)
+        {
+            assert(amp[i].format == amplifiers_c[i].format);
+            TestAmplifier(&amplifiers_c[i], &amp[i], isa_names[isa]);
+        }
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * samples.h : PCM sample conversion and amplification kernels
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_SAMPLES_H
+#define VLC_AUDIO_SAMPLES_H
+
+/**
+ * Converts samples from one format to another.
+ *
+ * The destination may alias the source if the destination sample size is not
+ * larger than the source sample size.
+ */
+typedef void (*pcm_convert_t)(void *dst, const void *src, size_t samples);
+
+/**
+ * Multiplies samples in place by a gain.
+ */
+typedef void (*pcm_amplify_t)(void *buf, size_t samples, float gain);
+
+struct pcm_converter
+{
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+    unsigned char src_size; /**< source sample size (bytes) */
+    unsigned char dst_size; /**< destination sample size (bytes) */
+    pcm_convert_t convert;
+};
+
+/**
+ * Finds the fastest converter for the CPU.
+ *
+ * \return a converter or NULL if the pair has no vectorizable kernel
+ */
+const struct pcm_converter *pcm_FindConverter(vlc_fourcc_t src,
+                                              vlc_fourcc_t dst);
+
+/**
+ * Finds the fastest amplifier for the CPU.
+ *
+ * \return an amplifier or NULL if the format is not supported
+ */
+pcm_amplify_t pcm_FindAmplifier(vlc_fourcc_t format);
+
+#endif
@@ -34,6 +34,8 @@
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#include "../audio_filter/converter/samples.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -49,6 +51,16 @@ vlc_module_begin ()
     set_callback( Create )
 vlc_module_end ()
 
+static vlc_once_t once = VLC_STATIC_ONCE;
+static pcm_amplify_t amplify_fl32, amplify_fl64;
+
+static void InitKernels( void *data )
+{
+    amplify_fl32 = pcm_FindAmplifier( VLC_CODEC_FL32 );
+    amplify_fl64 = pcm_FindAmplifier( VLC_CODEC_FL64 );
+    (void) data;
+}
+
 /**
  * Mixes a new output buffer
  */
@@ -58,24 +70,19 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
     if( f_multiplier == 1.f )
         return; /* nothing to do */
 
-    float *p = (float *)p_buffer->p_buffer;
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= f_multiplier;
-
+    amplify_fl32( p_buffer->p_buffer, p_buffer->i_buffer / sizeof (float),
+                  f_multiplier );
     (void) p_volume;
 }
 
 static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
-    double *p = (double *)p_buffer->p_buffer;
-    double mult = f_multiplier;
-    if( mult == 1. )
+    if( f_multiplier == 1.f )
         return; /* nothing to do */
 
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= mult;
-
+    amplify_fl64( p_buffer->p_buffer, p_buffer->i_buffer / sizeof (double),
+                  f_multiplier );
     (void) p_volume;
 }
 
@@ -97,5 +104,8 @@ static int Create( vlc_object_t *p_this )
         default:
             return -1;
     }
+
+    /* The vector kernels only depend on the CPU */
+    vlc_once( &once, InitKernels, NULL );
     return 0;
 }
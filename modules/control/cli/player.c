@@ -869,6 +869,10 @@ static int Statistics(struct cli_client *cl, const char *const *args,
                    (float)(item->p_stats->i_read_bytes) / 1024.f);
         cli_printf(cl, _("| input bitrate    :   %6.0f kb/s"),
                    (float)(item->p_stats->f_input_bitrate) * 8000.f);
+        cli_printf(cl, _("| cache hits       :    %5"PRIi64),
+                   item->p_stats->i_cache_hits);
+        cli_printf(cl, _("| cache misses     :    %5"PRIi64),
+                   item->p_stats->i_cache_misses);
         cli_printf(cl, _("| demux bytes read : %8.0f KiB"),
                    (float)(item->p_stats->i_demux_read_bytes) / 1024.f);
         cli_printf(cl, _("| demux bitrate    :   %6.0f kb/s"),
@@ -889,6 +893,8 @@ static int Statistics(struct cli_client *cl, const char *const *args,
                    item->p_stats->i_late_pictures);
         cli_printf(cl, _("| frames lost      :    %5"PRIi64),
                    item->p_stats->i_lost_pictures);
+        cli_printf(cl, _("| picture waits    :    %5"PRIi64),
+                   item->p_stats->i_pool_waits);
         cli_printf(cl, "|");
 
         /* Audio*/
@@ -27,6 +27,8 @@
 #include "http/HTTPConnection.hpp"
 #include "encryption/Keyring.hpp"
 
+#include <algorithm>
+
 using namespace adaptive;
 
 SharedResources::SharedResources(AuthStorage *auth, Keyring *ring,
@@ -64,7 +66,9 @@ SharedResources * SharedResources::createDefault(vlc_object_t *obj,
 {
     AuthStorage *auth = new AuthStorage(obj);
     Keyring *keyring = new Keyring(obj);
-    HTTPConnectionManager *m = new HTTPConnectionManager(obj);
+    int64_t downloaders = var_InheritInteger(obj, "adaptive-downloaders");
+    HTTPConnectionManager *m = new HTTPConnectionManager(obj,
+                                                         std::max(downloaders, INT64_C(1)));
     if(!var_InheritBool(obj, "adaptive-use-access")) /* only use http from access */
         m->addFactory(new LibVLCHTTPConnectionFactory(auth));
     m->addFactory(new StreamUrlConnectionFactory());
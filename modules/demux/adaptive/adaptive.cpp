@@ -84,6 +84,10 @@ static void Close   (vlc_object_t *);
 #define ADAPT_LOWLATENCY_TEXT N_("Low latency")
 #define ADAPT_LOWLATENCY_LONGTEXT N_("Overrides low latency parameters")
 
+#define ADAPT_DOWNLOADERS_TEXT N_("Parallel downloads")
+#define ADAPT_DOWNLOADERS_LONGTEXT N_("Number of segments downloaded " \
+    "concurrently, so that the elementary streams do not wait on each other")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::LogicType::Default,
                                 AbstractAdaptationLogic::LogicType::Predictive,
@@ -143,6 +147,9 @@ vlc_module_begin ()
                      ADAPT_MAXBUFFER_TEXT, nullptr );
         add_integer( "adaptive-lowlatency", -1, ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT );
             change_integer_list(rgi_latency, ppsz_latency)
+        add_integer( "adaptive-downloaders", 2,
+                     ADAPT_DOWNLOADERS_TEXT, ADAPT_DOWNLOADERS_LONGTEXT )
+            change_integer_range( 1, 8 )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
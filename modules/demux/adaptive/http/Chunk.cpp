@@ -371,6 +371,12 @@ bool HTTPChunkBufferedSource::isDone() const
     return done;
 }
 
+size_t HTTPChunkBufferedSource::getUnreadSize() const
+{
+    mutex_locker locker {lock};
+    return buffered - consumed;
+}
+
 void HTTPChunkBufferedSource::hold()
 {
     mutex_locker locker {lock};
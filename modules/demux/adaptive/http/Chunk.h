@@ -172,6 +172,7 @@ namespace adaptive
                                         bool = false);
                 void               bufferize(size_t);
                 bool               isDone() const;
+                size_t             getUnreadSize() const;
                 void               hold();
                 void               release();
 
@@ -29,38 +29,46 @@
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned count)
 {
     killed = false;
-    thread_handle_valid = false;
-    current = nullptr;
-    cancel_current = false;
+    workers.resize(count ? count : 1);
+    for(Worker &w : workers)
+    {
+        w.downloader = this;
+        w.thread_handle_valid = false;
+        w.cancel_current = false;
+        w.current = nullptr;
+    }
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread, static_cast<void *>(this)))
+    bool started = false;
+    for(Worker &w : workers)
     {
-        return false;
+        if(!w.thread_handle_valid &&
+           !vlc_clone(&w.thread_handle, downloaderThread, static_cast<void *>(&w)))
+            w.thread_handle_valid = true;
+        started |= w.thread_handle_valid;
     }
-    thread_handle_valid = true;
-    return true;
+    return started;
 }
 
 Downloader::~Downloader()
 {
     kill();
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, nullptr);
+    for(Worker &w : workers)
+        if(w.thread_handle_valid)
+            vlc_join(w.thread_handle, nullptr);
 }
 
 void Downloader::kill()
 {
     vlc::threads::mutex_locker locker {lock};
     killed = true;
-    wait_cond.signal();
+    wait_cond.broadcast();
 }
 
 void Downloader::schedule(HTTPChunkBufferedSource *source)
@@ -74,9 +82,10 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc::threads::mutex_locker locker {lock};
-    while (current == source)
+    Worker *w;
+    while ((w = getWorker(source)))
     {
-        cancel_current = true;
+        w->cancel_current = true;
         updated_cond.wait(lock);
     }
 
@@ -87,21 +96,67 @@ void Downloader::cancel(HTTPChunkBufferedSource *source)
     }
 }
 
+Downloader::Worker * Downloader::getWorker(const HTTPChunkBufferedSource *source)
+{
+    for(Worker &w : workers)
+        if(w.current == source)
+            return &w;
+    return nullptr;
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource()
+{
+    /* Sources are downloaded one read at a time so that no stream
+     * starves the others. Streams without a download in progress come
+     * first, then the source with the least unread data, as its reader
+     * is the closest to running dry. Queue order breaks ties. */
+    HTTPChunkBufferedSource *best = nullptr;
+    bool bestidle = false;
+    size_t bestunread = 0;
+
+    for(HTTPChunkBufferedSource *source : chunks)
+    {
+        if(getWorker(source))
+            continue;
+
+        bool idle = true;
+        for(const Worker &w : workers)
+        {
+            if(w.current && w.current->sourceid == source->sourceid)
+            {
+                idle = false;
+                break;
+            }
+        }
+
+        size_t unread = source->getUnreadSize();
+        if(!best || (idle && !bestidle) ||
+           (idle == bestidle && unread < bestunread))
+        {
+            best = source;
+            bestidle = idle;
+            bestunread = unread;
+        }
+    }
+    return best;
+}
+
 void * Downloader::downloaderThread(void *opaque)
 {
     vlc_thread_set_name("vlc-adapt-dl");
-    Downloader *instance = static_cast<Downloader *>(opaque);
-    instance->Run();
+    Worker *worker = static_cast<Worker *>(opaque);
+    worker->downloader->Run(worker);
     return nullptr;
 }
 
-void Downloader::Run()
+void Downloader::Run(Worker *worker)
 {
     while(1)
     {
         lock.lock();
 
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source = nullptr;
+        while(!killed && !(source = getNextSource()))
             wait_cond.wait(lock);
 
         if(killed)
@@ -110,18 +165,18 @@ void Downloader::Run()
             break;
         }
 
-        current = chunks.front();
+        worker->current = source;
         lock.unlock();
-        current->bufferize(HTTPChunkSource::CHUNK_SIZE);
+        source->bufferize(HTTPChunkSource::CHUNK_SIZE);
         lock.lock();
-        if(current->isDone() || cancel_current)
+        if(source->isDone() || worker->cancel_current)
         {
-            chunks.pop_front();
-            current->release();
+            chunks.remove(source);
+            source->release();
         }
-        cancel_current = false;
-        current = nullptr;
-        updated_cond.signal();
+        worker->cancel_current = false;
+        worker->current = nullptr;
+        updated_cond.broadcast();
         lock.unlock();
     }
 }
@@ -72,12 +72,13 @@ void AbstractConnectionManager::deleteSource(AbstractChunkSource *source)
     delete source;
 }
 
-HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_)
+HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_,
+                                                 unsigned downloaders)
     : AbstractConnectionManager( p_object_ ),
       localAllowed(false)
 {
     vlc_mutex_init(&lock);
-    downloader = new Downloader();
+    downloader = new Downloader(downloaders);
     downloaderhp = new Downloader();
     downloader->start();
     downloaderhp->start();
@@ -76,7 +76,8 @@ namespace adaptive
         class HTTPConnectionManager : public AbstractConnectionManager
         {
             public:
-                HTTPConnectionManager           (vlc_object_t *p_object);
+                HTTPConnectionManager           (vlc_object_t *p_object,
+                                                 unsigned downloaders = 1);
                 virtual ~HTTPConnectionManager  ();
 
                 virtual void    closeAllConnections ()  override;
@@ -194,6 +194,7 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, stime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static unsigned SkipDiscardablePackets( demux_t *p_demux, unsigned i_max );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
@@ -646,6 +647,13 @@ static int Demux( demux_t *p_demux )
         bool         b_frame = false;
         int          i_header = 0;
         block_t     *p_pkt;
+
+        /* Consume runs of packets we would drop anyway without reading them
+         * into individual blocks */
+        i_pkt += SkipDiscardablePackets( p_demux, p_sys->i_ts_read - i_pkt );
+        if( i_pkt >= p_sys->i_ts_read )
+            break;
+
         if( !(p_pkt = ReadTSPacket( p_demux )) )
         {
             return VLC_DEMUXER_EOF;
@@ -1876,6 +1884,90 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+/* Tells if the packet would be dropped by the regular packet path without any
+ * side effect (unselected ES, unreferenced or null PID), so that it does not
+ * need to be read into its own block. */
+static bool IsDiscardablePacket( demux_sys_t *p_sys, const uint8_t *p )
+{
+    if( p[0] != 0x47 || (p[1] & 0x80) ) /* lost sync or transport error */
+        return false;
+
+    ts_pid_t *p_pid = GetPID( p_sys, ((p[1] & 0x1f) << 8) | p[2] );
+    if( !SEEN(p_pid) )
+        return false;
+
+    switch( p_pid->type )
+    {
+        case TYPE_FREE:
+            break;
+        case TYPE_STREAM:
+            if( p_pid->i_flags & FLAG_FILTERED )
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    /* Scrambling state changes must still be signaled */
+    if( !SCRAMBLED(*p_pid) != !(p[3] & 0xc0) )
+        return false;
+
+    /* PCR are always handled */
+    if( (p[3] & 0x20) && p[4] > 0 && (p[5] & 0x10) )
+        return false;
+
+    return true;
+}
+
+/* Skips the run of packets the regular path would drop, with a single read.
+ * This is the only batching done: packets of selected ES are still read and
+ * dispatched one by one, as GatherPESData() and GatherSectionsData() keep
+ * each packet as its own block in the PES/section chain until the payload
+ * is complete, and block_t has no way to hand out per-packet views of a
+ * single read buffer. Headers are checked with plain loads: they sit at a
+ * 188/192/204 bytes stride, which does not map to vector loads. */
+static unsigned SkipDiscardablePackets( demux_t *p_demux, unsigned i_max )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+    const unsigned i_header = p_sys->i_packet_header_size;
+    const uint8_t *p_peek;
+
+    if( i_max == 0 || p_sys->b_access_control || p_sys->csa ||
+        p_sys->b_start_record || !p_sys->b_end_preparse ||
+        p_sys->es_creation == DELAY_ES || !SEEN(GetPID( p_sys, 0 )) )
+        return 0;
+
+    /* Only check the next packet first, so we don't grow the peek buffer
+     * in the common case where it has to be processed */
+    if( vlc_stream_Peek( p_sys->stream, &p_peek, i_size ) < (ssize_t) i_size ||
+        !IsDiscardablePacket( p_sys, &p_peek[i_header] ) )
+        return 0;
+
+    ssize_t i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
+                                      (size_t) i_size * i_max );
+    if( i_peek < (ssize_t) i_size )
+        return 0;
+
+    const unsigned i_avail = i_peek / i_size;
+    unsigned i_count = 0;
+    for( ; i_count < i_avail; i_count++ )
+    {
+        const uint8_t *p = &p_peek[i_count * i_size + i_header];
+        if( !IsDiscardablePacket( p_sys, p ) )
+            break;
+        /* Unselected ES data is not continuity checked anymore. Restart
+         * the counter so selecting it later does not flag a discontinuity */
+        GetPID( p_sys, ((p[1] & 0x1f) << 8) | p[2] )->i_cc = 0xff;
+    }
+
+    ssize_t i_read = vlc_stream_Read( p_sys->stream, NULL,
+                                      (size_t) i_count * i_size );
+    if( i_read < 0 )
+        return 0;
+    return i_read / i_size;
+}
+
 static stime_t GetPCR( const block_t *p_pkt )
 {
     const uint8_t *p = p_pkt->p_buffer;
@@ -0,0 +1,588 @@
+/*****************************************************************************
+ * async.c: asynchronous logger stage
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_modules.h>
+#include <vlc_atomic.h>
+#include <vlc_list.h>
+
+/*
+ * Messages are formatted by the emitting thread into a fixed-size slot of a
+ * per-thread lock-free ring, then handed over to the actual logger module by
+ * a single writer thread. Emitting threads therefore never block on the
+ * output (console, file, journal...) nor on the output logger locks.
+ *
+ * A global serial number preserves the overall ordering of the messages.
+ * The ring of an exited thread is freed by the writer thread once drained.
+ */
+
+/* Number of slots of each per-thread ring, must be a power of two */
+#define RING_SLOTS 128
+/* Size of the inline message text; longer messages are allocated */
+#define TEXT_SIZE 256
+/* Number of rate limiting buckets */
+#define RATE_BUCKETS 64
+
+struct async_msg
+{
+    uint64_t serial;
+    int type;
+    vlc_log_t meta;
+    char *header;
+    char *heap; /**< Message text, if too long for the slot */
+    char module[32];
+    char text[TEXT_SIZE];
+};
+
+struct log_ring
+{
+    struct vlc_list node;
+
+    atomic_size_t head; /* only written by the logging thread */
+    atomic_size_t tail; /* only written by the writer thread */
+    atomic_bool exited; /* the logging thread exited, free once drained */
+
+    /* Writer thread state of the current drain pass */
+    size_t drain_head;
+    bool drain_exited;
+
+    struct async_msg slots[RING_SLOTS];
+};
+
+struct async_rate
+{
+    _Atomic int64_t window; /**< Current rate limiting window (seconds) */
+    atomic_uint count; /**< Messages in the current window */
+};
+
+typedef struct
+{
+    struct async_rate rates[RATE_BUCKETS];
+
+    vlc_mutex_t lock;
+    struct vlc_list rings;
+    vlc_threadvar_t ring_key; /* ring of the calling thread */
+
+    /* Messages of the current drain pass (writer thread only) */
+    struct async_msg **batch;
+    size_t batch_size;
+
+    _Atomic uint64_t serial;
+    atomic_uint idle;
+    atomic_bool closing;
+    atomic_ulong dropped_full;
+    atomic_ulong dropped_rate;
+
+    int verbosity;
+    unsigned rate;
+
+    vlc_thread_t thread;
+    vlc_object_t *sink_obj;
+    const struct vlc_logger_operations *sink_ops;
+    void *sink_opaque;
+} vlc_logger_sys_t;
+
+static void ReleaseRing(void *data)
+{
+    struct log_ring *ring = data;
+
+    /* The writer thread frees it after the last drain */
+    atomic_store_explicit(&ring->exited, true, memory_order_release);
+}
+
+static struct log_ring *GetRing(vlc_logger_sys_t *sys)
+{
+    struct log_ring *ring = vlc_threadvar_get(sys->ring_key);
+    if (likely(ring != NULL))
+        return ring;
+
+    ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->exited, false);
+    ring->drain_head = 0;
+    ring->drain_exited = false;
+
+    if (vlc_threadvar_set(sys->ring_key, ring))
+    {
+        free(ring);
+        return NULL;
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_append(&ring->node, &sys->rings);
+    vlc_mutex_unlock(&sys->lock);
+    return ring;
+}
+
+static uint32_t ModuleHash(const char *module)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+
+    while (*module)
+        h = (h ^ (unsigned char)*(module++)) * 16777619u;
+    return h;
+}
+
+/**
+ * Accounts a message against the rate limit of its module.
+ * Modules are hashed to a fixed number of buckets; colliding modules share
+ * their budget.
+ */
+static bool RateCheck(vlc_logger_sys_t *sys, const char *module)
+{
+    struct async_rate *rate =
+        &sys->rates[ModuleHash(module) % RATE_BUCKETS];
+    int64_t now = SEC_FROM_VLC_TICK(vlc_tick_now());
+    int64_t window = atomic_load_explicit(&rate->window,
+                                          memory_order_relaxed);
+
+    if (window != now
+     && atomic_compare_exchange_strong_explicit(&rate->window, &window, now,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed))
+        atomic_store_explicit(&rate->count, 0, memory_order_relaxed);
+
+    return atomic_fetch_add_explicit(&rate->count, 1,
+                                     memory_order_relaxed) < sys->rate;
+}
+
+static void Log(void *opaque, int type, const vlc_log_t *meta,
+                const char *format, va_list ap)
+{
+    vlc_logger_sys_t *sys = opaque;
+
+    if (sys->verbosity < type)
+        return;
+
+    if (sys->rate > 0 && type != VLC_MSG_ERR
+     && !RateCheck(sys, meta->psz_module))
+    {
+        atomic_fetch_add_explicit(&sys->dropped_rate, 1,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    struct log_ring *ring = GetRing(sys);
+    if (unlikely(ring == NULL))
+        return;
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail >= RING_SLOTS)
+    {   /* Ring full: the writer thread is lagging behind */
+        atomic_fetch_add_explicit(&sys->dropped_full, 1,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    struct async_msg *msg = &ring->slots[head & (RING_SLOTS - 1)];
+
+    /* Fill the slot. Object types, file and function names are static. */
+    msg->serial = atomic_fetch_add_explicit(&sys->serial, 1,
+                                            memory_order_relaxed);
+    msg->type = type;
+    msg->meta = *meta;
+    strlcpy(msg->module, meta->psz_module, sizeof (msg->module));
+    msg->header = (meta->psz_header != NULL) ? strdup(meta->psz_header)
+                                             : NULL;
+    msg->heap = NULL;
+
+    va_list aq;
+    va_copy(aq, ap);
+
+    int len = vsnprintf(msg->text, sizeof (msg->text), format, ap);
+    if (unlikely(len >= (int)sizeof (msg->text)))
+    {
+        msg->heap = malloc(len + 1);
+        if (msg->heap != NULL)
+            vsnprintf(msg->heap, len + 1, format, aq);
+    }
+    va_end(aq);
+
+    /* Publish the slot, and wake the writer thread up if needed */
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    if (atomic_exchange(&sys->idle, 0))
+        vlc_atomic_notify_one(&sys->idle);
+}
+
+static void Emit(vlc_logger_sys_t *sys, int type, const vlc_log_t *meta,
+                 const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    sys->sink_ops->log(sys->sink_opaque, type, meta, format, ap);
+    va_end(ap);
+}
+
+/**
+ * Returns whether a ring has published slots.
+ */
+static bool Published(struct log_ring *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    return head != tail;
+}
+
+static int SerialCmp(const void *a, const void *b)
+{
+    const struct async_msg *ma = *(struct async_msg *const *)a;
+    const struct async_msg *mb = *(struct async_msg *const *)b;
+
+    return (ma->serial > mb->serial) - (ma->serial < mb->serial);
+}
+
+/**
+ * Collects the published slots of a ring into the current batch.
+ */
+static void Collect(vlc_logger_sys_t *sys, struct log_ring *ring,
+                    size_t *restrict count)
+{
+    /* Checked first: once exited, the thread has logged its last message */
+    ring->drain_exited = atomic_load_explicit(&ring->exited,
+                                              memory_order_acquire);
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t n = head - tail;
+
+    if (*count + n > sys->batch_size)
+    {
+        size_t size = sys->batch_size + RING_SLOTS;
+        struct async_msg **batch = vlc_reallocarray(sys->batch, size,
+                                                    sizeof (*batch));
+        if (unlikely(batch == NULL))
+        {   /* Leave the rest of the ring to the next pass */
+            n = sys->batch_size - *count;
+            head = tail + n;
+            ring->drain_exited = false;
+        }
+        else
+        {
+            sys->batch = batch;
+            sys->batch_size = size;
+        }
+    }
+
+    for (size_t i = tail; i != head; i++)
+        sys->batch[(*count)++] = &ring->slots[i & (RING_SLOTS - 1)];
+    ring->drain_head = head;
+}
+
+/**
+ * Outputs all the published messages, in emission order.
+ * \return the number of messages output
+ */
+static size_t Drain(vlc_logger_sys_t *sys)
+{
+    struct log_ring *ring;
+    size_t count = 0;
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_foreach(ring, &sys->rings, node)
+        Collect(sys, ring, &count);
+    vlc_mutex_unlock(&sys->lock);
+
+    if (count == 0)
+        return 0;
+
+    /* The slots are only reused once released below: output them without
+     * holding the lock, so that new threads never wait for the sink. */
+    qsort(sys->batch, count, sizeof (*sys->batch), SerialCmp);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        struct async_msg *msg = sys->batch[i];
+        vlc_log_t meta = msg->meta;
+
+        meta.psz_module = msg->module;
+        meta.psz_header = msg->header;
+
+        Emit(sys, msg->type, &meta, "%s",
+             (msg->heap != NULL) ? msg->heap : msg->text);
+        free(msg->heap);
+        free(msg->header);
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_foreach(ring, &sys->rings, node)
+    {
+        atomic_store_explicit(&ring->tail, ring->drain_head,
+                              memory_order_release);
+        if (ring->drain_exited)
+        {
+            vlc_list_remove(&ring->node);
+            free(ring);
+        }
+    }
+    vlc_mutex_unlock(&sys->lock);
+    return count;
+}
+
+static bool Pending(vlc_logger_sys_t *sys)
+{
+    struct log_ring *ring;
+    bool pending = false;
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_foreach(ring, &sys->rings, node)
+        if (Published(ring))
+        {
+            pending = true;
+            break;
+        }
+    vlc_mutex_unlock(&sys->lock);
+    return pending;
+}
+
+static void ReportDrops(vlc_logger_sys_t *sys, unsigned long *restrict full,
+                        unsigned long *restrict rate)
+{
+    unsigned long f = atomic_load_explicit(&sys->dropped_full,
+                                           memory_order_relaxed);
+    unsigned long r = atomic_load_explicit(&sys->dropped_rate,
+                                           memory_order_relaxed);
+
+    if (f == *full && r == *rate)
+        return;
+
+    const vlc_log_t meta = {
+        .i_object_id = 0,
+        .psz_object_type = "logger",
+        .psz_module = "async",
+        .psz_header = NULL,
+        .file = __FILE__,
+        .line = __LINE__,
+        .func = __func__,
+        .tid = vlc_thread_id(),
+    };
+
+    Emit(sys, VLC_MSG_WARN, &meta,
+         "%lu message(s) dropped (queue full), %lu (rate limit)",
+         f - *full, r - *rate);
+    *full = f;
+    *rate = r;
+}
+
+static void *Thread(void *data)
+{
+    vlc_logger_sys_t *sys = data;
+    unsigned long full = 0, rate = 0;
+
+    vlc_thread_set_name("vlc-logger");
+
+    for (;;)
+    {
+        bool closing = atomic_load(&sys->closing);
+
+        if (Drain(sys) > 0)
+            continue;
+
+        ReportDrops(sys, &full, &rate);
+
+        if (closing)
+            break;
+
+        atomic_store(&sys->idle, 1);
+        if (!Pending(sys) && !atomic_load(&sys->closing))
+            vlc_atomic_wait(&sys->idle, 1);
+        atomic_store(&sys->idle, 0);
+    }
+    return NULL;
+}
+
+static int LoadSink(void *func, bool forced, va_list ap)
+{
+    const struct vlc_logger_operations *(*activate)(vlc_object_t *,
+                                                    void **) = func;
+    vlc_logger_sys_t *sys = va_arg(ap, vlc_logger_sys_t *);
+
+    (void) forced;
+    sys->sink_ops = activate(sys->sink_obj, &sys->sink_opaque);
+    return (sys->sink_ops != NULL) ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+static void Close(void *opaque)
+{
+    vlc_logger_sys_t *sys = opaque;
+
+    /* No more ring destructor calls from exiting threads */
+    vlc_threadvar_delete(&sys->ring_key);
+
+    atomic_store(&sys->closing, true);
+    atomic_store(&sys->idle, 0);
+    vlc_atomic_notify_one(&sys->idle);
+    vlc_join(sys->thread, NULL);
+
+    if (sys->sink_ops->destroy != NULL)
+        sys->sink_ops->destroy(sys->sink_opaque);
+    vlc_object_delete(sys->sink_obj);
+
+    struct log_ring *ring;
+
+    vlc_list_foreach(ring, &sys->rings, node)
+        free(ring);
+    free(sys->batch);
+    free(sys);
+}
+
+static const struct vlc_logger_operations ops =
+{
+    Log,
+    Close
+};
+
+static const struct vlc_logger_operations *Open(vlc_object_t *obj,
+                                                void **restrict sysp)
+{
+    if (!var_InheritBool(obj, "log-async"))
+        return NULL;
+
+    int verbosity = var_InheritInteger(obj, "log-async-verbose");
+    if (verbosity == -1)
+        verbosity = var_InheritInteger(obj, "verbose");
+    if (verbosity < 0)
+        return NULL; /* nothing to log */
+
+    vlc_logger_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return NULL;
+
+    if (vlc_threadvar_create(&sys->ring_key, ReleaseRing))
+    {
+        free(sys);
+        return NULL;
+    }
+
+    vlc_mutex_init(&sys->lock);
+    vlc_list_init(&sys->rings);
+    sys->batch = NULL;
+    sys->batch_size = 0;
+
+    for (size_t i = 0; i < RATE_BUCKETS; i++)
+    {
+        atomic_init(&sys->rates[i].window, 0);
+        atomic_init(&sys->rates[i].count, 0);
+    }
+
+    atomic_init(&sys->serial, 0);
+    atomic_init(&sys->idle, 0);
+    atomic_init(&sys->closing, false);
+    atomic_init(&sys->dropped_full, 0);
+    atomic_init(&sys->dropped_rate, 0);
+    sys->verbosity = verbosity + VLC_MSG_ERR;
+    sys->rate = var_InheritInteger(obj, "log-async-rate");
+
+    /* Load the actual logger, excluding this module */
+    sys->sink_obj = vlc_object_create(obj, sizeof (*sys->sink_obj));
+    if (unlikely(sys->sink_obj == NULL))
+        goto error;
+
+    var_Create(sys->sink_obj, "log-async", VLC_VAR_BOOL);
+
+    char *name = var_InheritString(obj, "log-async-module");
+    module_t *module = vlc_module_load(sys->sink_obj, "logger", name, false,
+                                       LoadSink, sys);
+    free(name);
+    if (module == NULL)
+        goto error;
+
+    if (vlc_clone(&sys->thread, Thread, sys))
+    {
+        if (sys->sink_ops->destroy != NULL)
+            sys->sink_ops->destroy(sys->sink_opaque);
+        goto error;
+    }
+
+    *sysp = sys;
+    return &ops;
+
+error:
+    if (sys->sink_obj != NULL)
+        vlc_object_delete(sys->sink_obj);
+    vlc_threadvar_delete(&sys->ring_key);
+    free(sys);
+    return NULL;
+}
+
+#define ASYNC_TEXT N_("Asynchronous logging")
+#define ASYNC_LONGTEXT N_("Hand log messages over to a background thread " \
+    "rather than writing them from the emitting thread. This reduces the " \
+    "impact of verbose logging on playback.")
+
+#define ASYNC_MODULE_TEXT N_("Asynchronous logger output")
+#define ASYNC_MODULE_LONGTEXT N_("Logger module to hand the messages over " \
+    "to from the background thread.")
+
+#define ASYNC_VERBOSE_TEXT N_("Verbosity")
+#define ASYNC_VERBOSE_LONGTEXT N_("Messages above this verbosity are " \
+    "discarded before being queued, or default to use the same verbosity " \
+    "given by --verbose.")
+
+#define ASYNC_RATE_TEXT N_("Rate limit per module")
+#define ASYNC_RATE_LONGTEXT N_("Maximum number of non-error messages per " \
+    "second and per module (0 = unlimited).")
+
+static const int verbosity_values[] = {
+    -1,
+    VLC_MSG_INFO,
+    VLC_MSG_ERR,
+    VLC_MSG_WARN,
+    VLC_MSG_DBG
+};
+
+static const char *const verbosity_text[] = { N_("Default"), N_("Info"), N_("Error"), N_("Warning"), N_("Debug") };
+
+vlc_module_begin()
+    set_shortname(N_("Async log"))
+    set_description(N_("Asynchronous logger"))
+    set_subcategory(SUBCAT_ADVANCED_MISC)
+    set_capability("logger", 100)
+    set_callback(Open)
+
+    add_bool("log-async", false, ASYNC_TEXT, ASYNC_LONGTEXT)
+    add_module("log-async-module", "logger", "any",
+               ASYNC_MODULE_TEXT, ASYNC_MODULE_LONGTEXT)
+    add_integer("log-async-verbose", -1, ASYNC_VERBOSE_TEXT,
+                ASYNC_VERBOSE_LONGTEXT)
+        change_integer_list(verbosity_values, verbosity_text)
+    add_integer_with_range("log-async-rate", 0, 0, 100000, ASYNC_RATE_TEXT,
+                           ASYNC_RATE_LONGTEXT)
+vlc_module_end ()
@@ -0,0 +1,610 @@
+/*****************************************************************************
+ * binary.c: binary structured logger
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The log is a sequence of records, each prefixed with its payload size as a
+ * 32-bits little endian integer. Integers within records are unsigned LEB128
+ * variable-length integers.
+ *
+ * The first byte of the payload is the record type:
+ * - 0xFF: session header, followed by the "VLCBLOG" magic, the format version
+ *   (one byte), the tick frequency and the session start tick.
+ *   A new header is written whenever the logger is started, so that multiple
+ *   sessions can be appended to a single file.
+ * - VLC_MSG_INFO to VLC_MSG_DBG: message, followed by:
+ *   - the tick delta from the previous record (the header for the first one),
+ *   - the thread ID,
+ *   - the object ID,
+ *   - the object type, module, header and source file name strings,
+ *   - the source line number plus one,
+ *   - the function name string,
+ *   - the message text, until the end of the record.
+ *
+ * Strings are interned per session: each string starts with an integer whose
+ * two least significant bits indicate how to read it:
+ * - 0: the other bits are the length of the string, which follows;
+ * - 1: the other bits are the index of a previously defined string;
+ * - 2: as 0, but the string is also defined with the next index.
+ *
+ * See bin/logdecode.c for the decoder.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#ifdef BINARY_TEST
+# undef NDEBUG
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_fs.h>
+
+#include <stdarg.h>
+#include <errno.h>
+#include <assert.h>
+
+#define BINARY_FILENAME "vlc-log.bin"
+#define BINARY_MAGIC "VLCBLOG"
+#define BINARY_VERSION 1
+#define BINARY_HEADER 0xFF
+
+/* Buffered size above which records are written out */
+#define BATCH_SIZE (64 << 10)
+/* Maximum delay before buffered records are written out */
+#define FLUSH_PERIOD VLC_TICK_FROM_SEC(1)
+/* Number of interned strings slots, must be a power of two */
+#define STRING_SLOTS 1024
+/* Maximum number of strings per record */
+#define RECORD_STRINGS 5
+
+struct binary_string
+{
+    char *str;
+    uint32_t hash;
+    uint32_t index;
+};
+
+typedef struct
+{
+    FILE *stream;
+    int verbosity;
+
+    vlc_mutex_t lock;
+    vlc_timer_t timer;
+    vlc_tick_t last_ts;
+
+    unsigned char *buf;
+    size_t len;
+    size_t size;
+    bool error;
+
+    struct binary_string strings[STRING_SLOTS];
+    uint32_t string_count;
+
+    /* Strings defined by the current record, interned once it is complete */
+    struct binary_string pending[RECORD_STRINGS];
+    unsigned pending_count;
+} vlc_logger_sys_t;
+
+static bool Reserve(vlc_logger_sys_t *sys, size_t len)
+{
+    if (unlikely(sys->error))
+        return false;
+    if (likely(sys->size - sys->len >= len))
+        return true;
+
+    size_t size = sys->size;
+    while (size - sys->len < len)
+        size *= 2;
+
+    unsigned char *buf = realloc(sys->buf, size);
+    if (unlikely(buf == NULL))
+    {
+        sys->error = true;
+        return false;
+    }
+    sys->buf = buf;
+    sys->size = size;
+    return true;
+}
+
+static void PutBytes(vlc_logger_sys_t *sys, const void *data, size_t len)
+{
+    if (Reserve(sys, len))
+    {
+        memcpy(sys->buf + sys->len, data, len);
+        sys->len += len;
+    }
+}
+
+static void PutByte(vlc_logger_sys_t *sys, uint8_t byte)
+{
+    PutBytes(sys, &byte, 1);
+}
+
+static void PutVarint(vlc_logger_sys_t *sys, uint64_t value)
+{
+    uint8_t buf[10];
+    size_t len = 0;
+
+    do
+    {
+        buf[len] = value & 0x7F;
+        value >>= 7;
+        if (value != 0)
+            buf[len] |= 0x80;
+        len++;
+    }
+    while (value != 0);
+
+    PutBytes(sys, buf, len);
+}
+
+static void PutString(vlc_logger_sys_t *sys, const char *str)
+{
+    if (str == NULL)
+        str = "";
+
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    size_t len = 0;
+
+    for (; str[len] != '\0'; len++)
+        hash = (hash ^ (unsigned char)str[len]) * 16777619u;
+
+    const struct binary_string *slot;
+
+    for (size_t i = hash & (STRING_SLOTS - 1);
+         (slot = &sys->strings[i])->str != NULL;
+         i = (i + 1) & (STRING_SLOTS - 1))
+        if (slot->hash == hash && strcmp(slot->str, str) == 0)
+        {
+            PutVarint(sys, ((uint64_t)slot->index << 2) | 1);
+            return;
+        }
+
+    for (unsigned i = 0; i < sys->pending_count; i++)
+    {
+        slot = &sys->pending[i];
+        if (slot->hash == hash && strcmp(slot->str, str) == 0)
+        {
+            PutVarint(sys, ((uint64_t)slot->index << 2) | 1);
+            return;
+        }
+    }
+
+    assert(sys->pending_count < RECORD_STRINGS);
+
+    struct binary_string *def = &sys->pending[sys->pending_count];
+
+    /* Keep the table at most three quarters full */
+    if (sys->string_count + sys->pending_count < STRING_SLOTS * 3 / 4
+     && (def->str = strdup(str)) != NULL)
+    {
+        def->hash = hash;
+        def->index = sys->string_count + sys->pending_count++;
+        PutVarint(sys, ((uint64_t)len << 2) | 2);
+    }
+    else
+        PutVarint(sys, (uint64_t)len << 2);
+
+    PutBytes(sys, str, len);
+}
+
+static void PutText(vlc_logger_sys_t *sys, const char *format, va_list ap)
+{
+    va_list aq;
+
+    if (!Reserve(sys, 256))
+        return;
+
+    va_copy(aq, ap);
+
+    size_t avail = sys->size - sys->len;
+    int len = vsnprintf((char *)sys->buf + sys->len, avail, format, aq);
+    va_end(aq);
+
+    if (unlikely(len < 0))
+        return;
+
+    if ((size_t)len >= avail)
+    {
+        if (!Reserve(sys, len + 1))
+            return;
+        vsnprintf((char *)sys->buf + sys->len, len + 1, format, ap);
+    }
+    sys->len += len; /* drop the nul terminator */
+}
+
+static void Flush(vlc_logger_sys_t *sys)
+{
+    if (sys->len == 0)
+        return;
+
+    fwrite(sys->buf, 1, sys->len, sys->stream);
+    fflush(sys->stream);
+    sys->len = 0;
+}
+
+/**
+ * Finishes the current record, or discards it on error.
+ */
+static void EndRecord(vlc_logger_sys_t *sys, size_t start)
+{
+    if (unlikely(sys->error))
+    {
+        for (unsigned i = 0; i < sys->pending_count; i++)
+            free(sys->pending[i].str);
+        sys->pending_count = 0;
+        sys->len = start;
+        sys->error = false;
+        return;
+    }
+
+    /* Intern the strings that the record defined */
+    for (unsigned i = 0; i < sys->pending_count; i++)
+    {
+        size_t j = sys->pending[i].hash & (STRING_SLOTS - 1);
+
+        while (sys->strings[j].str != NULL)
+            j = (j + 1) & (STRING_SLOTS - 1);
+
+        sys->strings[j] = sys->pending[i];
+        assert(sys->strings[j].index == sys->string_count);
+        sys->string_count++;
+    }
+    sys->pending_count = 0;
+
+    uint32_t size = sys->len - start - 4;
+
+    SetDWLE(sys->buf + start, size);
+}
+
+static void LogBinary(void *opaque, int type, const vlc_log_t *meta,
+                      const char *format, va_list ap)
+{
+    vlc_logger_sys_t *sys = opaque;
+
+    if (sys->verbosity < type)
+        return;
+
+    vlc_mutex_lock(&sys->lock);
+
+    vlc_tick_t ts = vlc_tick_now();
+    size_t start = sys->len;
+
+    PutBytes(sys, (uint8_t[4]){ 0 }, 4); /* size, set by EndRecord() */
+    PutByte(sys, type);
+    PutVarint(sys, ts - sys->last_ts);
+    PutVarint(sys, meta->tid);
+    PutVarint(sys, meta->i_object_id);
+    PutString(sys, meta->psz_object_type);
+    PutString(sys, meta->psz_module);
+    PutString(sys, meta->psz_header);
+    PutString(sys, meta->file);
+    PutVarint(sys, meta->line + 1);
+    PutString(sys, meta->func);
+    PutText(sys, format, ap);
+    EndRecord(sys, start);
+
+    if (sys->len > start)
+        sys->last_ts = ts;
+    if (sys->len >= BATCH_SIZE || type == VLC_MSG_ERR)
+        Flush(sys);
+    vlc_mutex_unlock(&sys->lock);
+}
+
+static void FlushTimer(void *data)
+{
+    vlc_logger_sys_t *sys = data;
+
+    vlc_mutex_lock(&sys->lock);
+    Flush(sys);
+    vlc_mutex_unlock(&sys->lock);
+}
+
+static void Close(void *opaque)
+{
+    vlc_logger_sys_t *sys = opaque;
+
+    vlc_timer_destroy(sys->timer);
+    Flush(sys);
+    fclose(sys->stream);
+
+    for (size_t i = 0; i < STRING_SLOTS; i++)
+        free(sys->strings[i].str);
+    free(sys->buf);
+    free(sys);
+}
+
+/**
+ * Creates a logger writing to the given stream, and writes the session header.
+ * The stream is closed by Close(), or on error.
+ */
+static vlc_logger_sys_t *Create(FILE *stream, int verbosity)
+{
+    vlc_logger_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        goto error;
+
+    sys->stream = stream;
+    sys->verbosity = verbosity;
+    vlc_mutex_init(&sys->lock);
+    sys->size = BATCH_SIZE;
+    sys->buf = malloc(sys->size);
+    if (unlikely(sys->buf == NULL))
+        goto error;
+
+    /* Records are batched in our own buffer */
+    setvbuf(stream, NULL, _IONBF, 0);
+
+    if (vlc_timer_create(&sys->timer, FlushTimer, sys))
+        goto error;
+
+    /* Session header */
+    sys->last_ts = vlc_tick_now();
+    PutBytes(sys, (uint8_t[4]){ 0 }, 4);
+    PutByte(sys, BINARY_HEADER);
+    PutBytes(sys, BINARY_MAGIC, strlen(BINARY_MAGIC));
+    PutByte(sys, BINARY_VERSION);
+    PutVarint(sys, CLOCK_FREQ);
+    PutVarint(sys, sys->last_ts);
+    EndRecord(sys, 0);
+    Flush(sys);
+
+    vlc_timer_schedule_asap(sys->timer, FLUSH_PERIOD);
+    return sys;
+
+error:
+    if (sys != NULL)
+        free(sys->buf);
+    free(sys);
+    fclose(stream);
+    return NULL;
+}
+
+#ifndef BINARY_TEST
+static const struct vlc_logger_operations binary_ops =
+{
+    LogBinary,
+    Close
+};
+
+static const struct vlc_logger_operations *Open(vlc_object_t *obj,
+                                                void **restrict sysp)
+{
+    if (!var_InheritBool(obj, "binary-logging"))
+        return NULL;
+
+    int verbosity = var_InheritInteger(obj, "binary-log-verbose");
+    if (verbosity == -1)
+        verbosity = var_InheritInteger(obj, "verbose");
+    if (verbosity < 0)
+        return NULL; /* nothing to log */
+
+    const char *filename = BINARY_FILENAME;
+    char *path = var_InheritString(obj, "binary-logfile");
+#ifdef __APPLE__
+    if (path == NULL)
+    {
+        char *home = config_GetUserDir(VLC_HOME_DIR);
+        if (home != NULL)
+        {
+            if (asprintf(&path, "%s/Library/Logs/"BINARY_FILENAME,
+                         home) == -1)
+                path = NULL;
+            free(home);
+        }
+    }
+#endif
+    if (path != NULL)
+        filename = path;
+
+    msg_Dbg(obj, "opening logfile `%s'", filename);
+    FILE *stream = vlc_fopen(filename, "ab");
+    if (stream == NULL)
+    {
+        msg_Err(obj, "error opening log file `%s': %s", filename,
+                vlc_strerror_c(errno));
+        free(path);
+        return NULL;
+    }
+    free(path);
+
+    vlc_logger_sys_t *sys = Create(stream, verbosity + VLC_MSG_ERR);
+    if (sys == NULL)
+        return NULL;
+
+    *sysp = sys;
+    return &binary_ops;
+}
+
+static const int verbosity_values[] = {
+    -1,
+    VLC_MSG_INFO,
+    VLC_MSG_ERR,
+    VLC_MSG_WARN,
+    VLC_MSG_DBG
+};
+
+static const char *const verbosity_text[] = { N_("Default"), N_("Info"), N_("Error"), N_("Warning"), N_("Debug") };
+
+#define BINARY_LOG_TEXT N_("Log to binary file")
+#define BINARY_LOG_LONGTEXT N_("Log all VLC messages to a compact binary " \
+    "file. Use vlc-log-decode to convert it back to text.")
+
+#define LOGFILE_NAME_TEXT N_("Log filename")
+#define LOGFILE_NAME_LONGTEXT N_("Specify the log filename.")
+
+#define LOGVERBOSE_TEXT N_("Verbosity")
+#define LOGVERBOSE_LONGTEXT N_("Select the logging verbosity or " \
+"default to use the same verbosity given by --verbose.")
+
+vlc_module_begin()
+    set_shortname(N_("Binary log"))
+    set_description(N_("Binary file logger"))
+    set_subcategory(SUBCAT_ADVANCED_MISC)
+    set_capability("logger", 15)
+    set_callback(Open)
+
+    add_bool("binary-logging", false, BINARY_LOG_TEXT, BINARY_LOG_LONGTEXT)
+    add_savefile("binary-logfile", NULL, LOGFILE_NAME_TEXT,
+                 LOGFILE_NAME_LONGTEXT)
+    add_integer("binary-log-verbose", -1, LOGVERBOSE_TEXT,
+                LOGVERBOSE_LONGTEXT)
+        change_integer_list(verbosity_values, verbosity_text)
+vlc_module_end ()
+#endif /* !BINARY_TEST */
+
+#ifdef BINARY_TEST
+#include <inttypes.h>
+
+#include "../../bin/logdecode.c"
+
+/* Enough distinct strings to fill the interned strings table */
+#define MESSAGES 900
+
+struct test_message
+{
+    vlc_log_t meta;
+    int type;
+    char module[24];
+    char func[24];
+};
+
+/*
+ * Every third message reuses the same strings. The others define a new
+ * function name, and share their module name with the next message.
+ */
+static void GetMessage(unsigned i, struct test_message *m)
+{
+    bool shared = i < 2 || (i % 3) == 0;
+
+    if (shared)
+    {
+        strcpy(m->module, "module");
+        strcpy(m->func, "main");
+    }
+    else
+    {
+        sprintf(m->module, "module-%u", i / 2);
+        sprintf(m->func, "func-%u", i);
+    }
+
+    m->meta = (vlc_log_t) {
+        .i_object_id = 0x100 + i,
+        .psz_object_type = "test",
+        .psz_module = m->module,
+        .psz_header = (i % 5) == 4 ? NULL : "header",
+        .file = "binary.c",
+        .line = i,
+        .func = m->func,
+        .tid = 1234,
+    };
+    m->type = VLC_MSG_DBG - (i % 4);
+}
+
+static void Log(vlc_logger_sys_t *sys, int type, const vlc_log_t *meta,
+                const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    LogBinary(sys, type, meta, format, ap);
+    va_end(ap);
+}
+
+static void CheckMessage(FILE *text, unsigned i)
+{
+    struct test_message m;
+    char line[256], expected[256];
+
+    GetMessage(i, &m);
+    snprintf(expected, sizeof (expected),
+             "[%016"PRIxPTR"] [%lu] %s%s%s%s %s%s: message %u (%s:%d in %s())\n",
+             m.meta.i_object_id, m.meta.tid,
+             m.meta.psz_header ? "[" : "",
+             m.meta.psz_header ? m.meta.psz_header : "",
+             m.meta.psz_header ? "] " : "", m.meta.psz_module,
+             m.meta.psz_object_type, msg_type[m.type], i, m.meta.file,
+             m.meta.line, m.meta.func);
+
+    char *p = fgets(line, sizeof (line), text);
+    assert(p != NULL);
+    p = strchr(line, ' '); /* skip the time stamp */
+    assert(p != NULL);
+    if (strcmp(p + 1, expected))
+    {
+        fprintf(stderr, "Expected: %sDecoded: %s", expected, p + 1);
+        abort();
+    }
+}
+
+int main(void)
+{
+    FILE *stream = tmpfile();
+    FILE *text = tmpfile();
+    assert(stream != NULL && text != NULL);
+
+    vlc_logger_sys_t *sys = Create(stream, VLC_MSG_DBG);
+    assert(sys != NULL);
+
+    size_t sizes[2];
+
+    for (unsigned i = 0; i < MESSAGES; i++)
+    {
+        struct test_message m;
+        size_t len = sys->len;
+
+        GetMessage(i, &m);
+        Log(sys, m.type, &m.meta, "message %u", i);
+        if (i < 2)
+        {
+            sizes[i] = sys->len - len;
+            assert(sys->string_count == 5);
+        }
+    }
+
+    /* The second message only refers to the strings defined by the first */
+    assert(sizes[1] < sizes[0]);
+    /* The table is full: later strings are written literally */
+    assert(sys->string_count == STRING_SLOTS * 3 / 4);
+
+    vlc_mutex_lock(&sys->lock);
+    Flush(sys);
+    vlc_mutex_unlock(&sys->lock);
+
+    rewind(stream);
+    assert(Decode(stream, text, true) == 0);
+    Close(sys);
+
+    char line[256];
+
+    rewind(text);
+    assert(fgets(line, sizeof (line), text) != NULL);
+    assert(!strcmp(line, "-- session started --\n"));
+    for (unsigned i = 0; i < MESSAGES; i++)
+        CheckMessage(text, i);
+    assert(fgets(line, sizeof (line), text) == NULL);
+    fclose(text);
+    return 0;
+}
+#endif /* BINARY_TEST */
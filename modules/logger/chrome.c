@@ -0,0 +1,515 @@
+/*****************************************************************************
+ * chrome.c: Chrome trace event format tracer plugin
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Traces are written in the Chrome trace event format, which can be loaded
+ * in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Tracing threads never format nor write anything: each of them serializes
+ * its traces into its own single-producer/single-consumer ring buffer, and a
+ * background thread periodically drains all the rings into the file. If a
+ * ring is full, traces are dropped and counted instead of blocking.
+ *
+ * Traces with a "begin" or "end" key (see vlc_tracer_TraceBegin() and
+ * vlc_tracer_TraceEnd()) are written as duration events, the others as
+ * instant events.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_fs.h>
+#include <vlc_charset.h>
+#include <vlc_tracer.h>
+#include <vlc_list.h>
+
+#include <stdatomic.h>
+#include <errno.h>
+#include <assert.h>
+
+#define CHROME_FILENAME "vlc-trace.json"
+
+/* Size of each per-thread ring, must be a power of two */
+#define RING_SIZE (1 << 16)
+/* Maximum size of one serialized trace */
+#define RECORD_MAX 1024
+/* Maximum size of one serialized string value */
+#define STRING_MAX 256
+/* Maximum number of entries kept per trace */
+#define ENTRIES_MAX 16
+
+#define FLUSH_PERIOD VLC_TICK_FROM_MS(100)
+
+struct trace_ring
+{
+    struct vlc_list node;
+    unsigned long tid;
+
+    atomic_size_t head; /* only written by the tracing thread */
+    atomic_size_t tail; /* only written by the writer thread */
+    atomic_uint dropped;
+    atomic_bool exited; /* the tracing thread exited, free once drained */
+
+    unsigned char data[RING_SIZE];
+};
+
+typedef struct
+{
+    FILE *stream;
+    bool first;
+
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    bool quit;
+    struct vlc_list incoming; /* new rings, protected by the lock */
+    struct vlc_list rings; /* only accessed by the writer thread */
+    vlc_threadvar_t ring_key; /* ring of the calling thread */
+
+    vlc_thread_t thread;
+} vlc_tracer_sys_t;
+
+static void ReleaseRing(void *data)
+{
+    struct trace_ring *ring = data;
+
+    /* The writer thread frees it after the last drain */
+    atomic_store_explicit(&ring->exited, true, memory_order_release);
+}
+
+static struct trace_ring *GetRing(vlc_tracer_sys_t *sys)
+{
+    struct trace_ring *ring = vlc_threadvar_get(sys->ring_key);
+    if (likely(ring != NULL))
+        return ring;
+
+    ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    ring->tid = vlc_thread_id();
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->exited, false);
+
+    if (vlc_threadvar_set(sys->ring_key, ring))
+    {
+        free(ring);
+        return NULL;
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_append(&ring->node, &sys->incoming);
+    vlc_mutex_unlock(&sys->lock);
+    return ring;
+}
+
+static size_t PutBytes(unsigned char *restrict buf, size_t pos,
+                       const void *data, size_t len)
+{
+    if (pos + len > RECORD_MAX)
+        return RECORD_MAX + 1;
+    memcpy(buf + pos, data, len);
+    return pos + len;
+}
+
+static size_t PutString(unsigned char *restrict buf, size_t pos,
+                        const char *str)
+{
+    size_t len = strnlen(str, STRING_MAX - 1);
+
+    pos = PutBytes(buf, pos, str, len);
+    return PutBytes(buf, pos, "", 1);
+}
+
+static void TraceChrome(void *opaque, vlc_tick_t ts, va_list entries)
+{
+    vlc_tracer_sys_t *sys = opaque;
+    struct trace_ring *ring = GetRing(sys);
+    if (unlikely(ring == NULL))
+        return;
+
+    /* Serialize: size, timestamp, entry count, then type/key/value entries */
+    unsigned char record[RECORD_MAX];
+    uint8_t count = 0;
+    size_t pos = sizeof (uint16_t);
+
+    pos = PutBytes(record, pos, &ts, sizeof (ts));
+    pos = PutBytes(record, pos, &count, sizeof (count));
+
+    for (struct vlc_tracer_entry entry = va_arg(entries, struct vlc_tracer_entry);
+         entry.key != NULL && count < ENTRIES_MAX;
+         entry = va_arg(entries, struct vlc_tracer_entry))
+    {
+        uint8_t type = entry.type;
+
+        pos = PutBytes(record, pos, &type, sizeof (type));
+        pos = PutString(record, pos, entry.key);
+        switch (entry.type)
+        {
+            case VLC_TRACER_INT:
+                pos = PutBytes(record, pos, &entry.value.integer,
+                               sizeof (entry.value.integer));
+                break;
+            case VLC_TRACER_TICK:
+                pos = PutBytes(record, pos, &entry.value.tick,
+                               sizeof (entry.value.tick));
+                break;
+            case VLC_TRACER_STRING:
+                pos = PutString(record, pos, entry.value.string != NULL
+                                             ? entry.value.string : "");
+                break;
+            default:
+                vlc_assert_unreachable();
+        }
+        count++;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (pos > RECORD_MAX || RING_SIZE - (head - tail) < pos)
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint16_t size = pos;
+    memcpy(record, &size, sizeof (size));
+    record[sizeof (uint16_t) + sizeof (vlc_tick_t)] = count;
+
+    size_t offset = head & (RING_SIZE - 1);
+    size_t first = __MIN(pos, (size_t)RING_SIZE - offset);
+
+    memcpy(ring->data + offset, record, first);
+    memcpy(ring->data, record + first, pos - first);
+    atomic_store_explicit(&ring->head, head + pos, memory_order_release);
+}
+
+static void JsonPrintString(FILE *stream, const char *str)
+{
+    if (!IsUTF8(str))
+    {
+        fputs("\"invalid string\"", stream);
+        return;
+    }
+
+    fputc('\"', stream);
+    for (; *str != '\0'; str++)
+    {
+        unsigned char byte = *str;
+
+        if (byte == '\\' || byte == '\"')
+            fprintf(stream, "\\%c", byte);
+        else if (byte <= 0x1F || byte == 0x7F)
+            fprintf(stream, "\\u%04x", byte);
+        else
+            fputc(byte, stream);
+    }
+    fputc('\"', stream);
+}
+
+/* Write one record from its contiguous copy */
+static void WriteRecord(vlc_tracer_sys_t *sys, unsigned long tid,
+                        const unsigned char *record)
+{
+    FILE *stream = sys->stream;
+    vlc_tick_t ts;
+    size_t pos = sizeof (uint16_t);
+
+    memcpy(&ts, record + pos, sizeof (ts));
+    pos += sizeof (ts);
+
+    unsigned count = record[pos++];
+
+    struct
+    {
+        uint8_t type;
+        const char *key;
+        union
+        {
+            int64_t integer;
+            const char *string;
+        };
+    } entries[ENTRIES_MAX];
+
+    const char *name = NULL, *cat = "trace", *phase = "i";
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        entries[i].type = record[pos++];
+        entries[i].key = (const char *)record + pos;
+        pos += strlen(entries[i].key) + 1;
+
+        if (entries[i].type == VLC_TRACER_STRING)
+        {
+            entries[i].string = (const char *)record + pos;
+            pos += strlen(entries[i].string) + 1;
+
+            if (!strcmp(entries[i].key, "type"))
+                cat = entries[i].string;
+            else if (!strcmp(entries[i].key, "begin"))
+            {
+                name = entries[i].string;
+                phase = "B";
+            }
+            else if (!strcmp(entries[i].key, "end"))
+            {
+                name = entries[i].string;
+                phase = "E";
+            }
+            else if (!strcmp(entries[i].key, "event") && name == NULL)
+                name = entries[i].string;
+        }
+        else
+        {
+            memcpy(&entries[i].integer, record + pos, sizeof (int64_t));
+            pos += sizeof (int64_t);
+        }
+    }
+
+    if (name == NULL)
+        name = cat;
+
+    fputs(sys->first ? "\n" : ",\n", stream);
+    sys->first = false;
+
+    fputs("{\"name\":", stream);
+    JsonPrintString(stream, name);
+    fputs(",\"cat\":", stream);
+    JsonPrintString(stream, cat);
+    fprintf(stream, ",\"ph\":\"%s\",\"ts\":%"PRId64",\"pid\":1,\"tid\":%lu",
+            phase, US_FROM_VLC_TICK(ts), tid);
+    if (phase[0] == 'i')
+        fputs(",\"s\":\"t\"", stream);
+
+    fputs(",\"args\":{", stream);
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (i > 0)
+            fputc(',', stream);
+        JsonPrintString(stream, entries[i].key);
+        fputc(':', stream);
+        switch (entries[i].type)
+        {
+            case VLC_TRACER_INT:
+                fprintf(stream, "%"PRId64, entries[i].integer);
+                break;
+            case VLC_TRACER_TICK:
+                fprintf(stream, "%"PRId64, US_FROM_VLC_TICK(entries[i].integer));
+                break;
+            default:
+                JsonPrintString(stream, entries[i].string);
+                break;
+        }
+    }
+    fputs("}}", stream);
+}
+
+static void DrainRing(vlc_tracer_sys_t *sys, struct trace_ring *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    while (tail != head)
+    {
+        unsigned char record[RECORD_MAX];
+        size_t offset = tail & (RING_SIZE - 1);
+        uint16_t size;
+
+        /* The size itself may wrap around the end of the ring */
+        for (size_t i = 0; i < sizeof (size); i++)
+            record[i] = ring->data[(offset + i) & (RING_SIZE - 1)];
+        memcpy(&size, record, sizeof (size));
+        assert(size <= RECORD_MAX && size <= head - tail);
+
+        size_t first = __MIN((size_t)size, (size_t)RING_SIZE - offset);
+        memcpy(record, ring->data + offset, first);
+        memcpy(record + first, ring->data, size - first);
+
+        WriteRecord(sys, ring->tid, record);
+        tail += size;
+    }
+
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+    unsigned dropped = atomic_exchange_explicit(&ring->dropped, 0,
+                                                memory_order_relaxed);
+    if (dropped > 0)
+    {
+        fputs(sys->first ? "\n" : ",\n", sys->stream);
+        sys->first = false;
+
+        fprintf(sys->stream, "{\"name\":\"dropped\",\"cat\":\"tracer\","
+                "\"ph\":\"i\",\"s\":\"t\",\"ts\":%"PRId64",\"pid\":1,"
+                "\"tid\":%lu,\"args\":{\"count\":%u}}",
+                US_FROM_VLC_TICK(vlc_tick_now()), ring->tid, dropped);
+    }
+}
+
+/* Only called from the writer thread, or after it exited. The file is
+ * written without the lock, so that new tracing threads never wait for it. */
+static void DrainRings(vlc_tracer_sys_t *sys)
+{
+    struct trace_ring *ring;
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_foreach(ring, &sys->incoming, node)
+    {
+        vlc_list_remove(&ring->node);
+        vlc_list_append(&ring->node, &sys->rings);
+    }
+    vlc_mutex_unlock(&sys->lock);
+
+    vlc_list_foreach(ring, &sys->rings, node)
+    {
+        /* Checked first: once exited, the thread has written its last trace */
+        bool exited = atomic_load_explicit(&ring->exited, memory_order_acquire);
+
+        DrainRing(sys, ring);
+        if (exited)
+        {
+            vlc_list_remove(&ring->node);
+            free(ring);
+        }
+    }
+    fflush(sys->stream);
+}
+
+static void *Thread(void *opaque)
+{
+    vlc_tracer_sys_t *sys = opaque;
+
+    vlc_thread_set_name("vlc-tracer");
+
+    vlc_mutex_lock(&sys->lock);
+    while (!sys->quit)
+    {
+        vlc_tick_t deadline = vlc_tick_now() + FLUSH_PERIOD;
+
+        while (!sys->quit && vlc_cond_timedwait(&sys->wait, &sys->lock,
+                                                deadline) == 0);
+        vlc_mutex_unlock(&sys->lock);
+        DrainRings(sys);
+        vlc_mutex_lock(&sys->lock);
+    }
+    vlc_mutex_unlock(&sys->lock);
+
+    return NULL;
+}
+
+static void Close(void *opaque)
+{
+    vlc_tracer_sys_t *sys = opaque;
+
+    /* No more ring destructor calls from exiting threads */
+    vlc_threadvar_delete(&sys->ring_key);
+
+    vlc_mutex_lock(&sys->lock);
+    sys->quit = true;
+    vlc_cond_signal(&sys->wait);
+    vlc_mutex_unlock(&sys->lock);
+    vlc_join(sys->thread, NULL);
+
+    /* Traces emitted after the last drain */
+    DrainRings(sys);
+
+    fputs("\n]\n", sys->stream);
+    fclose(sys->stream);
+
+    struct trace_ring *ring;
+    vlc_list_foreach(ring, &sys->rings, node)
+        free(ring);
+    vlc_list_foreach(ring, &sys->incoming, node)
+        free(ring);
+    free(sys);
+}
+
+static const struct vlc_tracer_operations chrome_ops =
+{
+    TraceChrome,
+    Close
+};
+
+static const struct vlc_tracer_operations *Open(vlc_object_t *obj,
+                                               void **restrict sysp)
+{
+    vlc_tracer_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return NULL;
+
+    char *path = var_InheritString(obj, "chrome-tracer-file");
+    const char *filename = path != NULL ? path : CHROME_FILENAME;
+
+    msg_Dbg(obj, "opening trace file `%s'", filename);
+    sys->stream = vlc_fopen(filename, "wt");
+    if (sys->stream == NULL)
+    {
+        msg_Err(obj, "error opening trace file `%s': %s", filename,
+                vlc_strerror_c(errno));
+        free(path);
+        free(sys);
+        return NULL;
+    }
+    free(path);
+
+    fputc('[', sys->stream);
+    sys->first = true;
+    sys->quit = false;
+    vlc_mutex_init(&sys->lock);
+    vlc_cond_init(&sys->wait);
+    vlc_list_init(&sys->incoming);
+    vlc_list_init(&sys->rings);
+
+    if (vlc_threadvar_create(&sys->ring_key, ReleaseRing))
+    {
+        fclose(sys->stream);
+        free(sys);
+        return NULL;
+    }
+
+    if (vlc_clone(&sys->thread, Thread, sys))
+    {
+        vlc_threadvar_delete(&sys->ring_key);
+        fclose(sys->stream);
+        free(sys);
+        return NULL;
+    }
+
+    *sysp = sys;
+    return &chrome_ops;
+}
+
+#define FILE_NAME_TEXT N_("Trace filename")
+#define FILE_NAME_LONGTEXT N_("Specify the trace event filename.")
+
+vlc_module_begin()
+    set_shortname(N_("Chrome tracer"))
+    set_description(N_("Chrome trace event format tracer"))
+    set_subcategory(SUBCAT_ADVANCED_MISC)
+    set_capability("tracer", 0)
+    set_callback(Open)
+
+    add_savefile("chrome-tracer-file", NULL, FILE_NAME_TEXT,
+                 FILE_NAME_LONGTEXT)
+vlc_module_end()
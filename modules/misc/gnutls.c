@@ -42,11 +42,38 @@
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
 
+/** Maximum number of remembered client sessions */
+#define GNUTLS_RESUME_MAX 8
+
+/**
+ * Resumable client session parameters
+ */
+struct vlc_tls_gnutls_resume
+{
+    struct vlc_tls_gnutls_resume *next;
+    gnutls_datum_t data;
+    char key[]; /**< Server name and service */
+};
+
+/**
+ * Client-side TLS credentials private data
+ */
+typedef struct vlc_tls_gnutls_client
+{
+    gnutls_certificate_credentials_t x509;
+    vlc_mutex_t lock;
+    struct vlc_tls_gnutls_resume *resume; /**< Most recent first */
+} vlc_tls_gnutls_client_t;
+
 typedef struct vlc_tls_gnutls
 {
     vlc_tls_t tls;
     gnutls_session_t session;
     vlc_object_t *obj;
+    vlc_tls_gnutls_client_t *client; /**< NULL for server sessions */
+    char *key; /**< Server name and service for session resumption, or NULL */
+    bool handshaking;
+    bool established;
 } vlc_tls_gnutls_t;
 
 static void gnutls_Banner(vlc_object_t *obj)
@@ -203,11 +230,70 @@ static int gnutls_Shutdown(vlc_tls_t *tls, bool duplex)
     return 0;
 }
 
+/**
+ * Remembers the parameters of an established client session, so that the
+ * next session with the same server can be resumed with an abbreviated
+ * handshake.
+ */
+static void gnutls_SessionSave(vlc_tls_gnutls_t *priv)
+{
+    vlc_tls_gnutls_client_t *sys = priv->client;
+    gnutls_session_t session = priv->session;
+    gnutls_datum_t data;
+
+    if (sys == NULL || priv->key == NULL || !priv->established)
+        return;
+#if GNUTLS_VERSION_NUMBER >= 0x03060d
+    if (gnutls_protocol_get_version(session) == GNUTLS_TLS1_3
+     && !(gnutls_session_get_flags(session) & GNUTLS_SFLAGS_SESSION_TICKET))
+        return; /* no ticket from the server (yet) */
+#endif
+    if (gnutls_session_get_data2(session, &data) != GNUTLS_E_SUCCESS)
+        return;
+
+    size_t len = strlen(priv->key) + 1;
+    struct vlc_tls_gnutls_resume *r = malloc(sizeof (*r) + len);
+    if (unlikely(r == NULL))
+    {
+        gnutls_free(data.data);
+        return;
+    }
+
+    r->data = data;
+    memcpy(r->key, priv->key, len);
+
+    vlc_mutex_lock(&sys->lock);
+    r->next = sys->resume;
+    sys->resume = r;
+
+    /* Replace any older parameters for the same server, and forget the
+     * least recently saved ones beyond the limit. */
+    struct vlc_tls_gnutls_resume **pp = &r->next;
+    unsigned count = 0;
+
+    while (*pp != NULL)
+    {
+        struct vlc_tls_gnutls_resume *old = *pp;
+
+        if (++count >= GNUTLS_RESUME_MAX || !strcmp(old->key, r->key))
+        {
+            *pp = old->next;
+            gnutls_free(old->data.data);
+            free(old);
+        }
+        else
+            pp = &old->next;
+    }
+    vlc_mutex_unlock(&sys->lock);
+}
+
 static void gnutls_Close (vlc_tls_t *tls)
 {
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
 
+    gnutls_SessionSave(priv);
     gnutls_deinit(priv->session);
+    free(priv->key);
     free(priv);
 }
 
@@ -297,6 +383,10 @@ static vlc_tls_gnutls_t *gnutls_SessionOpen(vlc_object_t *obj, int type,
 
     priv->session = session;
     priv->obj = obj;
+    priv->client = NULL;
+    priv->key = NULL;
+    priv->handshaking = false;
+    priv->established = false;
 
     vlc_tls_t *tls = &priv->tls;
 
@@ -354,6 +444,8 @@ static int gnutls_Handshake(vlc_tls_t *tls, char **restrict alp)
         msg_Dbg(obj, " - encrypt then MAC (RFC7366) enabled");
     if (flags & GNUTLS_SFLAGS_FALSE_START)
         msg_Dbg(obj, " - false start (RFC7918) enabled");
+    if (gnutls_session_is_resumed(session))
+        msg_Dbg(obj, " - session resumed");
 
     if (alp != NULL)
     {
@@ -379,24 +471,60 @@ static vlc_tls_t *gnutls_ClientSessionOpen(vlc_tls_client_t *crd,
                                            vlc_tls_t *sk, const char *hostname,
                                            const char *const *alpn)
 {
+    vlc_tls_gnutls_client_t *sys = crd->sys;
     vlc_tls_gnutls_t *priv = gnutls_SessionOpen(VLC_OBJECT(crd), GNUTLS_CLIENT,
-                                                crd->sys, sk, alpn);
+                                                sys->x509, sk, alpn);
     if (priv == NULL)
         return NULL;
 
     gnutls_session_t session = priv->session;
 
+    priv->client = sys;
+
     /* minimum DH prime bits */
     gnutls_dh_set_prime_bits (session, 1024);
 
     if (likely(hostname != NULL))
+    {
         /* fill Server Name Indication */
         gnutls_server_name_set (session, GNUTLS_NAME_DNS,
                                 hostname, strlen (hostname));
+    }
 
     return &priv->tls;
 }
 
+/**
+ * Loads the parameters of a previous session with the same server, if any.
+ * The service is only known at handshake time, so this must be called
+ * before the first handshake step.
+ */
+static void gnutls_SessionLoad(vlc_tls_gnutls_t *priv,
+                               const char *host, const char *service)
+{
+    vlc_tls_gnutls_client_t *sys = priv->client;
+
+    if (host == NULL)
+        return;
+    /* Distinct services of a host may not share sessions */
+    if (asprintf(&priv->key, "%s:%s", host,
+                 (service != NULL) ? service : "") == -1)
+    {
+        priv->key = NULL;
+        return;
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    for (const struct vlc_tls_gnutls_resume *r = sys->resume;
+         r != NULL; r = r->next)
+        if (!strcmp(r->key, priv->key))
+        {
+            gnutls_session_set_data(priv->session, r->data.data, r->data.size);
+            break;
+        }
+    vlc_mutex_unlock(&sys->lock);
+}
+
 static int gnutls_ClientHandshake(vlc_tls_t *tls,
                                   const char *host, const char *service,
                                   char **restrict alp)
@@ -404,6 +532,12 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
     vlc_object_t *obj = priv->obj;
 
+    if (!priv->handshaking)
+    {
+        gnutls_SessionLoad(priv, host, service);
+        priv->handshaking = true;
+    }
+
     int val = gnutls_Handshake(tls, alp);
     if (val)
         return val;
@@ -421,7 +555,7 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
     }
 
     if (status == 0) /* Good certificate */
-        return 0;
+        goto success;
 
     /* Bad certificate */
     gnutls_datum_t desc;
@@ -459,7 +593,7 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
     {
         case 0:
             msg_Dbg(obj, "certificate key match for %s", host);
-            return 0;
+            goto success;
         case GNUTLS_E_NO_CERTIFICATE_FOUND:
             msg_Dbg(obj, "no known certificates for %s", host);
             msg = N_("However, the security certificate presented by the "
@@ -523,6 +657,8 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
         default:
             goto error;
     }
+success:
+    priv->established = true;
     return 0;
 
 error:
@@ -533,9 +669,18 @@ error:
 
 static void gnutls_ClientDestroy(vlc_tls_client_t *crd)
 {
-    gnutls_certificate_credentials_t x509 = crd->sys;
+    vlc_tls_gnutls_client_t *sys = crd->sys;
+
+    while (sys->resume != NULL)
+    {
+        struct vlc_tls_gnutls_resume *r = sys->resume;
 
-    gnutls_certificate_free_credentials(x509);
+        sys->resume = r->next;
+        gnutls_free(r->data.data);
+        free(r);
+    }
+    gnutls_certificate_free_credentials(sys->x509);
+    free(sys);
 }
 
 static const struct vlc_tls_client_operations gnutls_ClientOps =
@@ -550,6 +695,10 @@ static const struct vlc_tls_client_operations gnutls_ClientOps =
  */
 static int OpenClient(vlc_tls_client_t *crd)
 {
+    vlc_tls_gnutls_client_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
     gnutls_certificate_credentials_t x509;
 
     gnutls_Banner(VLC_OBJECT(crd));
@@ -559,6 +708,7 @@ static int OpenClient(vlc_tls_client_t *crd)
     {
         msg_Err (crd, "cannot allocate credentials: %s",
                  gnutls_strerror (val));
+        free(sys);
         return VLC_EGENERIC;
     }
 
@@ -588,8 +738,12 @@ static int OpenClient(vlc_tls_client_t *crd)
     gnutls_certificate_set_verify_flags (x509,
                                          GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT);
 
+    sys->x509 = x509;
+    vlc_mutex_init(&sys->lock);
+    sys->resume = NULL;
+
     crd->ops = &gnutls_ClientOps;
-    crd->sys = x509;
+    crd->sys = sys;
     return VLC_SUCCESS;
 }
 
@@ -266,6 +266,9 @@ static int AStreamControl(stream_t *s, int i_query, va_list args)
             return ret;
         }
 
+        case STREAM_GET_CACHE_STATS: /* not collected */
+            return VLC_EGENERIC;
+
         case STREAM_SET_RECORD_STATE:
         default:
             msg_Err(s, "invalid vlc_stream_vaControl query=0x%x", i_query);
@@ -281,6 +284,15 @@ static int Open(vlc_object_t *obj)
     if (s->s->pf_block == NULL)
         return VLC_EGENERIC;
 
+    /* Local accesses return their blocks without delay, and possibly without
+     * any copy (memory-mapped files). Buffering them here would only add a
+     * copy of every byte. The stream layer reads blocks directly. */
+    bool fast_seek;
+
+    if (vlc_stream_Control(s->s, STREAM_CAN_FASTSEEK, &fast_seek) == 0
+     && fast_seek)
+        return VLC_EGENERIC;
+
     stream_sys_t *sys = malloc(sizeof (*sys));
     if (unlikely(sys == NULL))
         return VLC_ENOMEM;
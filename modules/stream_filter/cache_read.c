@@ -479,6 +479,9 @@ static int AStreamControl(stream_t *s, int i_query, va_list args)
             return ret;
         }
 
+        case STREAM_GET_CACHE_STATS: /* not collected */
+            return VLC_EGENERIC;
+
         case STREAM_SET_RECORD_STATE:
         default:
             msg_Err(s, "invalid vlc_stream_vaControl query=0x%x", i_query);
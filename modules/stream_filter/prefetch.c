@@ -76,6 +76,8 @@ typedef struct
     size_t       seek_threshold;
 
     struct stream_ctrl *controls;
+
+    struct vlc_stream_cache_stats stats;
 } stream_sys_t;
 
 static ssize_t ThreadRead(stream_t *stream, void *buf, size_t length)
@@ -106,6 +108,57 @@ static int ThreadSeek(stream_t *stream, uint64_t seek_offset)
     return (val == VLC_SUCCESS) ? 0 : -1;
 }
 
+/**
+ * Fetches the range between the given offset and the start of the buffer,
+ * so that the buffered data is retained across a short backward seek.
+ */
+static int ThreadFillGap(stream_t *stream, uint64_t offset)
+{
+    stream_sys_t *sys = stream->p_sys;
+    const uint64_t start = offset;
+    const uint64_t end = sys->buffer_offset;
+    const uint64_t resume = sys->buffer_offset + sys->buffer_length;
+
+    assert(offset < end);
+    assert(sys->buffer_length + (end - offset) <= sys->buffer_size);
+
+    if (ThreadSeek(stream, offset))
+        return -1;
+
+    /* Only this thread modifies the buffer bounds, and the gap lies outside
+     * of them, so that it can be written to without the lock. */
+    while (offset < end)
+    {
+        size_t pos = offset % sys->buffer_size;
+        size_t len = end - offset;
+
+        /* Do not step past the sharp edge of the circular buffer */
+        if (pos + len > sys->buffer_size)
+            len = sys->buffer_size - pos;
+
+        ssize_t val = ThreadRead(stream, sys->buffer + pos, len);
+        if (val <= 0)
+            return -1; /* upstream offset is unknown: start over */
+
+        sys->stats.fetched += val;
+        offset += val;
+    }
+
+    /* Upstream is now at the start of the buffered data. */
+    if (ThreadSeek(stream, resume) == 0)
+    {
+        sys->stats.retained += sys->buffer_length;
+        sys->buffer_length += end - start;
+    }
+    else
+    {   /* Keep the gap only, and continue from its end */
+        sys->buffer_length = end - start;
+        sys->eof = false;
+    }
+    sys->buffer_offset = start;
+    return 0;
+}
+
 static int ThreadControl(stream_t *stream, int query, ...)
 {
     stream_sys_t *sys = stream->p_sys;
@@ -165,6 +218,19 @@ static void *Thread(void *data)
 
         if (stream_offset < sys->buffer_offset)
         {   /* Need to seek backward */
+            uint64_t gap = sys->buffer_offset - stream_offset;
+
+            /* Either path counts as a single seek */
+            sys->stats.seeks++;
+
+            if (gap <= sys->seek_threshold
+             && sys->buffer_length + gap <= sys->buffer_size
+             && ThreadFillGap(stream, stream_offset) == 0)
+            {
+                assert(!sys->error);
+                continue;
+            }
+
             if (ThreadSeek(stream, stream_offset) == 0)
             {
                 sys->buffer_offset = stream_offset;
@@ -201,6 +267,7 @@ static void *Thread(void *data)
         if (sys->can_seek
          && history >= (sys->buffer_length + sys->seek_threshold))
         {
+            sys->stats.seeks++;
             if (ThreadSeek(stream, stream_offset) == 0)
             {
                 sys->buffer_offset = stream_offset;
@@ -256,6 +323,7 @@ static void *Thread(void *data)
 
         assert((size_t)val <= len);
         sys->buffer_length += val;
+        sys->stats.fetched += val;
         assert(sys->buffer_length <= sys->buffer_size);
         //msg_Dbg(stream, "buffer: %zu/%zu", sys->buffer_length,
         //        sys->buffer_size);
@@ -313,6 +381,11 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
         vlc_cond_signal(&sys->wait_space);
     }
 
+    if (BufferLevel(stream, &eof) > 0)
+        sys->stats.hits++;
+    else if (!eof)
+        sys->stats.misses++;
+
     while ((copy = BufferLevel(stream, &eof)) == 0 && !eof)
     {
         void *data[2];
@@ -337,6 +410,7 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
 
     memcpy(buf, sys->buffer + offset, copy);
     sys->stream_offset += copy;
+    sys->stats.served += copy;
     vlc_cond_signal(&sys->wait_space);
     vlc_mutex_unlock(&sys->lock);
     return copy;
@@ -382,6 +456,11 @@ static int Control(stream_t *stream, int query, va_list args)
         case STREAM_GET_TAGS:
         case STREAM_GET_TYPE:
             return VLC_EGENERIC;
+        case STREAM_GET_CACHE_STATS:
+            vlc_mutex_lock(&sys->lock);
+            *va_arg(args, struct vlc_stream_cache_stats *) = sys->stats;
+            vlc_mutex_unlock(&sys->lock);
+            break;
         case STREAM_SET_PAUSE_STATE:
         {
             bool paused = va_arg(args, unsigned);
@@ -468,6 +547,7 @@ static int Open(vlc_object_t *obj)
     sys->buffer_size = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
     sys->seek_threshold = var_InheritInteger(obj, "prefetch-seek-threshold");
     sys->controls = NULL;
+    memset(&sys->stats, 0, sizeof (sys->stats));
 
     uint64_t size = stream_Size(stream->s);
     if (size > 0)
@@ -526,6 +606,13 @@ static void Close (vlc_object_t *obj)
     vlc_join(sys->thread, NULL);
     vlc_interrupt_destroy(sys->interrupt);
 
+    unsigned reads = sys->stats.hits + sys->stats.misses;
+    msg_Dbg(stream, "fetched %"PRIu64" bytes, served %"PRIu64" bytes, "
+            "retained %"PRIu64" bytes, %u seeks, %u/%u reads hit (%u%%)",
+            sys->stats.fetched, sys->stats.served, sys->stats.retained,
+            sys->stats.seeks, sys->stats.hits, reads,
+            reads ? sys->stats.hits * 100 / reads : 0);
+
     while(sys->controls)
     {
         struct stream_ctrl *ctrl = sys->controls;
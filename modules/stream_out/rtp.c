@@ -1324,9 +1324,33 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
+/* Maximum number of packets sent per system call */
+#define RTP_BATCH 32
+
+/* Sends some of the packets, returns how many, or -1 on error */
+static int rtp_send_some( int fd, block_t *const *pktv, unsigned pktc )
 {
-    vlc_thread_set_name("vlc-rt-send");
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgv[RTP_BATCH];
+    struct iovec iov[RTP_BATCH];
+
+    assert( pktc <= RTP_BATCH );
+    for( unsigned i = 0; i < pktc; i++ )
+    {
+        iov[i].iov_base = pktv[i]->p_buffer;
+        iov[i].iov_len = pktv[i]->i_buffer;
+        msgv[i] = (struct mmsghdr) {
+            .msg_hdr = { .msg_iov = iov + i, .msg_iovlen = 1 },
+        };
+    }
+    return sendmmsg( fd, msgv, pktc, 0 );
+#else
+    (void) pktc;
+    if( send( fd, pktv[0]->p_buffer, pktv[0]->i_buffer, 0 ) == -1 )
+        return -1;
+    return 1;
+#endif
+}
 
 #ifdef _WIN32
 # undef ENOBUFS
@@ -1336,33 +1360,112 @@ static void* ThreadSend( void *data )
 # undef EWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
+
+/* Returns false if the socket is broken */
+static bool rtp_send_batch( int fd, block_t *const *pktv, unsigned pktc )
+{
+    for( unsigned i = 0; i < pktc; )
+    {
+        int val = rtp_send_some( fd, pktv + i, pktc - i );
+        if( val >= 0 )
+        {
+            i += val;
+            continue;
+        }
+
+        if( net_errno != EAGAIN && net_errno != EWOULDBLOCK
+         && net_errno != ENOBUFS && net_errno != ENOMEM )
+        {
+            int type;
+            getsockopt( fd, SOL_SOCKET, SO_TYPE,
+                        &type, &(socklen_t){ sizeof(type) });
+            if( type == SOCK_DGRAM )
+                /* ICMP soft error: ignore and retry */
+                send( fd, pktv[i]->p_buffer, pktv[i]->i_buffer, 0 );
+            else
+                /* Broken connection */
+                return false;
+        }
+        i++; /* the packet is lost */
+    }
+    return true;
+}
+
+#ifdef HAVE_SRTP
+/* Returns the encrypted packet, or NULL on error */
+static block_t *rtp_encrypt( sout_stream_id_sys_t *id, block_t *out )
+{
+    /* FIXME: this is awfully inefficient */
+    size_t len = out->i_buffer;
+    out = block_Realloc( out, 0, len + 10 );
+    out->i_buffer = len;
+
+    int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+    if( val )
+    {
+        msg_Dbg( id->p_stream, "SRTP sending error: %s",
+                 vlc_strerror_c(val) );
+        block_Release( out );
+        return NULL;
+    }
+    out->i_buffer = len;
+    return out;
+}
+#endif
+
+static void* ThreadSend( void *data )
+{
+    vlc_thread_set_name("vlc-rt-send");
+
     sout_stream_id_sys_t *id = data;
     vlc_tick_t i_caching = id->i_caching;
     block_t *out;
 
     while ((out = vlc_queue_DequeueKillable(&id->queue, &id->dead)) != NULL)
     {
+        block_t *pktv[RTP_BATCH];
+        unsigned pktc = 0;
+        vlc_tick_t deadline = out->i_dts + i_caching;
+
+#ifdef HAVE_SRTP
+        if( id->srtp )
+        {
+            out = rtp_encrypt( id, out );
+            if( out == NULL )
+                continue;
+        }
+#endif
+        vlc_tick_wait( deadline );
+        pktv[pktc++] = out;
+
+        /* Gather the packets that are already due, to send them at once.
+         * Pacing is preserved as no packet is sent ahead of its time. */
+        vlc_queue_Lock( &id->queue );
+        while( pktc < RTP_BATCH )
+        {
+            const block_t *next = vlc_queue_PeekUnlocked( &id->queue );
+
+            if( next == NULL || next->i_dts + i_caching > vlc_tick_now() )
+                break;
+            pktv[pktc++] = vlc_queue_DequeueUnlocked( &id->queue );
+        }
+        vlc_queue_Unlock( &id->queue );
+
 #ifdef HAVE_SRTP
         if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
+        {   /* These packets are already late: encrypt them now */
+            unsigned n = 1;
 
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            if( val )
+            for( unsigned i = 1; i < pktc; i++ )
             {
-                msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                continue;
+                block_t *pkt = rtp_encrypt( id, pktv[i] );
+                if( pkt != NULL )
+                    pktv[n++] = pkt;
             }
-            out->i_buffer = len;
+            pktc = n;
         }
 #endif
-        vlc_tick_wait (out->i_dts + i_caching);
-
-        ssize_t len = out->i_buffer;
+        out = pktv[pktc - 1];
 
         vlc_mutex_lock( &id->lock_sink );
         unsigned deadc = 0; /* How many dead sockets? */
@@ -1373,26 +1476,16 @@ static void* ThreadSend( void *data )
 #ifdef HAVE_SRTP
             if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+                for( unsigned j = 0; j < pktc; j++ )
+                    SendRTCP( id->sinkv[i].rtcp, pktv[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
-            {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
-            }
+            if( !rtp_send_batch( id->sinkv[i].rtp_fd, pktv, pktc ) )
+                deadv[deadc++] = id->sinkv[i].rtp_fd;
         }
         id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+        for( unsigned j = 0; j < pktc; j++ )
+            block_Release( pktv[j] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
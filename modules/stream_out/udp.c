@@ -22,6 +22,7 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +30,9 @@
 #ifdef HAVE_ARPA_INET_H
 #include <arpa/inet.h>
 #endif
+#ifdef __linux__
+#include <netinet/udp.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -39,6 +43,13 @@
 #include <vlc_memstream.h>
 #include "sdp_helper.h"
 
+/* Maximum number of datagrams sent per system call */
+#define UDP_BATCH 32
+/* Maximum number of blocks gathered per datagram */
+#define UDP_IOV_MAX 16
+/* Maximum payload of a segmentation offload send */
+#define UDP_GSO_MAX 65000
+
 struct sout_stream_udp
 {
     sout_access_out_t *access;
@@ -46,6 +57,7 @@ struct sout_stream_udp
     session_descriptor_t *sap;
     int fd;
     uint_fast16_t mtu;
+    bool gso;
 };
 
 static void *Add(sout_stream_t *stream, const es_format_t *fmt)
@@ -145,39 +157,163 @@ static int Control(sout_stream_t *stream, int query, va_list args)
     return VLC_SUCCESS;
 }
 
-static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
+struct udp_datagram
+{
+    struct iovec *iov;
+    unsigned iovlen;
+    size_t size;
+};
+
+#ifdef UDP_SEGMENT
+/**
+ * Sends equally-sized datagrams (but the last one) with a single system
+ * call, letting the kernel or the NIC split them (UDP GSO).
+ */
+static ssize_t SendSegmented(sout_access_out_t *access,
+                             const struct udp_datagram *dgv, unsigned dgc)
+{
+    struct sout_stream_udp *sys = access->p_sys;
+    size_t total = 0;
+
+    if (dgc < 2)
+        return -1;
+
+    /* The kernel splits at fixed offsets: only the last segment may be
+     * shorter, never longer, than the segment size. */
+    for (unsigned i = 0; i < dgc; i++) {
+        if (i + 1 < dgc ? dgv[i].size != dgv[0].size
+                        : dgv[i].size > dgv[0].size)
+            return -1;
+        total += dgv[i].size;
+    }
+
+    if (total > UDP_GSO_MAX)
+        return -1;
+
+    union {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr hdr = {
+        .msg_iov = dgv[0].iov,
+        /* The I/O vectors of all the datagrams are contiguous */
+        .msg_iovlen = (dgv[dgc - 1].iov + dgv[dgc - 1].iovlen) - dgv[0].iov,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (uint16_t));
+    memcpy(CMSG_DATA(cmsg), &(uint16_t){ dgv[0].size }, sizeof (uint16_t));
+
+    ssize_t val = sendmsg(sys->fd, &hdr, 0);
+    if (val < 0 && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT
+                 || errno == EOPNOTSUPP)) {
+        /* Not supported by the kernel or the outgoing interface */
+        msg_Dbg(access, "segmentation offload disabled: %s",
+                vlc_strerror_c(errno));
+        sys->gso = false;
+        return -1;
+    }
+
+    if (val < 0)
+        msg_Err(access, "send error: %s", vlc_strerror_c(errno));
+    return val < 0 ? 0 : val;
+}
+#endif
+
+static ssize_t SendDatagrams(sout_access_out_t *access,
+                             const struct udp_datagram *dgv, unsigned dgc)
 {
     struct sout_stream_udp *sys = access->p_sys;
     ssize_t total = 0;
 
-    while (block != NULL) {
-        struct iovec iov[16];
-        block_t *unsent = block;
-        unsigned iovlen = 0;
-        size_t tosend = 0;
+#ifdef UDP_SEGMENT
+    if (sys->gso) {
+        ssize_t val = SendSegmented(access, dgv, dgc);
+        if (val >= 0)
+            return val;
+    }
+#endif
 
-        /* Count how many blocks to gather */
-        do {
-            if (iovlen >= ARRAY_SIZE(iov))
-                break;
-            if (unsent->i_buffer + tosend > sys->mtu && likely(iovlen > 0))
-                break;
-
-            iov[iovlen].iov_base = unsent->p_buffer;
-            iov[iovlen].iov_len = unsent->i_buffer;
-            iovlen++;
-            tosend += unsent->i_buffer;
-            unsent = unsent->p_next;
-        } while (unsent != NULL);
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgv[UDP_BATCH];
 
-        /* Send */
-        struct msghdr hdr = { .msg_iov = iov, .msg_iovlen = iovlen };
+    assert(dgc <= ARRAY_SIZE(msgv));
+    for (unsigned i = 0; i < dgc; i++)
+        msgv[i] = (struct mmsghdr) {
+            .msg_hdr = { .msg_iov = dgv[i].iov, .msg_iovlen = dgv[i].iovlen },
+        };
+
+    for (unsigned i = 0; i < dgc;) {
+        int val = sendmmsg(sys->fd, msgv + i, dgc - i, 0);
+
+        if (val < 0) {
+            msg_Err(access, "send error: %s", vlc_strerror_c(errno));
+            i++; /* drop the failed datagram */
+            continue;
+        }
+
+        for (int j = 0; j < val; j++)
+            total += msgv[i + j].msg_len;
+        i += val;
+    }
+#else
+    for (unsigned i = 0; i < dgc; i++) {
+        struct msghdr hdr = {
+            .msg_iov = dgv[i].iov, .msg_iovlen = dgv[i].iovlen,
+        };
         ssize_t val = sendmsg(sys->fd, &hdr, 0);
 
         if (val < 0)
             msg_Err(access, "send error: %s", vlc_strerror_c(errno));
         else
             total += val;
+    }
+#endif
+    return total;
+}
+
+static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
+{
+    struct sout_stream_udp *sys = access->p_sys;
+    ssize_t total = 0;
+
+    while (block != NULL) {
+        struct iovec iov[UDP_BATCH * UDP_IOV_MAX];
+        struct udp_datagram dgv[UDP_BATCH];
+        block_t *unsent = block;
+        unsigned iovlen = 0, dgc = 0;
+
+        /* Gather the blocks into datagrams, and the datagrams into a batch */
+        do {
+            struct udp_datagram *dg = dgv + dgc++;
+
+            dg->iov = iov + iovlen;
+            dg->iovlen = 0;
+            dg->size = 0;
+
+            do {
+                if (dg->iovlen >= UDP_IOV_MAX)
+                    break;
+                if (unsent->i_buffer + dg->size > sys->mtu
+                 && likely(dg->iovlen > 0))
+                    break;
+
+                dg->iov[dg->iovlen].iov_base = unsent->p_buffer;
+                dg->iov[dg->iovlen].iov_len = unsent->i_buffer;
+                dg->iovlen++;
+                dg->size += unsent->i_buffer;
+                unsent = unsent->p_next;
+            } while (unsent != NULL);
+
+            iovlen += dg->iovlen;
+        } while (unsent != NULL && dgc < UDP_BATCH);
+
+        /* Send */
+        total += SendDatagrams(access, dgv, dgc);
 
         /* Free */
         do {
@@ -308,6 +444,11 @@ static int Open(vlc_object_t *obj)
     sys->access = access;
     sys->fd = fd;
     sys->mtu = var_InheritInteger(stream, "mtu");
+#ifdef UDP_SEGMENT
+    sys->gso = true;
+#else
+    sys->gso = false;
+#endif
 
     sout_mux_t *mux = sout_MuxNew(access, muxmod);
     if (mux == NULL) {
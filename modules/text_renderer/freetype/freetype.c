@@ -1231,6 +1231,12 @@ static int Create( filter_t *p_filter )
     if( !p_sys->ftcache )
         goto error;
 
+#ifdef HAVE_HARFBUZZ
+    p_sys->shaped_runs = NewShapedRunsCache();
+    if( !p_sys->shaped_runs )
+        goto error;
+#endif
+
     p_sys->i_scale = 100;
 
     /* default style to apply to incomplete segments styles */
@@ -1297,6 +1303,11 @@ static void Destroy( filter_t *p_filter )
         DumpFamilies( p_sys->fs );
 #endif
 
+#ifdef HAVE_HARFBUZZ
+    if( p_sys->shaped_runs )
+        vlc_lru_Release( p_sys->shaped_runs );
+#endif
+
     if( p_sys->ftcache )
         vlc_ftcache_Delete( p_sys->ftcache );
 
@@ -55,6 +55,18 @@ struct vlc_ftcache_custom_glyph_ref_Rec_
     unsigned refcount;
 };
 
+/* Derived glyphs cache key. Face IDs live as long as the cache. */
+struct vlc_ftcache_custom_glyph_key
+{
+    const vlc_face_id_t *faceid;
+    unsigned charmap_index;
+    FT_UInt index;
+    int width_px;
+    int height_px;
+    FT_Long style;
+    int radius;
+};
+
 vlc_face_id_t * vlc_ftcache_GetFaceID( vlc_ftcache_t *ftcache,
                                        const char *psz_fontfile, int i_idx )
 {
@@ -261,24 +273,28 @@ void vlc_ftcache_Glyph_Init( vlc_ftcache_glyph_t *g )
 }
 
 static vlc_ftcache_custom_glyph_ref_t
-vlc_ftcache_GetCustomGlyph( vlc_ftcache_t *ftcache, const char *psz_key )
+vlc_ftcache_GetCustomGlyph( vlc_ftcache_t *ftcache,
+                            const struct vlc_ftcache_custom_glyph_key *key )
 {
-    vlc_ftcache_custom_glyph_ref_t ref = vlc_lru_Get( ftcache->glyphs_lrucache, psz_key );
+    vlc_ftcache_custom_glyph_ref_t ref =
+        vlc_lru_GetKey( ftcache->glyphs_lrucache, key, sizeof(*key) );
     if( ref )
         ref->refcount++;
     return ref;
 }
 
 static vlc_ftcache_custom_glyph_ref_t
-vlc_ftcache_AddCustomGlyph( vlc_ftcache_t *ftcache, const char *psz_key, FT_Glyph glyph )
+vlc_ftcache_AddCustomGlyph( vlc_ftcache_t *ftcache,
+                            const struct vlc_ftcache_custom_glyph_key *key,
+                            FT_Glyph glyph )
 {
-    assert(!vlc_lru_Get( ftcache->glyphs_lrucache, psz_key ));
+    assert(!vlc_lru_GetKey( ftcache->glyphs_lrucache, key, sizeof(*key) ));
     vlc_ftcache_custom_glyph_ref_t ref = malloc( sizeof(*ref) );
     if( ref )
     {
         ref->refcount = 2;
         ref->glyph = glyph;
-        vlc_lru_Insert( ftcache->glyphs_lrucache, psz_key, ref );
+        vlc_lru_InsertKey( ftcache->glyphs_lrucache, key, sizeof(*key), ref );
     }
     return ref;
 }
@@ -310,18 +326,18 @@ FT_Glyph vlc_ftcache_GetOutlinedGlyph( vlc_ftcache_t *ftcache, const vlc_face_id
                                        void *priv,
                                        vlc_ftcache_custom_glyph_ref_t *p_ref )
 {
-    char *psz_key;
-    if( asprintf( &psz_key, "%s#%d#%d#%d,%d,%d,%lx,%d",
-                  faceid->psz_filename, faceid->idx,
-                  faceid->charmap_index, index,
-                  metrics->width_px, metrics->height_px, style, radius ) < 0 )
-    {
-        *p_ref = NULL;
-        return NULL;
-    }
+    struct vlc_ftcache_custom_glyph_key key;
+    memset( &key, 0, sizeof(key) ); /* padding is part of the key */
+    key.faceid = faceid;
+    key.charmap_index = faceid->charmap_index;
+    key.index = index;
+    key.width_px = metrics->width_px;
+    key.height_px = metrics->height_px;
+    key.style = style;
+    key.radius = radius;
 
     FT_Glyph glyph = NULL;
-    *p_ref = vlc_ftcache_GetCustomGlyph( ftcache, psz_key );
+    *p_ref = vlc_ftcache_GetCustomGlyph( ftcache, &key );
     if( *p_ref )
     {
         glyph = (*p_ref)->glyph;
@@ -329,13 +345,12 @@ FT_Glyph vlc_ftcache_GetOutlinedGlyph( vlc_ftcache_t *ftcache, const vlc_face_id
     else
     {
         if( !createOutline( sourceglyph, &glyph, priv ) )
-            *p_ref = vlc_ftcache_AddCustomGlyph( ftcache, psz_key, glyph );
+            *p_ref = vlc_ftcache_AddCustomGlyph( ftcache, &key, glyph );
         if( !*p_ref )
         {
             FT_Done_Glyph( glyph );
             return NULL;
         }
     }
-    free( psz_key );
     return glyph;
 }
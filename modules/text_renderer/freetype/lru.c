@@ -21,15 +21,20 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_list.h>
 #include "lru.h"
 
 struct vlc_lru_entry
 {
-    char *psz_key;
-    void *value;
     struct vlc_list node;
+    struct vlc_lru_entry *next; /* in the same bucket */
+    uint64_t hash;
+    void *value;
+    size_t keylen;
+    unsigned char key[];
 };
 
 struct vlc_lru
@@ -37,16 +42,40 @@ struct vlc_lru
     void (*releaseValue)(void *, void *);
     void *priv;
     unsigned max;
-    vlc_dictionary_t dict;
+    unsigned count;
+    size_t bucket_mask;
+    struct vlc_lru_entry **buckets;
     struct vlc_list list;
-    struct vlc_lru_entry *last;
 };
 
-static void vlc_lru_releaseentry( void *value, void *priv )
+/* FNV-1a: keys are hashed once, then looked up by integer */
+static uint64_t vlc_lru_Hash( const void *key, size_t keylen )
+{
+    const unsigned char *p = key;
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+    for( size_t i = 0; i < keylen; i++ )
+        h = (h ^ p[i]) * UINT64_C(0x100000001b3);
+    return h;
+}
+
+static struct vlc_lru_entry ** vlc_lru_Find( vlc_lru *lru, uint64_t hash,
+                                             const void *key, size_t keylen )
+{
+    struct vlc_lru_entry **pp = &lru->buckets[hash & lru->bucket_mask];
+
+    for( ; *pp; pp = &(*pp)->next )
+    {
+        const struct vlc_lru_entry *entry = *pp;
+        if( entry->hash == hash && entry->keylen == keylen &&
+            !memcmp( entry->key, key, keylen ) )
+            break;
+    }
+    return pp;
+}
+
+static void vlc_lru_releaseentry( vlc_lru *lru, struct vlc_lru_entry *entry )
 {
-    struct vlc_lru_entry *entry = value;
-    struct vlc_lru *lru = priv;
-    free(entry->psz_key);
     if( lru->releaseValue )
         lru->releaseValue( lru->priv, entry->value );
     free(entry);
@@ -58,38 +87,43 @@ vlc_lru * vlc_lru_New( unsigned max,
     vlc_lru *lru = malloc(sizeof(*lru));
     if( lru )
     {
+        size_t buckets = 1;
+        while( buckets < max )
+            buckets <<= 1;
+
+        lru->buckets = calloc( buckets, sizeof(*lru->buckets) );
+        if( !lru->buckets )
+        {
+            free( lru );
+            return NULL;
+        }
+        lru->bucket_mask = buckets - 1;
         lru->priv = priv;
         lru->max = max;
-        vlc_dictionary_init( &lru->dict, max );
+        lru->count = 0;
         vlc_list_init( &lru->list );
         lru->releaseValue = releaseValue;
-        lru->last = NULL;
     }
     return lru;
 }
 
 void vlc_lru_Release( vlc_lru *lru )
 {
-    vlc_dictionary_clear( &lru->dict, vlc_lru_releaseentry, lru );
+    struct vlc_lru_entry *entry;
+    vlc_list_foreach( entry, &lru->list, node )
+        vlc_lru_releaseentry( lru, entry );
+    free( lru->buckets );
     free( lru );
 }
 
-bool vlc_lru_HasKey( vlc_lru *lru, const char *psz_key )
+void * vlc_lru_GetKey( vlc_lru *lru, const void *key, size_t keylen )
 {
-    return vlc_dictionary_has_key( &lru->dict, psz_key );
-}
-
-void * vlc_lru_Get( vlc_lru *lru, const char *psz_key )
-{
-    struct vlc_lru_entry *entry = vlc_dictionary_value_for_key( &lru->dict, psz_key );
+    uint64_t hash = vlc_lru_Hash( key, keylen );
+    struct vlc_lru_entry *entry = *vlc_lru_Find( lru, hash, key, keylen );
     if( entry )
     {
         if( !vlc_list_is_first( &entry->node, &lru->list ) )
         {
-            if( vlc_list_is_last( &entry->node, &lru->list ) )
-            {
-                lru->last = vlc_list_entry(entry->node.prev, struct vlc_lru_entry, node);
-            }
             vlc_list_remove( &entry->node );
             vlc_list_add_after( &entry->node, &lru->list );
         }
@@ -98,44 +132,61 @@ void * vlc_lru_Get( vlc_lru *lru, const char *psz_key )
     return NULL;
 }
 
-void vlc_lru_Insert( vlc_lru *lru, const char *psz_key, void *value )
+void vlc_lru_InsertKey( vlc_lru *lru, const void *key, size_t keylen,
+                        void *value )
 {
-    struct vlc_lru_entry *entry = calloc(1, sizeof(*entry));
+    struct vlc_lru_entry *entry = malloc(sizeof(*entry) + keylen);
     if(!entry)
     {
-        lru->releaseValue(lru->priv, value);
-        return;
-    }
-    entry->psz_key = strdup( psz_key );
-    if(!entry->psz_key)
-    {
-        lru->releaseValue(lru->priv, value);
-        free(entry);
+        if( lru->releaseValue )
+            lru->releaseValue(lru->priv, value);
         return;
     }
+    entry->hash = vlc_lru_Hash( key, keylen );
     entry->value = value;
-    vlc_list_init( &entry->node );
+    entry->keylen = keylen;
+    memcpy( entry->key, key, keylen );
 
-    if( vlc_list_is_empty( &lru->list ) )
-        lru->last = entry;
-    vlc_dictionary_insert( &lru->dict, psz_key, entry );
+    struct vlc_lru_entry **pp = &lru->buckets[entry->hash & lru->bucket_mask];
+    entry->next = *pp;
+    *pp = entry;
     vlc_list_add_after( &entry->node, &lru->list );
 
-    if( (unsigned)vlc_dictionary_keys_count(&lru->dict) >= lru->max )
+    if( ++lru->count >= lru->max )
     {
-        struct vlc_lru_entry *toremove = lru->last;
-        lru->last = vlc_list_entry(toremove->node.prev, struct vlc_lru_entry, node);
-        vlc_list_remove(&toremove->node);
-        vlc_dictionary_remove_value_for_key(&lru->dict, toremove->psz_key, NULL, NULL);
-        vlc_lru_releaseentry(toremove, lru);
+        struct vlc_lru_entry *toremove =
+            vlc_list_last_entry_or_null( &lru->list, struct vlc_lru_entry, node );
+        pp = vlc_lru_Find( lru, toremove->hash, toremove->key, toremove->keylen );
+        assert( *pp == toremove );
+        *pp = toremove->next;
+        vlc_list_remove( &toremove->node );
+        lru->count--;
+        vlc_lru_releaseentry( lru, toremove );
     }
 }
 
+bool vlc_lru_HasKey( vlc_lru *lru, const char *psz_key )
+{
+    size_t keylen = strlen( psz_key ) + 1;
+    return *vlc_lru_Find( lru, vlc_lru_Hash( psz_key, keylen ),
+                          psz_key, keylen ) != NULL;
+}
+
+void * vlc_lru_Get( vlc_lru *lru, const char *psz_key )
+{
+    return vlc_lru_GetKey( lru, psz_key, strlen( psz_key ) + 1 );
+}
+
+void vlc_lru_Insert( vlc_lru *lru, const char *psz_key, void *value )
+{
+    vlc_lru_InsertKey( lru, psz_key, strlen( psz_key ) + 1, value );
+}
+
 void vlc_lru_Apply( vlc_lru *lru,
                     void(*func)(void *, const char *, void *),
                     void *priv )
 {
     struct vlc_lru_entry *entry;
     vlc_list_foreach( entry, &lru->list, node )
-        func( priv, entry->psz_key, entry->value );
+        func( priv, (const char *) entry->key, entry->value );
 }
@@ -34,6 +34,12 @@ bool   vlc_lru_HasKey( vlc_lru *lru, const char *psz_key );
 void * vlc_lru_Get( vlc_lru *lru, const char *psz_key );
 void   vlc_lru_Insert( vlc_lru *lru, const char *psz_key, void *value );
 
+/* Binary keys, compared bytewise: clear any padding of structured keys */
+void * vlc_lru_GetKey( vlc_lru *lru, const void *key, size_t keylen );
+void   vlc_lru_InsertKey( vlc_lru *lru, const void *key, size_t keylen,
+                          void *value );
+
+/* Only for caches using string keys */
 void   vlc_lru_Apply( vlc_lru *lru,
                       void(*func)(void *, const char *, void *),
                       void * );
@@ -64,7 +64,9 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "lru.h"
 
+#include <assert.h>
 #include <stdlib.h>
 
 /* Win32 */
@@ -92,6 +94,42 @@
 # warning YOU ARE MISSING FONTS FALLBACK. TEXT WILL BE INCORRECT
 #endif
 
+#ifdef HAVE_HARFBUZZ
+#define SHAPED_RUNS_CACHE_SIZE 256
+
+/**
+ * HarfBuzz output for a run, in visual order. Refcounted, as it is shared
+ * with the shaped runs cache.
+ */
+typedef struct shaped_run_t
+{
+    unsigned            i_refcount;
+    unsigned            i_count;
+    struct
+    {
+        hb_codepoint_t  i_glyph_index;
+        uint32_t        i_cluster;
+        hb_position_t   i_x_offset;
+        hb_position_t   i_y_offset;
+        hb_position_t   i_x_advance;
+        hb_position_t   i_y_advance;
+    } glyphs[];
+} shaped_run_t;
+
+/**
+ * Shaped runs cache key, followed by the code points of the run.
+ * The style only matters through the face and its size.
+ */
+typedef struct
+{
+    const vlc_face_id_t *p_faceid;
+    int                  i_width_px;
+    int                  i_height_px;
+    hb_script_t          script;
+    hb_direction_t       direction;
+} shaped_run_key_t;
+#endif
+
 /**
  * Within a paragraph, run_desc_t represents a run of characters
  * having the same font face, size, and style, Unicode script
@@ -107,7 +145,7 @@ typedef struct run_desc_t
 #ifdef HAVE_HARFBUZZ
     hb_script_t                 script;
     hb_direction_t              direction;
-    hb_buffer_t                *p_buffer;
+    shaped_run_t               *p_shaped;
 #endif
 
 } run_desc_t;
@@ -679,6 +717,130 @@ static int ItemizeParagraph( filter_t *p_filter, paragraph_t *p_paragraph )
 }
 
 #ifdef HAVE_HARFBUZZ
+static void ReleaseShapedRun( shaped_run_t *p_shaped )
+{
+    assert( p_shaped->i_refcount );
+    if( --p_shaped->i_refcount == 0 )
+        free( p_shaped );
+}
+
+static void ShapedRunsCacheRelease( void *priv, void *value )
+{
+    VLC_UNUSED( priv );
+    ReleaseShapedRun( value );
+}
+
+vlc_lru * NewShapedRunsCache( void )
+{
+    return vlc_lru_New( SHAPED_RUNS_CACHE_SIZE, ShapedRunsCacheRelease, NULL );
+}
+
+/**
+ * Shape a run, or reuse the result of a previous shaping of the same code
+ * points with the same face, size, script and direction.
+ */
+static shaped_run_t *ShapeRun( filter_t *p_filter, const run_desc_t *p_run,
+                               const uni_char_t *p_code_points,
+                               const vlc_ftcache_metrics_t *p_metrics )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_run_size = p_run->i_end_offset - p_run->i_start_offset;
+    const size_t i_keylen = sizeof( shaped_run_key_t )
+                          + i_run_size * sizeof( *p_code_points );
+
+    shaped_run_key_t header;
+    memset( &header, 0, sizeof( header ) ); /* padding is part of the key */
+    header.p_faceid = p_run->p_faceid;
+    header.i_width_px = p_metrics->width_px;
+    header.i_height_px = p_metrics->height_px;
+    header.script = p_run->script;
+    header.direction = p_run->direction;
+
+    unsigned char *p_key = malloc( i_keylen );
+    if( !p_key )
+        return NULL;
+    memcpy( p_key, &header, sizeof( header ) );
+    memcpy( p_key + sizeof( header ), p_code_points + p_run->i_start_offset,
+            i_run_size * sizeof( *p_code_points ) );
+
+    shaped_run_t *p_shaped = vlc_lru_GetKey( p_sys->shaped_runs, p_key, i_keylen );
+    if( p_shaped )
+    {
+        p_shaped->i_refcount++;
+        free( p_key );
+        return p_shaped;
+    }
+
+    FT_Face p_face = vlc_ftcache_LoadFaceByID( p_sys->ftcache, p_run->p_faceid,
+                                               p_metrics );
+    if( !p_face )
+        goto end;
+
+    hb_font_t *p_hb_font = hb_ft_font_create( p_face, 0 );
+    if( !p_hb_font )
+    {
+        msg_Err( p_filter,
+                 "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
+        goto end;
+    }
+
+    hb_buffer_t *p_buffer = hb_buffer_create();
+    if( !p_buffer )
+    {
+        msg_Err( p_filter,
+                 "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
+        hb_font_destroy( p_hb_font );
+        goto end;
+    }
+
+    hb_buffer_set_direction( p_buffer, p_run->direction );
+    hb_buffer_set_script( p_buffer, p_run->script );
+    hb_buffer_add_utf32( p_buffer,
+                         p_code_points + p_run->i_start_offset,
+                         i_run_size, 0, i_run_size );
+    hb_shape( p_hb_font, p_buffer, 0, 0 );
+
+    hb_font_destroy( p_hb_font );
+
+    unsigned int i_glyph_count;
+    const hb_glyph_info_t *p_infos =
+            hb_buffer_get_glyph_infos( p_buffer, &i_glyph_count );
+    const hb_glyph_position_t *p_positions =
+            hb_buffer_get_glyph_positions( p_buffer, &i_glyph_count );
+    if( i_glyph_count == 0 )
+    {
+        msg_Err( p_filter,
+                 "ShapeParagraphHarfBuzz() invalid glyph count in shaped run" );
+        hb_buffer_destroy( p_buffer );
+        goto end;
+    }
+
+    p_shaped = malloc( sizeof( *p_shaped )
+                     + i_glyph_count * sizeof( p_shaped->glyphs[0] ) );
+    if( p_shaped )
+    {
+        p_shaped->i_refcount = 1;
+        p_shaped->i_count = i_glyph_count;
+        for( unsigned int i = 0; i < i_glyph_count; ++i )
+        {
+            p_shaped->glyphs[i].i_glyph_index = p_infos[i].codepoint;
+            p_shaped->glyphs[i].i_cluster = p_infos[i].cluster;
+            p_shaped->glyphs[i].i_x_offset = p_positions[i].x_offset;
+            p_shaped->glyphs[i].i_y_offset = p_positions[i].y_offset;
+            p_shaped->glyphs[i].i_x_advance = p_positions[i].x_advance;
+            p_shaped->glyphs[i].i_y_advance = p_positions[i].y_advance;
+        }
+
+        p_shaped->i_refcount++; /* the cache reference */
+        vlc_lru_InsertKey( p_sys->shaped_runs, p_key, i_keylen, p_shaped );
+    }
+    hb_buffer_destroy( p_buffer );
+
+end:
+    free( p_key );
+    return p_shaped;
+}
+
 /**
  * Shape an itemized paragraph using HarfBuzz.
  * This is where the glyphs of complex scripts get their positions
@@ -727,57 +889,21 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             }
         }
 
-        vlc_face_id_t *p_faceid = p_run->p_faceid;
         const text_style_t *p_style = p_run->p_style;
 
-        if(!p_faceid)
+        if(!p_run->p_faceid)
             goto error;
 
         vlc_ftcache_metrics_t metrics;
         metrics.height_px = ConvertToLiveSize( p_filter, p_style );
         metrics.width_px = GetFontWidthForStyle( p_style, metrics.height_px );
 
-        FT_Face p_face = vlc_ftcache_LoadFaceByID( p_sys->ftcache, p_faceid, &metrics );
-        if(!p_face)
-            goto error;
-
-        hb_font_t *p_hb_font = hb_ft_font_create( p_face, 0 );
-        if( !p_hb_font )
-        {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
-            goto error;
-        }
-
-        p_run->p_buffer = hb_buffer_create();
-        if( !p_run->p_buffer )
-        {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
-            hb_font_destroy( p_hb_font );
-            goto error;
-        }
-
-        hb_buffer_set_direction( p_run->p_buffer, p_run->direction );
-        hb_buffer_set_script( p_run->p_buffer, p_run->script );
-        hb_buffer_add_utf32( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
-        hb_shape( p_hb_font, p_run->p_buffer, 0, 0 );
-
-        hb_font_destroy( p_hb_font );
-        p_hb_font = 0;
-
-        const unsigned length = hb_buffer_get_length( p_run->p_buffer );
-        if( length == 0 )
-        {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz() invalid glyph count in shaped run" );
+        p_run->p_shaped = ShapeRun( p_filter, p_run,
+                                    p_paragraph->p_code_points, &metrics );
+        if( !p_run->p_shaped )
             goto error;
-        }
 
-        i_total_glyphs += length;
+        i_total_glyphs += p_run->p_shaped->i_count;
     }
 
     p_new_paragraph = NewParagraph( p_filter, i_total_glyphs,
@@ -800,11 +926,8 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
         run_desc_t *p_run = p_paragraph->p_runs + i;
-        unsigned int i_glyph_count;
-        const hb_glyph_info_t *p_infos =
-                hb_buffer_get_glyph_infos( p_run->p_buffer, &i_glyph_count );;
-        const hb_glyph_position_t *p_positions =
-                hb_buffer_get_glyph_positions( p_run->p_buffer, &i_glyph_count );
+        const shaped_run_t *p_shaped = p_run->p_shaped;
+        const unsigned int i_glyph_count = p_shaped->i_count;
         for( unsigned int j = 0; j < i_glyph_count; ++j )
         {
             /*
@@ -817,11 +940,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             int i_run_index = p_run->direction == HB_DIRECTION_LTR ?
                     j : i_glyph_count - 1 - j;
             int i_source_index =
-                    p_infos[ i_run_index ].cluster + p_run->i_start_offset;
+                    p_shaped->glyphs[ i_run_index ].i_cluster + p_run->i_start_offset;
 
             p_new_paragraph->p_code_points[ i_index ] = 0;
             p_new_paragraph->pi_glyph_indices[ i_index ] =
-                p_infos[ i_run_index ].codepoint;
+                p_shaped->glyphs[ i_run_index ].i_glyph_index;
             p_new_paragraph->p_scripts[ i_index ] =
                 p_paragraph->p_scripts[ i_source_index ];
             p_new_paragraph->p_types[ i_index ] =
@@ -834,13 +957,13 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
                 p_new_paragraph->pp_ruby[ i_index ] =
                     p_paragraph->pp_ruby[ i_source_index ];
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_offset =
-                p_positions[ i_run_index ].x_offset;
+                p_shaped->glyphs[ i_run_index ].i_x_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_offset =
-                p_positions[ i_run_index ].y_offset;
+                p_shaped->glyphs[ i_run_index ].i_y_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_advance =
-                p_positions[ i_run_index ].x_advance;
+                p_shaped->glyphs[ i_run_index ].i_x_advance;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_advance =
-                p_positions[ i_run_index ].y_advance;
+                p_shaped->glyphs[ i_run_index ].i_y_advance;
 
             ++i_index;
         }
@@ -851,7 +974,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        ReleaseShapedRun( p_paragraph->p_runs[ i ].p_shaped );
     }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
@@ -861,8 +984,8 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 error:
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        if( p_paragraph->p_runs[ i ].p_buffer )
-            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        if( p_paragraph->p_runs[ i ].p_shaped )
+            ReleaseShapedRun( p_paragraph->p_runs[ i ].p_shaped );
     }
 
     if( p_new_paragraph )
@@ -105,3 +105,13 @@ typedef struct
  */
 int LayoutTextBlock( filter_t *p_filter, const layout_text_block_t *p_textblock,
                      line_desc_t **pp_lines, FT_BBox *p_bbox, int *pi_max_face_height );
+
+#ifdef HAVE_HARFBUZZ
+/**
+ * Create the cache of shaped runs, reused when the same text is laid out
+ * again with the same faces and sizes.
+ *
+ * It must be released before the ftcache its face IDs come from.
+ */
+vlc_lru * NewShapedRunsCache( void );
+#endif
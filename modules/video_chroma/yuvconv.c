@@ -0,0 +1,995 @@
+/*****************************************************************************
+ * yuvconv.c : SIMD YUV to RGBA and high bit depth YUV conversions
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Converts NV12, P010, I420_10L and I422_10L pictures to RGBA/BGRA, and the
+ * 10-bit formats to their 8-bit counterparts, without scaling.
+ *
+ * Each picture is split in horizontal slices converted in parallel. Every
+ * line goes through an AVX2 or NEON kernel when available, and through the
+ * C kernels otherwise; all of them produce bit-exact results.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef YUVCONV_TEST
+# undef NDEBUG
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+#include <vlc_executor.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined (__aarch64__) && defined (__ARM_NEON) && !defined (WORDS_BIGENDIAN)
+# include <arm_neon.h>
+# define HAVE_NEON_INTRINSICS 1
+#endif
+
+#define YUVCONV_MAX_THREADS 16
+/* Smallest number of luma lines worth a slice of their own */
+#define YUVCONV_SLICE_LINES 64
+
+#ifndef YUVCONV_TEST
+static int Open(filter_t *);
+
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads converting slices of each " \
+    "picture (0 = one per CPU).")
+
+vlc_module_begin()
+    set_description(N_("SIMD YUV conversions"))
+    set_shortname(N_("YUV conversions"))
+    set_subcategory(SUBCAT_VIDEO_VFILTER)
+    set_callback_video_converter(Open, 170)
+    add_integer_with_range("yuvconv-threads", 0, 0, YUVCONV_MAX_THREADS,
+                           THREADS_TEXT, THREADS_LONGTEXT)
+vlc_module_end()
+#endif
+
+/* Fixed point YUV to RGB coefficients, with 16 fractional bits */
+struct yuv_matrix
+{
+    int32_t y_offset;
+    int32_t c_offset;
+    int32_t y;
+    int32_t rv, gu, gv, bu;
+    bool bgra;
+};
+
+/* Converts one line; u and v are subsampled horizontally by 2 */
+typedef void (*rgba_line_t)(uint32_t *dst, const int16_t *y,
+                            const int16_t *u, const int16_t *v,
+                            unsigned width, const struct yuv_matrix *m);
+/* Narrows 16-bit samples to 8-bit with rounding and saturation */
+typedef void (*pack_line_t)(uint8_t *dst, const uint16_t *src,
+                            unsigned count, unsigned shift);
+/* Same as above, interleaving two planes */
+typedef void (*interleave_line_t)(uint8_t *dst, const uint16_t *u,
+                                  const uint16_t *v, unsigned count,
+                                  unsigned shift);
+
+struct yuvconv_kernels
+{
+    const char *name;
+    rgba_line_t rgba;
+    pack_line_t pack;
+    interleave_line_t interleave;
+};
+
+/*** C ***/
+#ifdef WORDS_BIGENDIAN
+# define PIXEL(r, g, b) (((r) << 24) | ((g) << 16) | ((b) << 8) | 0xff)
+#else
+# define PIXEL(r, g, b) ((r) | ((g) << 8) | ((b) << 16) | 0xff000000)
+#endif
+
+static inline uint32_t ClipU8(int32_t v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static void RGBALine_C(uint32_t *dst, const int16_t *y, const int16_t *u,
+                       const int16_t *v, unsigned width,
+                       const struct yuv_matrix *m)
+{
+    for (unsigned x = 0; x < width; x++)
+    {
+        int32_t luma = (y[x] - m->y_offset) * m->y + (1 << 15);
+        int32_t cb = u[x / 2] - m->c_offset;
+        int32_t cr = v[x / 2] - m->c_offset;
+        uint32_t r = ClipU8((luma + m->rv * cr) >> 16);
+        uint32_t g = ClipU8((luma - (m->gu * cb + m->gv * cr)) >> 16);
+        uint32_t b = ClipU8((luma + m->bu * cb) >> 16);
+
+        dst[x] = m->bgra ? PIXEL(b, g, r) : PIXEL(r, g, b);
+    }
+}
+
+static inline uint8_t Pack(unsigned v, unsigned shift)
+{
+    v = (v + (1u << (shift - 1))) >> shift;
+    return v > 255 ? 255 : v;
+}
+
+static void PackLine_C(uint8_t *dst, const uint16_t *src, unsigned count,
+                       unsigned shift)
+{
+    for (unsigned x = 0; x < count; x++)
+        dst[x] = Pack(src[x], shift);
+}
+
+static void InterleaveLine_C(uint8_t *dst, const uint16_t *u,
+                             const uint16_t *v, unsigned count,
+                             unsigned shift)
+{
+    for (unsigned x = 0; x < count; x++)
+    {
+        dst[2 * x] = Pack(u[x], shift);
+        dst[2 * x + 1] = Pack(v[x], shift);
+    }
+}
+
+static const struct yuvconv_kernels kernels_c = {
+    "C", RGBALine_C, PackLine_C, InterleaveLine_C,
+};
+
+/*** AVX2 ***/
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void RGBALine_AVX2(uint32_t *dst, const int16_t *y, const int16_t *u,
+                          const int16_t *v, unsigned width,
+                          const struct yuv_matrix *m)
+{
+    const __m256i y_offset = _mm256_set1_epi32(m->y_offset);
+    const __m256i c_offset = _mm256_set1_epi32(m->c_offset);
+    const __m256i ky = _mm256_set1_epi32(m->y);
+    const __m256i krv = _mm256_set1_epi32(m->rv);
+    const __m256i kgu = _mm256_set1_epi32(m->gu);
+    const __m256i kgv = _mm256_set1_epi32(m->gv);
+    const __m256i kbu = _mm256_set1_epi32(m->bu);
+    const __m256i rnd = _mm256_set1_epi32(1 << 15);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(255);
+    const __m256i alpha = _mm256_set1_epi32(0xff000000);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256i luma = _mm256_cvtepi16_epi32(
+                                _mm_loadu_si128((const __m128i *)(y + x)));
+        __m128i cu = _mm_loadl_epi64((const __m128i *)(u + x / 2));
+        __m128i cv = _mm_loadl_epi64((const __m128i *)(v + x / 2));
+
+        /* Each chroma sample covers two pixels */
+        __m256i cb = _mm256_sub_epi32(
+            _mm256_cvtepi16_epi32(_mm_unpacklo_epi16(cu, cu)), c_offset);
+        __m256i cr = _mm256_sub_epi32(
+            _mm256_cvtepi16_epi32(_mm_unpacklo_epi16(cv, cv)), c_offset);
+
+        luma = _mm256_add_epi32(_mm256_mullo_epi32(
+                            _mm256_sub_epi32(luma, y_offset), ky), rnd);
+
+        __m256i r = _mm256_add_epi32(luma, _mm256_mullo_epi32(cr, krv));
+        __m256i g = _mm256_sub_epi32(luma,
+                        _mm256_add_epi32(_mm256_mullo_epi32(cb, kgu),
+                                         _mm256_mullo_epi32(cr, kgv)));
+        __m256i b = _mm256_add_epi32(luma, _mm256_mullo_epi32(cb, kbu));
+
+        r = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(r, 16), zero),
+                             max);
+        g = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(g, 16), zero),
+                             max);
+        b = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(b, 16), zero),
+                             max);
+
+        if (m->bgra)
+        {
+            __m256i t = r;
+            r = b;
+            b = t;
+        }
+
+        __m256i px = _mm256_or_si256(
+                        _mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                        _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+        _mm256_storeu_si256((__m256i *)(dst + x), px);
+    }
+    RGBALine_C(dst + x, y + x, u + x / 2, v + x / 2, width - x, m);
+}
+
+VLC_AVX2
+static void PackLine_AVX2(uint8_t *dst, const uint16_t *src, unsigned count,
+                          unsigned shift)
+{
+    const __m256i rnd = _mm256_set1_epi16(1 << (shift - 1));
+    const __m128i bits = _mm_cvtsi32_si128(shift);
+    unsigned x = 0;
+
+    for (; x + 32 <= count; x += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + x + 16));
+
+        a = _mm256_srl_epi16(_mm256_adds_epu16(a, rnd), bits);
+        b = _mm256_srl_epi16(_mm256_adds_epu16(b, rnd), bits);
+
+        /* Packing works per 128-bits lane: restore the sample order */
+        _mm256_storeu_si256((__m256i *)(dst + x),
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b),
+                                     _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    PackLine_C(dst + x, src + x, count - x, shift);
+}
+
+VLC_AVX2
+static void InterleaveLine_AVX2(uint8_t *dst, const uint16_t *u,
+                                const uint16_t *v, unsigned count,
+                                unsigned shift)
+{
+    const __m256i rnd = _mm256_set1_epi16(1 << (shift - 1));
+    const __m128i bits = _mm_cvtsi32_si128(shift);
+    const __m256i order = _mm256_setr_epi8(
+        0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15,
+        0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+    unsigned x = 0;
+
+    for (; x + 16 <= count; x += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(u + x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(v + x));
+
+        a = _mm256_srl_epi16(_mm256_adds_epu16(a, rnd), bits);
+        b = _mm256_srl_epi16(_mm256_adds_epu16(b, rnd), bits);
+
+        /* Each lane holds 8 U then 8 V samples: interleave them in place */
+        _mm256_storeu_si256((__m256i *)(dst + 2 * x),
+            _mm256_shuffle_epi8(_mm256_packus_epi16(a, b), order));
+    }
+    InterleaveLine_C(dst + 2 * x, u + x, v + x, count - x, shift);
+}
+
+static const struct yuvconv_kernels kernels_avx2 = {
+    "AVX2", RGBALine_AVX2, PackLine_AVX2, InterleaveLine_AVX2,
+};
+#endif
+
+/*** NEON ***/
+#ifdef HAVE_NEON_INTRINSICS
+static void RGBALine_NEON(uint32_t *dst, const int16_t *y, const int16_t *u,
+                          const int16_t *v, unsigned width,
+                          const struct yuv_matrix *m)
+{
+    const int32x4_t y_offset = vdupq_n_s32(m->y_offset);
+    const int32x4_t c_offset = vdupq_n_s32(m->c_offset);
+    const int32x4_t rnd = vdupq_n_s32(1 << 15);
+    const int32x4_t zero = vdupq_n_s32(0);
+    const int32x4_t max = vdupq_n_s32(255);
+    const uint32x4_t alpha = vdupq_n_u32(0xff000000);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        int16x8_t luma = vld1q_s16(y + x);
+        int16x4_t cu = vld1_s16(u + x / 2);
+        int16x4_t cv = vld1_s16(v + x / 2);
+        /* Each chroma sample covers two pixels */
+        int16x4x2_t cbs = vzip_s16(cu, cu);
+        int16x4x2_t crs = vzip_s16(cv, cv);
+
+        for (unsigned h = 0; h < 2; h++)
+        {
+            int32x4_t l = vmovl_s16(h ? vget_high_s16(luma)
+                                      : vget_low_s16(luma));
+            int32x4_t cb = vsubq_s32(vmovl_s16(cbs.val[h]), c_offset);
+            int32x4_t cr = vsubq_s32(vmovl_s16(crs.val[h]), c_offset);
+
+            l = vmlaq_n_s32(rnd, vsubq_s32(l, y_offset), m->y);
+
+            int32x4_t r = vmlaq_n_s32(l, cr, m->rv);
+            int32x4_t g = vsubq_s32(l, vmlaq_n_s32(vmulq_n_s32(cb, m->gu),
+                                                   cr, m->gv));
+            int32x4_t b = vmlaq_n_s32(l, cb, m->bu);
+
+            r = vminq_s32(vmaxq_s32(vshrq_n_s32(r, 16), zero), max);
+            g = vminq_s32(vmaxq_s32(vshrq_n_s32(g, 16), zero), max);
+            b = vminq_s32(vmaxq_s32(vshrq_n_s32(b, 16), zero), max);
+
+            if (m->bgra)
+            {
+                int32x4_t t = r;
+                r = b;
+                b = t;
+            }
+
+            uint32x4_t px = vorrq_u32(
+                vorrq_u32(vreinterpretq_u32_s32(r),
+                          vshlq_n_u32(vreinterpretq_u32_s32(g), 8)),
+                vorrq_u32(vshlq_n_u32(vreinterpretq_u32_s32(b), 16), alpha));
+            vst1q_u32(dst + x + 4 * h, px);
+        }
+    }
+    RGBALine_C(dst + x, y + x, u + x / 2, v + x / 2, width - x, m);
+}
+
+static void PackLine_NEON(uint8_t *dst, const uint16_t *src, unsigned count,
+                          unsigned shift)
+{
+    const uint16x8_t rnd = vdupq_n_u16(1 << (shift - 1));
+    const int16x8_t bits = vdupq_n_s16(-(int)shift);
+    unsigned x = 0;
+
+    for (; x + 16 <= count; x += 16)
+    {
+        uint16x8_t a = vshlq_u16(vqaddq_u16(vld1q_u16(src + x), rnd), bits);
+        uint16x8_t b = vshlq_u16(vqaddq_u16(vld1q_u16(src + x + 8), rnd),
+                                 bits);
+
+        vst1q_u8(dst + x, vcombine_u8(vqmovn_u16(a), vqmovn_u16(b)));
+    }
+    PackLine_C(dst + x, src + x, count - x, shift);
+}
+
+static void InterleaveLine_NEON(uint8_t *dst, const uint16_t *u,
+                                const uint16_t *v, unsigned count,
+                                unsigned shift)
+{
+    const uint16x8_t rnd = vdupq_n_u16(1 << (shift - 1));
+    const int16x8_t bits = vdupq_n_s16(-(int)shift);
+    unsigned x = 0;
+
+    for (; x + 8 <= count; x += 8)
+    {
+        uint8x8x2_t uv;
+
+        uv.val[0] = vqmovn_u16(vshlq_u16(vqaddq_u16(vld1q_u16(u + x), rnd),
+                                         bits));
+        uv.val[1] = vqmovn_u16(vshlq_u16(vqaddq_u16(vld1q_u16(v + x), rnd),
+                                         bits));
+        vst2_u8(dst + 2 * x, uv);
+    }
+    InterleaveLine_C(dst + 2 * x, u + x, v + x, count - x, shift);
+}
+
+static const struct yuvconv_kernels kernels_neon = {
+    "NEON", RGBALine_NEON, PackLine_NEON, InterleaveLine_NEON,
+};
+#endif
+
+/*** Line loaders for the RGBA conversions ***/
+typedef void (*load_line_t)(const picture_t *src, unsigned line,
+                            unsigned chroma_line, unsigned width,
+                            int16_t *y, int16_t *u, int16_t *v);
+
+static void LoadNV12(const picture_t *src, unsigned line,
+                     unsigned chroma_line, unsigned width,
+                     int16_t *y, int16_t *u, int16_t *v)
+{
+    const uint8_t *py = src->p[0].p_pixels + line * src->p[0].i_pitch;
+    const uint8_t *puv = src->p[1].p_pixels
+                       + chroma_line * src->p[1].i_pitch;
+
+    for (unsigned x = 0; x < width; x++)
+        y[x] = py[x];
+    for (unsigned x = 0; x < (width + 1) / 2; x++)
+    {
+        u[x] = puv[2 * x];
+        v[x] = puv[2 * x + 1];
+    }
+}
+
+static void LoadP010(const picture_t *src, unsigned line,
+                     unsigned chroma_line, unsigned width,
+                     int16_t *y, int16_t *u, int16_t *v)
+{
+    const uint16_t *py = (const uint16_t *)(src->p[0].p_pixels
+                                            + line * src->p[0].i_pitch);
+    const uint16_t *puv = (const uint16_t *)(src->p[1].p_pixels
+                                             + chroma_line * src->p[1].i_pitch);
+
+    for (unsigned x = 0; x < width; x++)
+        y[x] = py[x] >> 6;
+    for (unsigned x = 0; x < (width + 1) / 2; x++)
+    {
+        u[x] = puv[2 * x] >> 6;
+        v[x] = puv[2 * x + 1] >> 6;
+    }
+}
+
+static void LoadPlanar10(const picture_t *src, unsigned line,
+                         unsigned chroma_line, unsigned width,
+                         int16_t *y, int16_t *u, int16_t *v)
+{
+    const uint16_t *py = (const uint16_t *)(src->p[0].p_pixels
+                                            + line * src->p[0].i_pitch);
+    const uint16_t *pu = (const uint16_t *)(src->p[1].p_pixels
+                                            + chroma_line * src->p[1].i_pitch);
+    const uint16_t *pv = (const uint16_t *)(src->p[2].p_pixels
+                                            + chroma_line * src->p[2].i_pitch);
+
+    /* Out of range samples would overflow the fixed point arithmetic */
+    for (unsigned x = 0; x < width; x++)
+        y[x] = __MIN(py[x], 1023);
+    for (unsigned x = 0; x < (width + 1) / 2; x++)
+    {
+        u[x] = __MIN(pu[x], 1023);
+        v[x] = __MIN(pv[x], 1023);
+    }
+}
+
+/*** Filter ***/
+
+/* Samples of the luma and chroma line buffers of the RGBA conversions */
+#define LUMA_SCRATCH(width) (((width) + 15) & ~15u)
+#define CHROMA_SCRATCH(width) ((((width) + 1) / 2 + 15) & ~15u)
+
+/* One plane of a 16-bit to 8-bit conversion */
+struct pack_plane
+{
+    uint8_t dst;
+    uint8_t src;
+    uint8_t src2;    /**< second plane to interleave (if interleave) */
+    bool interleave;
+    uint8_t samples; /**< samples per (subsampled) pixel */
+    uint8_t hshift;
+    uint8_t vshift;
+};
+
+typedef struct
+{
+    const struct yuvconv_kernels *kernels;
+    void (*convert)(filter_t *, picture_t *, const picture_t *,
+                    unsigned first, unsigned last, void *scratch);
+    unsigned width;
+
+    /* RGBA */
+    load_line_t load;
+    unsigned chroma_vshift;
+    struct yuv_matrix matrix;
+
+    /* 16-bit to 8-bit */
+    struct pack_plane planes[3];
+    unsigned plane_count;
+    unsigned shift;
+
+    vlc_executor_t *executor;
+    unsigned threads;
+    size_t scratch_size;
+    void *scratch;
+} filter_sys_t;
+
+struct yuvconv_slice
+{
+    struct vlc_runnable runnable;
+    filter_t *filter;
+    picture_t *dst;
+    const picture_t *src;
+    unsigned first;
+    unsigned last;
+    void *scratch;
+};
+
+static void ConvertRGBA(filter_t *filter, picture_t *dst,
+                        const picture_t *src, unsigned first, unsigned last,
+                        void *scratch)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned width = sys->width;
+    int16_t *y = scratch;
+    int16_t *u = y + LUMA_SCRATCH(width);
+    int16_t *v = u + CHROMA_SCRATCH(width);
+
+    for (unsigned line = first; line < last; line++)
+    {
+        sys->load(src, line, line >> sys->chroma_vshift, width, y, u, v);
+        sys->kernels->rgba((uint32_t *)(dst->p[0].p_pixels
+                                        + line * dst->p[0].i_pitch),
+                           y, u, v, width, &sys->matrix);
+    }
+}
+
+static void ConvertPack(filter_t *filter, picture_t *dst,
+                        const picture_t *src, unsigned first, unsigned last,
+                        void *scratch)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    for (unsigned i = 0; i < sys->plane_count; i++)
+    {
+        const struct pack_plane *plane = &sys->planes[i];
+        const plane_t *d = &dst->p[plane->dst];
+        const plane_t *s = &src->p[plane->src];
+        const plane_t *s2 = &src->p[plane->src2];
+        const unsigned mask = (1u << plane->vshift) - 1;
+        const unsigned start = (first + mask) >> plane->vshift;
+        const unsigned end = (last + mask) >> plane->vshift;
+        const unsigned count = ((sys->width + (1u << plane->hshift) - 1)
+                                >> plane->hshift) * plane->samples;
+
+        for (unsigned line = start; line < end; line++)
+        {
+            uint8_t *out = d->p_pixels + line * d->i_pitch;
+            const uint16_t *in = (const uint16_t *)(s->p_pixels
+                                                    + line * s->i_pitch);
+
+            if (plane->interleave)
+                sys->kernels->interleave(out, in,
+                    (const uint16_t *)(s2->p_pixels + line * s2->i_pitch),
+                    count, sys->shift);
+            else
+                sys->kernels->pack(out, in, count, sys->shift);
+        }
+    }
+    (void) scratch;
+}
+
+#ifndef YUVCONV_TEST
+static void RunSlice(void *opaque)
+{
+    struct yuvconv_slice *slice = opaque;
+    filter_sys_t *sys = slice->filter->p_sys;
+
+    sys->convert(slice->filter, slice->dst, slice->src, slice->first,
+                 slice->last, slice->scratch);
+}
+
+VIDEO_FILTER_WRAPPER_CLOSE(Convert, Close)
+
+static void Convert(filter_t *filter, picture_t *src, picture_t *dst)
+{
+    filter_sys_t *sys = filter->p_sys;
+    unsigned lines = src->format.i_y_offset + src->format.i_visible_height;
+    unsigned count = __MIN(sys->threads, lines / YUVCONV_SLICE_LINES);
+
+    dst->format.i_x_offset = src->format.i_x_offset;
+    dst->format.i_y_offset = src->format.i_y_offset;
+
+    if (count <= 1)
+    {
+        sys->convert(filter, dst, src, 0, lines, sys->scratch);
+        return;
+    }
+
+    /* Slices start on even lines, so that they share no chroma line */
+    struct yuvconv_slice slices[YUVCONV_MAX_THREADS];
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct yuvconv_slice *slice = &slices[i];
+
+        slice->filter = filter;
+        slice->dst = dst;
+        slice->src = src;
+        slice->first = (lines * i / count) & ~1u;
+        slice->last = (i + 1 < count) ? (lines * (i + 1) / count) & ~1u
+                                      : lines;
+        slice->scratch = (char *)sys->scratch + i * sys->scratch_size;
+        slice->runnable.run = RunSlice;
+        slice->runnable.userdata = slice;
+        vlc_executor_Submit(sys->executor, &slice->runnable);
+    }
+
+    vlc_executor_WaitIdle(sys->executor);
+}
+
+static void Close(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (sys->executor != NULL)
+        vlc_executor_Delete(sys->executor);
+    free(sys->scratch);
+    free(sys);
+}
+#endif
+
+static void SetupMatrix(struct yuv_matrix *m, const video_format_t *fmt,
+                        unsigned depth, bool bgra)
+{
+    video_color_space_t space = fmt->space;
+    video_color_range_t range = fmt->color_range;
+    const int scale = 1 << (depth - 8);
+    float kr, kb, ky, kc;
+
+    if (space == COLOR_SPACE_UNDEF)
+        space = fmt->i_visible_height > 576 ? COLOR_SPACE_BT709
+                                            : COLOR_SPACE_BT601;
+
+    switch (space)
+    {
+        case COLOR_SPACE_BT709:
+            kr = .2126f;
+            kb = .0722f;
+            break;
+        case COLOR_SPACE_BT2020:
+            kr = .2627f;
+            kb = .0593f;
+            break;
+        default:
+            kr = .299f;
+            kb = .114f;
+            break;
+    }
+
+    if (range == COLOR_RANGE_FULL)
+    {
+        ky = kc = 255.f / ((1 << depth) - 1);
+        m->y_offset = 0;
+    }
+    else
+    {
+        ky = 255.f / (219 * scale);
+        kc = 255.f / (224 * scale);
+        m->y_offset = 16 * scale;
+    }
+    m->c_offset = 128 * scale;
+
+    const float kg = 1.f - kr - kb;
+#define FIX(v) lroundf((v) * 65536.f)
+    m->y = FIX(ky);
+    m->rv = FIX(2.f * (1.f - kr) * kc);
+    m->gu = FIX(2.f * (1.f - kb) * kb / kg * kc);
+    m->gv = FIX(2.f * (1.f - kr) * kr / kg * kc);
+    m->bu = FIX(2.f * (1.f - kb) * kc);
+#undef FIX
+    m->bgra = bgra;
+}
+
+static int OpenRGBA(filter_t *filter, filter_sys_t *sys)
+{
+    const video_format_t *fmt = &filter->fmt_in.video;
+    unsigned depth = 10;
+
+    switch (filter->fmt_out.video.i_chroma)
+    {
+        case VLC_CODEC_RGBA:
+        case VLC_CODEC_BGRA:
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    switch (fmt->i_chroma)
+    {
+        case VLC_CODEC_NV12:
+            sys->load = LoadNV12;
+            sys->chroma_vshift = 1;
+            depth = 8;
+            break;
+        case VLC_CODEC_P010:
+            sys->load = LoadP010;
+            sys->chroma_vshift = 1;
+            break;
+        case VLC_CODEC_I420_10L:
+            sys->load = LoadPlanar10;
+            sys->chroma_vshift = 1;
+            break;
+        case VLC_CODEC_I422_10L:
+            sys->load = LoadPlanar10;
+            sys->chroma_vshift = 0;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    SetupMatrix(&sys->matrix, fmt, depth,
+                filter->fmt_out.video.i_chroma == VLC_CODEC_BGRA);
+    sys->convert = ConvertRGBA;
+    sys->scratch_size = (LUMA_SCRATCH(sys->width)
+                         + 2 * CHROMA_SCRATCH(sys->width)) * sizeof (int16_t);
+    return VLC_SUCCESS;
+}
+
+#define PLANE(d, s, s2, il, n, h, v) \
+    (struct pack_plane){ d, s, s2, il, n, h, v }
+
+static int OpenPack(filter_t *filter, filter_sys_t *sys)
+{
+    vlc_fourcc_t in = filter->fmt_in.video.i_chroma;
+    vlc_fourcc_t out = filter->fmt_out.video.i_chroma;
+
+    if (in == VLC_CODEC_P010 && out == VLC_CODEC_NV12)
+    {
+        sys->planes[0] = PLANE(0, 0, 0, false, 1, 0, 0);
+        sys->planes[1] = PLANE(1, 1, 0, false, 2, 1, 1);
+        sys->plane_count = 2;
+        sys->shift = 8;
+    }
+    else if (in == VLC_CODEC_I420_10L && out == VLC_CODEC_NV12)
+    {
+        sys->planes[0] = PLANE(0, 0, 0, false, 1, 0, 0);
+        sys->planes[1] = PLANE(1, 1, 2, true, 1, 1, 1);
+        sys->plane_count = 2;
+        sys->shift = 2;
+    }
+    else if ((in == VLC_CODEC_I420_10L && out == VLC_CODEC_I420)
+          || (in == VLC_CODEC_I422_10L && out == VLC_CODEC_I422))
+    {
+        unsigned vshift = in == VLC_CODEC_I420_10L;
+
+        sys->planes[0] = PLANE(0, 0, 0, false, 1, 0, 0);
+        sys->planes[1] = PLANE(1, 1, 0, false, 1, 1, vshift);
+        sys->planes[2] = PLANE(2, 2, 0, false, 1, 1, vshift);
+        sys->plane_count = 3;
+        sys->shift = 2;
+    }
+    else
+        return VLC_EGENERIC;
+
+    sys->convert = ConvertPack;
+    sys->scratch_size = 0;
+    return VLC_SUCCESS;
+}
+
+#ifndef YUVCONV_TEST
+static int Open(filter_t *filter)
+{
+    const video_format_t *in = &filter->fmt_in.video;
+    const video_format_t *out = &filter->fmt_out.video;
+
+    /* resizing not supported */
+    if (in->i_x_offset + in->i_visible_width
+            != out->i_x_offset + out->i_visible_width
+     || in->i_y_offset + in->i_visible_height
+            != out->i_y_offset + out->i_visible_height
+     || in->orientation != out->orientation)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->width = in->i_x_offset + in->i_visible_width;
+
+    if (OpenRGBA(filter, sys) != VLC_SUCCESS
+     && OpenPack(filter, sys) != VLC_SUCCESS)
+    {
+        free(sys);
+        return VLC_EGENERIC;
+    }
+
+    sys->kernels = &kernels_c;
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        sys->kernels = &kernels_avx2;
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+    if (vlc_CPU_ARM_NEON())
+        sys->kernels = &kernels_neon;
+#endif
+
+    int threads = var_InheritInteger(filter, "yuvconv-threads");
+    if (threads <= 0)
+        threads = vlc_GetCPUCount();
+    threads = VLC_CLIP(threads, 1, YUVCONV_MAX_THREADS);
+
+    sys->executor = NULL;
+    sys->threads = 1;
+    if (threads > 1)
+    {
+        sys->executor = vlc_executor_New(threads);
+        if (sys->executor != NULL)
+            sys->threads = threads;
+    }
+
+    sys->scratch = NULL;
+    if (sys->scratch_size > 0)
+    {
+        sys->scratch_size = (sys->scratch_size + 63) & ~(size_t)63;
+        sys->scratch = malloc(sys->threads * sys->scratch_size);
+        if (unlikely(sys->scratch == NULL))
+        {
+            if (sys->executor != NULL)
+                vlc_executor_Delete(sys->executor);
+            free(sys);
+            return VLC_ENOMEM;
+        }
+    }
+
+    filter->p_sys = sys;
+    filter->ops = &Convert_ops;
+
+    msg_Dbg(filter, "%4.4s to %4.4s, %s kernels, %u thread(s)",
+            (const char *)&in->i_chroma, (const char *)&out->i_chroma,
+            sys->kernels->name, sys->threads);
+    return VLC_SUCCESS;
+}
+#endif
+
+#ifdef YUVCONV_TEST
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vlc_rand.h>
+
+static const char *const isa_names[] = { "AVX2", "NEON" };
+
+static const struct yuvconv_kernels *GetKernels(unsigned isa)
+{
+    switch (isa)
+    {
+#ifdef HAVE_AVX2_INTRINSICS
+        case 0:
+            return vlc_CPU_AVX2() ? &kernels_avx2 : NULL;
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+        case 1:
+            return vlc_CPU_ARM_NEON() ? &kernels_neon : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static const struct
+{
+    vlc_fourcc_t in;
+    vlc_fourcc_t out;
+} conversions[] = {
+    { VLC_CODEC_NV12,     VLC_CODEC_RGBA },
+    { VLC_CODEC_NV12,     VLC_CODEC_BGRA },
+    { VLC_CODEC_P010,     VLC_CODEC_RGBA },
+    { VLC_CODEC_I420_10L, VLC_CODEC_BGRA },
+    { VLC_CODEC_I422_10L, VLC_CODEC_RGBA },
+    { VLC_CODEC_P010,     VLC_CODEC_NV12 },
+    { VLC_CODEC_I420_10L, VLC_CODEC_NV12 },
+    { VLC_CODEC_I420_10L, VLC_CODEC_I420 },
+    { VLC_CODEC_I422_10L, VLC_CODEC_I422 },
+};
+
+/* Odd sizes and sizes around the vector widths, then random ones */
+static const unsigned test_widths[] = {
+    1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 65, 127, 129, 1921,
+};
+#define RANDOM_SIZES 20
+
+/* Planes large enough for any of the formats, with unaligned lines */
+static void AllocPicture(picture_t *pic, unsigned width, unsigned height,
+                         bool random)
+{
+    memset(pic, 0, sizeof (*pic));
+    pic->i_planes = 3;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        size_t size;
+
+        p->i_pitch = 4 * width + 20;
+        p->i_lines = height;
+        size = (size_t)p->i_pitch * p->i_lines;
+        p->p_pixels = malloc(size);
+        assert(p->p_pixels != NULL);
+
+        if (random)
+            vlc_rand_bytes(p->p_pixels, size);
+        else
+            memset(p->p_pixels, 0x5A, size);
+    }
+}
+
+static void FreePicture(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+        free(pic->p[i].p_pixels);
+}
+
+static void TestConversion(const struct yuvconv_kernels *kernels,
+                           vlc_fourcc_t in, vlc_fourcc_t out,
+                           unsigned width, unsigned height)
+{
+    static const video_color_space_t spaces[] = {
+        COLOR_SPACE_UNDEF, COLOR_SPACE_BT601, COLOR_SPACE_BT709,
+        COLOR_SPACE_BT2020,
+    };
+    filter_t filter;
+    filter_sys_t ref, sys;
+
+    memset(&filter, 0, sizeof (filter));
+    filter.fmt_in.video.i_chroma = in;
+    filter.fmt_in.video.i_visible_height = height;
+    filter.fmt_in.video.space = spaces[vlc_lrand48() % ARRAY_SIZE(spaces)];
+    filter.fmt_in.video.color_range = (vlc_lrand48() & 1) ? COLOR_RANGE_FULL
+                                                          : COLOR_RANGE_LIMITED;
+    filter.fmt_out.video.i_chroma = out;
+
+    memset(&ref, 0, sizeof (ref));
+    ref.width = width;
+    if (OpenRGBA(&filter, &ref) != VLC_SUCCESS)
+    {
+        int ret = OpenPack(&filter, &ref);
+        assert(ret == VLC_SUCCESS);
+        (void) ret;
+    }
+    sys = ref;
+    ref.kernels = &kernels_c;
+    sys.kernels = kernels;
+
+    void *scratch = malloc(ref.scratch_size + 1);
+    picture_t src, expected, dst;
+
+    assert(scratch != NULL);
+    AllocPicture(&src, width, height, true);
+    AllocPicture(&expected, width, height, false);
+    AllocPicture(&dst, width, height, false);
+
+    filter.p_sys = &ref;
+    ref.convert(&filter, &expected, &src, 0, height, scratch);
+    filter.p_sys = &sys;
+    sys.convert(&filter, &dst, &src, 0, height, scratch);
+
+    for (int i = 0; i < dst.i_planes; i++)
+        if (memcmp(expected.p[i].p_pixels, dst.p[i].p_pixels,
+                   (size_t)dst.p[i].i_pitch * dst.p[i].i_lines))
+        {
+            fprintf(stderr, "%4.4s->%4.4s %s: mismatch in plane %d at "
+                    "%ux%u\n", (const char *)&in, (const char *)&out,
+                    kernels->name, i, width, height);
+            abort();
+        }
+
+    FreePicture(&dst);
+    FreePicture(&expected);
+    FreePicture(&src);
+    free(scratch);
+}
+
+int main(void)
+{
+    for (unsigned isa = 0; isa < ARRAY_SIZE(isa_names); isa++)
+    {
+        const struct yuvconv_kernels *kernels = GetKernels(isa);
+
+        if (kernels == NULL)
+        {
+            printf("%s: not available\n", isa_names[isa]);
+            continue;
+        }
+
+        for (size_t i = 0; i < ARRAY_SIZE(conversions); i++)
+        {
+            vlc_fourcc_t in = conversions[i].in, out = conversions[i].out;
+
+            for (size_t j = 0; j < ARRAY_SIZE(test_widths); j++)
+                for (unsigned height = 1; height <= 5; height += 2)
+                    TestConversion(kernels, in, out, test_widths[j], height);
+
+            for (unsigned j = 0; j < RANDOM_SIZES; j++)
+                TestConversion(kernels, in, out, 1 + vlc_lrand48() % 500,
+                               1 + vlc_lrand48() % 33);
+
+            printf("%4.4s->%4.4s %s: OK\n", (const char *)&in,
+                   (const char *)&out, kernels->name);
+        }
+    }
+    return 0;
+}
+#endif
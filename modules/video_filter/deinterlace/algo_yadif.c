@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_cpu.h>
+#include <vlc_executor.h>
 #include <vlc_picture.h>
 #include <vlc_filter.h>
 
@@ -46,6 +47,364 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+typedef void (*yadif_line_cb)(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                              uint8_t *next, int w, int prefs, int mrefs,
+                              int parity, int mode);
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+
+/* Same as yadif_filter_line_c(), 16 pixels at a time on 16-bit lanes. */
+
+static inline VLC_AVX2 __m256i YadifLoad( const uint8_t *p )
+{
+    return _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)p ) );
+}
+
+static inline VLC_AVX2 __m256i YadifAbsDiff( __m256i a, __m256i b )
+{
+    return _mm256_abs_epi16( _mm256_sub_epi16( a, b ) );
+}
+
+static inline VLC_AVX2 __m256i YadifAvg( __m256i a, __m256i b )
+{
+    return _mm256_srli_epi16( _mm256_add_epi16( a, b ), 1 );
+}
+
+/* CHECK(j) from yadif.h, only applied where mask is set */
+static inline VLC_AVX2 __m256i YadifCheck( const uint8_t *cur, int mrefs,
+                                           int prefs, int j, __m256i mask,
+                                           __m256i *score, __m256i *pred )
+{
+    __m256i s = _mm256_add_epi16(
+        _mm256_add_epi16(
+            YadifAbsDiff( YadifLoad( &cur[mrefs - 1 + j] ),
+                          YadifLoad( &cur[prefs - 1 - j] ) ),
+            YadifAbsDiff( YadifLoad( &cur[mrefs + j] ),
+                          YadifLoad( &cur[prefs - j] ) ) ),
+        YadifAbsDiff( YadifLoad( &cur[mrefs + 1 + j] ),
+                      YadifLoad( &cur[prefs + 1 - j] ) ) );
+
+    mask = _mm256_and_si256( mask, _mm256_cmpgt_epi16( *score, s ) );
+    *score = _mm256_blendv_epi8( *score, s, mask );
+    *pred = _mm256_blendv_epi8( *pred,
+                                YadifAvg( YadifLoad( &cur[mrefs + j] ),
+                                          YadifLoad( &cur[prefs - j] ) ),
+                                mask );
+    return mask;
+}
+
+static VLC_AVX2 void yadif_filter_line_avx2( uint8_t *dst, uint8_t *prev,
+                                             uint8_t *cur, uint8_t *next,
+                                             int w, int prefs, int mrefs,
+                                             int parity, int mode )
+{
+    uint8_t *prev2 = parity ? prev : cur;
+    uint8_t *next2 = parity ? cur  : next;
+    const __m256i ones = _mm256_set1_epi16( -1 );
+    int x;
+
+    for( x = 0; x + 16 <= w; x += 16 )
+    {
+        __m256i c = YadifLoad( &cur[x + mrefs] );
+        __m256i e = YadifLoad( &cur[x + prefs] );
+        __m256i p2 = YadifLoad( &prev2[x] );
+        __m256i n2 = YadifLoad( &next2[x] );
+        __m256i d = YadifAvg( p2, n2 );
+
+        __m256i diff0 = _mm256_srli_epi16( YadifAbsDiff( p2, n2 ), 1 );
+        __m256i diff1 = YadifAvg( YadifAbsDiff( YadifLoad( &prev[x + mrefs] ), c ),
+                                  YadifAbsDiff( YadifLoad( &prev[x + prefs] ), e ) );
+        __m256i diff2 = YadifAvg( YadifAbsDiff( YadifLoad( &next[x + mrefs] ), c ),
+                                  YadifAbsDiff( YadifLoad( &next[x + prefs] ), e ) );
+        __m256i diff = _mm256_max_epi16( _mm256_max_epi16( diff0, diff1 ),
+                                         diff2 );
+
+        __m256i pred = YadifAvg( c, e );
+        __m256i score = _mm256_add_epi16(
+            _mm256_add_epi16(
+                YadifAbsDiff( YadifLoad( &cur[x + mrefs - 1] ),
+                              YadifLoad( &cur[x + prefs - 1] ) ),
+                YadifAbsDiff( c, e ) ),
+            YadifAbsDiff( YadifLoad( &cur[x + mrefs + 1] ),
+                          YadifLoad( &cur[x + prefs + 1] ) ) );
+        score = _mm256_add_epi16( score, ones );
+
+        __m256i mask;
+        mask = YadifCheck( &cur[x], mrefs, prefs, -1, ones, &score, &pred );
+        YadifCheck( &cur[x], mrefs, prefs, -2, mask, &score, &pred );
+        mask = YadifCheck( &cur[x], mrefs, prefs, 1, ones, &score, &pred );
+        YadifCheck( &cur[x], mrefs, prefs, 2, mask, &score, &pred );
+
+        if( mode < 2 )
+        {
+            __m256i b = YadifAvg( YadifLoad( &prev2[x + 2 * mrefs] ),
+                                  YadifLoad( &next2[x + 2 * mrefs] ) );
+            __m256i f = YadifAvg( YadifLoad( &prev2[x + 2 * prefs] ),
+                                  YadifLoad( &next2[x + 2 * prefs] ) );
+            __m256i de = _mm256_sub_epi16( d, e );
+            __m256i dc = _mm256_sub_epi16( d, c );
+            __m256i bc = _mm256_sub_epi16( b, c );
+            __m256i fe = _mm256_sub_epi16( f, e );
+            __m256i max = _mm256_max_epi16( _mm256_max_epi16( de, dc ),
+                                            _mm256_min_epi16( bc, fe ) );
+            __m256i min = _mm256_min_epi16( _mm256_min_epi16( de, dc ),
+                                            _mm256_max_epi16( bc, fe ) );
+
+            diff = _mm256_max_epi16( _mm256_max_epi16( diff, min ),
+                                     _mm256_sub_epi16( _mm256_setzero_si256(),
+                                                       max ) );
+        }
+
+        /* diff is never negative, so this is the clipping from yadif.h */
+        pred = _mm256_max_epi16( pred, _mm256_sub_epi16( d, diff ) );
+        pred = _mm256_min_epi16( pred, _mm256_add_epi16( d, diff ) );
+
+        _mm_storeu_si128( (__m128i *)&dst[x],
+                          _mm_packus_epi16( _mm256_castsi256_si128( pred ),
+                                            _mm256_extracti128_si256( pred, 1 ) ) );
+    }
+
+    if( x < w )
+        yadif_filter_line_c( dst + x, prev + x, cur + x, next + x, w - x,
+                             prefs, mrefs, parity, mode );
+}
+#endif
+
+static yadif_line_cb YadifGetLineFilter( const filter_sys_t *p_sys )
+{
+    if( p_sys->chroma->pixel_size == 2 )
+        return yadif_filter_line_c_16bit;
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+        return yadif_filter_line_avx2;
+#endif
+#if defined(HAVE_X86ASM)
+    if( vlc_CPU_SSSE3() )
+        return vlcpriv_yadif_filter_line_ssse3;
+    if( vlc_CPU_SSE2() )
+        return vlcpriv_yadif_filter_line_sse2;
+#endif
+    return yadif_filter_line_c;
+}
+
+/*****************************************************************************
+ * Band-parallel rendering
+ *****************************************************************************/
+
+/** Parameters of one interpolated output picture */
+struct yadif_job
+{
+    picture_t *p_dst;
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    const picture_t *p_next;
+    yadif_line_cb filter;
+    int i_field;
+    int i_parity;
+};
+
+/** A horizontal band of one plane, rendered by a worker thread */
+struct yadif_band
+{
+    struct vlc_runnable runnable;
+    const struct yadif_job *job;
+    int i_plane;
+    int y_start;
+    int y_end;
+};
+
+static void YadifRenderBand( const struct yadif_job *job, int n,
+                             int y_start, int y_end )
+{
+    const plane_t *prevp = &job->p_prev->p[n];
+    const plane_t *curp  = &job->p_cur->p[n];
+    const plane_t *nextp = &job->p_next->p[n];
+    plane_t *dstp        = &job->p_dst->p[n];
+
+    for( int y = y_start; y < y_end; y++ )
+    {
+        if( (y % 2) == job->i_field  ||  job->i_parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+            job->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                         &prevp->p_pixels[y * prevp->i_pitch],
+                         &curp->p_pixels[y * curp->i_pitch],
+                         &nextp->p_pixels[y * nextp->i_pitch],
+                         dstp->i_visible_pitch,
+                         y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                         y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                         job->i_parity,
+                         mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+}
+
+static void YadifRunBand( void *opaque )
+{
+    struct yadif_band *band = opaque;
+
+    YadifRenderBand( band->job, band->i_plane, band->y_start, band->y_end );
+}
+
+static void YadifRender( yadif_sys_t *p_yadif, const struct yadif_job *job,
+                         unsigned i_threads )
+{
+    picture_t *p_dst = job->p_dst;
+
+    if( i_threads <= 1 || p_yadif->executor == NULL )
+    {
+        for( int n = 0; n < p_dst->i_planes; n++ )
+            YadifRenderBand( job, n, 1, p_dst->p[n].i_visible_lines - 1 );
+        return;
+    }
+
+    /* Lines 1 to i_visible_lines - 2 are rendered, the first and last ones
+     * are duplicated by the bands that contain their neighbours. */
+    struct yadif_band bands[PICTURE_PLANE_MAX * YADIF_MAX_THREADS];
+    unsigned i_bands = 0;
+
+    for( int n = 0; n < p_dst->i_planes; n++ )
+    {
+        const int i_lines = p_dst->p[n].i_visible_lines - 2;
+
+        for( unsigned i = 0; i < i_threads; i++ )
+        {
+            struct yadif_band *band = &bands[i_bands];
+
+            band->y_start = 1 + i_lines * i / i_threads;
+            band->y_end = 1 + i_lines * (i + 1) / i_threads;
+            if( band->y_start >= band->y_end )
+                continue;
+
+            band->job = job;
+            band->i_plane = n;
+            band->runnable.run = YadifRunBand;
+            band->runnable.userdata = band;
+            vlc_executor_Submit( p_yadif->executor, &band->runnable );
+            i_bands++;
+        }
+    }
+
+    vlc_executor_WaitIdle( p_yadif->executor );
+}
+
+/**
+ * Renders the current picture with every available line kernel, once
+ * without and once with the worker threads, and logs the timings.
+ */
+static void YadifBenchmark( filter_t *p_filter, struct yadif_job *job )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    yadif_sys_t *p_yadif = &p_sys->yadif;
+    const int i_loops = p_yadif->i_bench_loops;
+    struct yadif_kernel
+    {
+        const char *psz_name;
+        yadif_line_cb filter;
+    } kernels[4];
+    size_t i_kernels = 0;
+
+#define KERNEL(name, cb) \
+    kernels[i_kernels++] = (struct yadif_kernel){ name, cb }
+
+    if( p_sys->chroma->pixel_size == 2 )
+    {
+        KERNEL( "C 16-bit", yadif_filter_line_c_16bit );
+    }
+    else
+    {
+        KERNEL( "C", yadif_filter_line_c );
+#if defined(HAVE_X86ASM)
+        if( vlc_CPU_SSE2() )
+            KERNEL( "SSE2", vlcpriv_yadif_filter_line_sse2 );
+        if( vlc_CPU_SSSE3() )
+            KERNEL( "SSSE3", vlcpriv_yadif_filter_line_ssse3 );
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        if( vlc_CPU_AVX2() )
+            KERNEL( "AVX2", yadif_filter_line_avx2 );
+#endif
+    }
+#undef KERNEL
+
+    for( size_t k = 0; k < i_kernels; k++ )
+    {
+        job->filter = kernels[k].filter;
+
+        for( unsigned i_threads = 1; ; i_threads = p_yadif->i_threads )
+        {
+            vlc_tick_t start = vlc_tick_now();
+
+            for( int i = 0; i < i_loops; i++ )
+                YadifRender( p_yadif, job, i_threads );
+
+            vlc_tick_t elapsed = vlc_tick_now() - start;
+            msg_Info( p_filter, "yadif %s kernel, %u thread(s): "
+                      "%"PRId64" us per frame", kernels[k].psz_name,
+                      i_threads, US_FROM_VLC_TICK( elapsed ) / i_loops );
+
+            if( i_threads == p_yadif->i_threads )
+                break;
+        }
+    }
+
+    p_yadif->i_bench_loops = 0;
+}
+
+void YadifOpen( filter_t *p_filter, int i_threads, int i_bench_loops )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    yadif_sys_t *p_yadif = &p_sys->yadif;
+
+    if( i_threads <= 0 )
+        i_threads = vlc_GetCPUCount();
+    if( i_threads > YADIF_MAX_THREADS )
+        i_threads = YADIF_MAX_THREADS;
+
+    p_yadif->executor = NULL;
+    p_yadif->i_threads = 1;
+    p_yadif->i_bench_loops = i_bench_loops > 0 ? i_bench_loops : 0;
+
+    if( i_threads > 1 )
+    {
+        p_yadif->executor = vlc_executor_New( i_threads );
+        if( p_yadif->executor != NULL )
+            p_yadif->i_threads = i_threads;
+    }
+    msg_Dbg( p_filter, "Yadif using %u thread(s)", p_yadif->i_threads );
+}
+
+void YadifClose( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->yadif.executor != NULL )
+    {
+        vlc_executor_Delete( p_sys->yadif.executor );
+        p_sys->yadif.executor = NULL;
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -108,67 +467,24 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
-
-#if defined(HAVE_X86ASM)
-        if( vlc_CPU_SSSE3() )
-            filter = vlcpriv_yadif_filter_line_ssse3;
-        else
-        if( vlc_CPU_SSE2() )
-            filter = vlcpriv_yadif_filter_line_sse2;
-        else
-#endif
-            filter = yadif_filter_line_c;
-
-        if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
+        struct yadif_job job = {
+            .p_dst = p_dst,
+            .p_prev = p_prev,
+            .p_cur = p_cur,
+            .p_next = p_next,
+            .filter = YadifGetLineFilter( p_sys ),
+            .i_field = i_field,
+            .i_parity = yadif_parity,
+        };
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
+        if( unlikely(p_sys->yadif.i_bench_loops > 0) )
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+            YadifBenchmark( p_filter, &job );
+            job.filter = YadifGetLineFilter( p_sys );
         }
 
+        YadifRender( &p_sys->yadif, &job, p_sys->yadif.i_threads );
+
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
         return VLC_SUCCESS;
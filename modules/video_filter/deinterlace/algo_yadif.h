@@ -33,6 +33,24 @@
 /* Forward declarations */
 struct filter_t;
 struct picture_t;
+struct vlc_executor;
+
+/*****************************************************************************
+ * Data structures
+ *****************************************************************************/
+
+/** Maximum number of bands rendered in parallel. */
+#define YADIF_MAX_THREADS 16
+
+/**
+ * Yadif slice threading and benchmarking state.
+ */
+typedef struct
+{
+    struct vlc_executor *executor; /**< Band workers, NULL if none */
+    unsigned i_threads;   /**< Number of bands each plane is split into */
+    int i_bench_loops;    /**< Frames to render per benchmark run, 0 = off */
+} yadif_sys_t;
 
 /*****************************************************************************
  * Functions
@@ -90,4 +108,23 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
  */
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src );
 
+/**
+ * Sets up the Yadif worker threads.
+ *
+ * @param p_filter The filter instance. Must be non-NULL.
+ * @param i_threads Number of threads, or 0 to use one per CPU.
+ * @param i_bench_loops Benchmark the line kernels over this many frames
+ *                      when the first frame is rendered, or 0.
+ * @see YadifClose()
+ */
+void YadifOpen( filter_t *p_filter, int i_threads, int i_bench_loops );
+
+/**
+ * Stops the Yadif worker threads.
+ *
+ * @param p_filter The filter instance. Must be non-NULL.
+ * @see YadifOpen()
+ */
+void YadifClose( filter_t *p_filter );
+
 #endif
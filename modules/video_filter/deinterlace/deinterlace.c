@@ -280,6 +280,17 @@ static int Mouse( filter_t *p_filter,
                                     "Best simulation, but requires more CPU "\
                                     "and memory bandwidth.")
 
+#define YADIF_THREADS_TEXT N_("Yadif threads")
+#define YADIF_THREADS_LONGTEXT N_("Number of threads interpolating "\
+                                  "horizontal bands of each picture in the "\
+                                  "Yadif modes. 0 uses one thread per CPU.")
+
+#define YADIF_BENCH_TEXT N_("Yadif benchmark loops")
+#define YADIF_BENCH_LONGTEXT N_("If not zero, times the Yadif line "\
+                                "kernels over this many renderings of the "\
+                                "first picture, with and without threads, "\
+                                "and logs the results.")
+
 #define PHOSPHOR_DIMMER_TEXT N_("Phosphor old field dimmer strength")
 #define PHOSPHOR_DIMMER_LONGTEXT N_("This controls the strength of the "\
                                     "darkening filter that simulates CRT TV "\
@@ -304,6 +315,13 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "yadif-threads", 0, 0,
+                            YADIF_MAX_THREADS, YADIF_THREADS_TEXT,
+                            YADIF_THREADS_LONGTEXT )
+        change_safe ()
+    add_integer( FILTER_CFG_PREFIX "yadif-bench", 0, YADIF_BENCH_TEXT,
+                 YADIF_BENCH_LONGTEXT )
+        change_safe ()
     set_deinterlace_callback( Open )
 vlc_module_end ()
 
@@ -318,7 +336,8 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "yadif-threads",
+    "yadif-bench",
     NULL
 };
 
@@ -478,6 +497,7 @@ int Mouse( filter_t *p_filter,
 static void Close( filter_t *p_filter )
 {
     Flush( p_filter );
+    YadifClose( p_filter );
     free( p_filter->p_sys );
 }
 
@@ -536,6 +556,9 @@ notsupp:
         return VLC_ENOMEM;
 
     p_sys->chroma = chroma;
+    p_sys->yadif.executor = NULL;
+    p_sys->yadif.i_threads = 1;
+    p_sys->yadif.i_bench_loops = 0;
 
     InitDeinterlacingContext( &p_sys->context );
 
@@ -578,6 +601,12 @@ notsupp:
     GetOutputFormat( p_filter, &fmt, &p_filter->fmt_in.video );
 
     /* */
+    if( p_sys->context.pf_render_ordered == RenderYadif ||
+        p_sys->context.pf_render_single_pic == RenderYadifSingle )
+        YadifOpen( p_filter,
+                   var_GetInteger( p_filter, FILTER_CFG_PREFIX "yadif-threads" ),
+                   var_GetInteger( p_filter, FILTER_CFG_PREFIX "yadif-bench" ) );
+
     if( !strcmp( psz_mode, "phosphor" ) )
     {
         int i_c420 = var_GetInteger( p_filter,
@@ -77,6 +77,9 @@ typedef struct
 
     struct deinterlace_ctx   context;
 
+    /** Yadif worker threads; kept out of the union, see Flush() */
+    yadif_sys_t yadif;
+
     /* Algorithm-specific substructures */
     union {
         phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
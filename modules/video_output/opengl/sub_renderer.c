@@ -55,6 +55,12 @@ typedef struct {
 
     float    tex_width;
     float    tex_height;
+
+    /* Picture content held by the texture, to skip identical uploads */
+    picture_t *picture;
+    size_t   pixels_offset;
+    unsigned visible_width;
+    unsigned visible_height;
 } gl_region_t;
 
 struct vlc_gl_sub_renderer
@@ -206,6 +212,8 @@ vlc_gl_sub_renderer_Delete(struct vlc_gl_sub_renderer *sr)
     {
         if (sr->regions[i].texture)
             sr->vt->DeleteTextures(1, &sr->regions[i].texture);
+        if (sr->regions[i].picture)
+            picture_Release(sr->regions[i].picture);
     }
     free(sr->regions);
 
@@ -256,7 +264,38 @@ vlc_gl_sub_renderer_Prepare(struct vlc_gl_sub_renderer *sr, subpicture_t *subpic
             glr->right  =  2.0 * (r->i_x + r->fmt.i_visible_width ) / subpicture->i_original_picture_width  - 1.0;
             glr->bottom = -2.0 * (r->i_y + r->fmt.i_visible_height) / subpicture->i_original_picture_height + 1.0;
 
+            const size_t pixels_offset =
+                r->fmt.i_y_offset * r->p_picture->p->i_pitch +
+                r->fmt.i_x_offset * r->p_picture->p->i_pixel_pitch;
+
             glr->texture = 0;
+            glr->picture = NULL;
+            glr->pixels_offset = pixels_offset;
+            glr->visible_width = r->fmt.i_visible_width;
+            glr->visible_height = r->fmt.i_visible_height;
+
+            /* The pictures of the regions are not modified once rendered by
+             * the SPU unit, and static subtitles or logos keep the same
+             * (cached) picture from one frame to the next: a texture already
+             * holding the same content can be reused as is. */
+            bool uploaded = false;
+            for (int j = 0; j < last_count; j++) {
+                if (last[j].texture && last[j].picture == r->p_picture &&
+                    last[j].pixels_offset == pixels_offset &&
+                    last[j].visible_width == glr->visible_width &&
+                    last[j].visible_height == glr->visible_height &&
+                    last[j].width  == glr->width &&
+                    last[j].height == glr->height) {
+                    glr->texture = last[j].texture;
+                    glr->picture = last[j].picture;
+                    memset(&last[j], 0, sizeof(last[j]));
+                    uploaded = true;
+                    break;
+                }
+            }
+            if (uploaded)
+                continue;
+
             /* Try to recycle the textures allocated by the previous
                call to this function. */
             for (int j = 0; j < last_count; j++) {
@@ -264,14 +303,13 @@ vlc_gl_sub_renderer_Prepare(struct vlc_gl_sub_renderer *sr, subpicture_t *subpic
                     last[j].width  == glr->width &&
                     last[j].height == glr->height) {
                     glr->texture = last[j].texture;
+                    if (last[j].picture)
+                        picture_Release(last[j].picture);
                     memset(&last[j], 0, sizeof(last[j]));
                     break;
                 }
             }
 
-            const size_t pixels_offset =
-                r->fmt.i_y_offset * r->p_picture->p->i_pitch +
-                r->fmt.i_x_offset * r->p_picture->p->i_pixel_pitch;
             if (!glr->texture)
             {
                 /* Could not recycle a previous texture, generate a new one. */
@@ -292,6 +330,7 @@ vlc_gl_sub_renderer_Prepare(struct vlc_gl_sub_renderer *sr, subpicture_t *subpic
                                                     r->p_picture, &pixels_offset);
             if (ret != VLC_SUCCESS)
                 break;
+            glr->picture = picture_Hold(r->p_picture);
         }
     }
     else
@@ -303,6 +342,8 @@ vlc_gl_sub_renderer_Prepare(struct vlc_gl_sub_renderer *sr, subpicture_t *subpic
     for (int i = 0; i < last_count; i++) {
         if (last[i].texture)
             vlc_gl_interop_DeleteTextures(interop, &last[i].texture);
+        if (last[i].picture)
+            picture_Release(last[i].picture);
     }
     free(last);
 
@@ -30,6 +30,7 @@
 #endif
 
 #include <assert.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -47,6 +48,12 @@
 #define T_PITCH N_("Pitch")
 #define LT_PITCH N_("Video memory buffer pitch in bytes.")
 
+#define T_POOL N_("Buffers")
+#define LT_POOL N_("Number of video memory buffers that converters and " \
+                   "filters render into directly, or 0 to copy each picture " \
+                   "into a locked buffer. Pictures needing no conversion " \
+                   "are always copied.")
+
 #define T_CHROMA N_("Chroma")
 #define LT_CHROMA N_("Output chroma for the memory image as a 4-character " \
                       "string, eg. \"RV32\".")
@@ -69,6 +76,8 @@ vlc_module_begin()
         change_private()
     add_string("vmem-chroma", "RV16", T_CHROMA, LT_CHROMA)
         change_private()
+    add_integer("vmem-pool", 0, T_POOL, LT_POOL)
+        change_private()
 
     set_callback_display(Open, 0)
 vlc_module_end()
@@ -76,10 +85,13 @@ vlc_module_end()
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
+/* Application buffer rendered into directly */
 typedef struct
 {
     void *id;
-} picture_sys_t;
+    void *planes[PICTURE_PLANE_MAX];
+    atomic_uint *pictures; /**< Live pictures count, see Pool() */
+} vmem_buffer_t;
 
 /* NOTE: the callback prototypes must match those of LibVLC */
 typedef struct vout_display_sys_t {
@@ -92,6 +104,11 @@ typedef struct vout_display_sys_t {
 
     unsigned pitches[PICTURE_PLANE_MAX];
     unsigned lines[PICTURE_PLANE_MAX];
+
+    vmem_buffer_t *buffers;
+    unsigned buffer_count;
+    atomic_uint buffer_pictures;
+    bool copy_warned;
 } vout_display_sys_t;
 
 typedef unsigned (*vlc_format_cb)(void **, char *, unsigned *, unsigned *,
@@ -100,6 +117,7 @@ typedef unsigned (*vlc_format_cb)(void **, char *, unsigned *, unsigned *,
 static void           Prepare(vout_display_t *, picture_t *, subpicture_t *, vlc_tick_t);
 static void           Display(vout_display_t *, picture_t *);
 static int            Control(vout_display_t *, int);
+static picture_pool_t *Pool(vout_display_t *, unsigned);
 
 static const struct vlc_display_operations ops = {
     .close = Close,
@@ -108,6 +126,14 @@ static const struct vlc_display_operations ops = {
     .control = Control,
 };
 
+static const struct vlc_display_operations ops_pool = {
+    .close = Close,
+    .prepare = Prepare,
+    .display = Display,
+    .control = Control,
+    .pool = Pool,
+};
+
 /*****************************************************************************
  * Open: allocates video thread
  *****************************************************************************
@@ -133,6 +159,10 @@ static int Open(vout_display_t *vd,
     sys->display = var_InheritAddress(vd, "vmem-display");
     sys->cleanup = var_InheritAddress(vd, "vmem-cleanup");
     sys->opaque = var_InheritAddress(vd, "vmem-data");
+    sys->buffers = NULL;
+    sys->buffer_count = var_InheritInteger(vd, "vmem-pool");
+    atomic_init(&sys->buffer_pictures, 0);
+    sys->copy_warned = false;
 
     /* Define the video format */
     video_format_t fmt;
@@ -219,7 +249,7 @@ static int Open(vout_display_t *vd,
     *fmtp = fmt;
 
     vd->sys     = sys;
-    vd->ops     = &ops;
+    vd->ops     = sys->buffer_count > 0 ? &ops_pool : &ops;
 
     (void) context;
     return VLC_SUCCESS;
@@ -229,16 +259,150 @@ static void Close(vout_display_t *vd)
 {
     vout_display_sys_t *sys = vd->sys;
 
+    /* The application buffers are released by the cleanup callback */
+    assert(atomic_load_explicit(&sys->buffer_pictures,
+                                memory_order_relaxed) == 0);
     if (sys->cleanup)
         sys->cleanup(sys->opaque);
+    free(sys->buffers);
     free(sys);
 }
 
+static void DestroyBufferPicture(picture_t *pic)
+{
+    vmem_buffer_t *buf = pic->p_sys;
+
+    atomic_fetch_sub_explicit(buf->pictures, 1, memory_order_release);
+}
+
+static picture_t *NewBufferPicture(vout_display_t *vd, vmem_buffer_t *buf)
+{
+    vout_display_sys_t *sys = vd->sys;
+    picture_resource_t rsc = {
+        .p_sys = buf,
+        .pf_destroy = DestroyBufferPicture,
+    };
+
+    for (unsigned i = 0; i < PICTURE_PLANE_MAX; i++) {
+        rsc.p[i].p_pixels = buf->planes[i];
+        rsc.p[i].i_lines  = sys->lines[i];
+        rsc.p[i].i_pitch  = sys->pitches[i];
+    }
+
+    picture_t *pic = picture_NewFromResource(vd->fmt, &rsc);
+    if (likely(pic != NULL))
+        atomic_fetch_add_explicit(buf->pictures, 1, memory_order_relaxed);
+    return pic;
+}
+
+/* Wraps application buffers into pictures, so that the converters render
+ * directly into them. The buffers are locked once, for the lifetime of the
+ * display. If the pool is released, e.g. when the display is reset, the
+ * buffers are wrapped again once the pictures of the previous pool are all
+ * gone. */
+static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    if (sys->buffer_count == 0)
+        return NULL; /* unusable buffers */
+
+    if (atomic_load_explicit(&sys->buffer_pictures,
+                             memory_order_acquire) > 0) {
+        msg_Warn(vd, "application buffers still in use");
+        return NULL;
+    }
+
+    if (sys->buffer_count < count)
+        msg_Warn(vd, "%u buffers requested, only %u provided",
+                 count, sys->buffer_count);
+
+    /* The count comes from the application: do not use the stack */
+    picture_t **pictures = vlc_alloc(sys->buffer_count, sizeof (*pictures));
+    if (unlikely(pictures == NULL))
+        return NULL;
+
+    if (sys->buffers == NULL) {
+        sys->buffers = vlc_alloc(sys->buffer_count, sizeof (*sys->buffers));
+        if (unlikely(sys->buffers == NULL)) {
+            free(pictures);
+            return NULL;
+        }
+
+        for (unsigned i = 0; i < sys->buffer_count; i++) {
+            vmem_buffer_t *buf = &sys->buffers[i];
+
+            memset(buf->planes, 0, sizeof (buf->planes));
+            buf->id = sys->lock(sys->opaque, buf->planes);
+            buf->pictures = &sys->buffer_pictures;
+        }
+    }
+
+    unsigned n;
+
+    for (n = 0; n < sys->buffer_count; n++) {
+        pictures[n] = NewBufferPicture(vd, &sys->buffers[n]);
+        if (unlikely(pictures[n] == NULL))
+            break;
+    }
+
+    picture_pool_t *pool = NULL;
+    if (n == sys->buffer_count)
+        pool = picture_pool_New(n, pictures);
+
+    if (pool == NULL) {
+        while (n > 0)
+            picture_Release(pictures[--n]);
+        free(pictures);
+        free(sys->buffers);
+        sys->buffers = NULL;
+        sys->buffer_count = 0;
+        msg_Err(vd, "cannot render into the application buffers");
+        return NULL;
+    }
+    free(pictures);
+
+    msg_Dbg(vd, "rendering into %u application buffers", n);
+    return pool;
+}
+
+static vmem_buffer_t *GetBuffer(vout_display_sys_t *sys, const picture_t *pic)
+{
+    if (sys->buffers == NULL)
+        return NULL;
+
+    /* Pictures from the pool are clones sharing the buffer pointer */
+    for (unsigned i = 0; i < sys->buffer_count; i++)
+        if (pic->p_sys == &sys->buffers[i])
+            return &sys->buffers[i];
+    return NULL;
+}
+
 static void Prepare(vout_display_t *vd, picture_t *pic, subpicture_t *subpic,
                     vlc_tick_t date)
 {
     VLC_UNUSED(date);
     vout_display_sys_t *sys = vd->sys;
+    vmem_buffer_t *buf = GetBuffer(sys, pic);
+
+    if (buf != NULL) {
+        /* Rendered in place: nothing to copy */
+        sys->pic_opaque = buf->id;
+        if (sys->unlock != NULL)
+            sys->unlock(sys->opaque, buf->id, buf->planes);
+        (void) subpic;
+        return;
+    }
+
+    if (sys->buffer_count > 0 && !sys->copy_warned) {
+        /* The picture did not go through a converter (nor a filter) writing
+         * into the display pool, e.g. the decoder outputs the display format
+         * as is. */
+        msg_Warn(vd, "picture not rendered into an application buffer, "
+                 "copying");
+        sys->copy_warned = true;
+    }
+
     picture_resource_t rsc = { .p_sys = NULL };
     void *planes[PICTURE_PLANE_MAX];
 
@@ -704,6 +704,7 @@ int vlc_aout_stream_Play(vlc_aout_stream *stream, block_t *block)
 {
     aout_owner_t *owner = aout_stream_owner(stream);
     audio_output_t *aout = aout_stream_aout(stream);
+    struct vlc_tracer *tracer = aout_stream_tracer(stream);
 
     assert (block->i_pts != VLC_TICK_INVALID);
 
@@ -736,7 +737,11 @@ int vlc_aout_stream_Play(vlc_aout_stream *stream, block_t *block)
             vlc_mutex_unlock (&owner->vp.lock);
         }
 
+        if (tracer != NULL)
+            vlc_tracer_TraceBegin(tracer, "RENDER", stream->str_id, "filter");
         block = aout_FiltersPlay(stream->filters, block, stream->sync.rate);
+        if (tracer != NULL)
+            vlc_tracer_TraceEnd(tracer, "RENDER", stream->str_id, "filter");
         if (block == NULL)
             return ret;
     }
@@ -803,7 +808,11 @@ int vlc_aout_stream_Play(vlc_aout_stream *stream, block_t *block)
     /* Output */
     stream->sync.discontinuity = false;
     stream->timing.played_samples += block->i_nb_samples;
+    if (tracer != NULL)
+        vlc_tracer_TraceBegin(tracer, "RENDER", stream->str_id, "play");
     aout->play(aout, block, play_date);
+    if (tracer != NULL)
+        vlc_tracer_TraceEnd(tracer, "RENDER", stream->str_id, "play");
 
     atomic_fetch_add_explicit(&stream->buffers_played, 1, memory_order_relaxed);
     return ret;
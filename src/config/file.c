@@ -431,6 +431,7 @@ int (config_SaveConfigFile) (libvlc_int_t *p_this)
         if (p->conf.count == 0)
             continue;
 
+        vlc_plugin_LoadParams(p);
         fprintf( file, "[%s]", module_get_object (p_parser) );
         if( p_parser->psz_longname )
             fprintf( file, " # %s\n\n", p_parser->psz_longname );
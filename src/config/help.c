@@ -591,7 +591,7 @@ static void Usage (libvlc_int_t *p_this, char const *psz_search)
     const bool desc = var_InheritBool(p_this, "help-verbose");
 
     /* Enumerate the config for each module */
-    for (const vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
+    for (vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
     {
         const module_t *m = p->module;
         const module_config_t *section = NULL;
@@ -617,6 +617,7 @@ static void Usage (libvlc_int_t *p_this, char const *psz_search)
             printf("  %s\n", _("This module has no options."));
 
         /* Print module options */
+        vlc_plugin_LoadParams(p);
         for (size_t j = 0; j < p->conf.size; j++)
         {
             const struct vlc_param *param = p->conf.params + j;
@@ -378,11 +378,24 @@ static int LoadDecoder( decoder_t *p_dec, bool b_packetizer, es_format_t *fmt_in
             [AUDIO_ES] = "audio decoder",
             [SPU_ES] = "spu decoder",
         };
+        /* Decoders are not cached: whether a hardware decoder accepts a
+         * codec also depends on the video size, the device state... and
+         * one failure must not demote it for good. */
         p_dec->p_module = module_need_var( p_dec, caps[p_dec->fmt_in->i_cat],
                                            "codec" );
     }
     else
-        p_dec->p_module = module_need_var( p_dec, "packetizer", "packetizer" );
+    {
+        /* Remember which packetizer accepted the same codec and profile */
+        const struct vlc_probe_key key = {
+            .fourcc = p_dec->fmt_in->i_codec,
+            .profile = p_dec->fmt_in->i_profile,
+        };
+
+        p_dec->p_module = module_need_cached( VLC_OBJECT(p_dec), "packetizer",
+            "packetizer",
+            var_InheritBool( p_dec, "module-probe-cache" ) ? &key : NULL );
+    }
 
     if( !p_dec->p_module )
     {
@@ -1326,9 +1339,14 @@ static void ModuleThread_QueueVideo( decoder_t *p_dec, picture_t *p_pic )
     if (success != VLC_SUCCESS)
         vout_lost++;
 
+    unsigned pool_waits = 0;
+    if( p_owner->out_pool != NULL )
+        pool_waits = picture_pool_GetResetWaits( p_owner->out_pool );
+
     vlc_fifo_Unlock(p_owner->p_fifo);
 
-    decoder_Notify(p_owner, on_new_video_stats, 1, vout_lost, displayed, vout_late);
+    decoder_Notify(p_owner, on_new_video_stats, 1, vout_lost, displayed, vout_late,
+                   pool_waits);
 }
 
 static vlc_decoder_device * thumbnailer_get_device( decoder_t *p_dec )
@@ -1532,7 +1550,11 @@ static void DecoderThread_DecodeBlock( vlc_input_decoder_t *p_owner, vlc_frame_t
                             frame->i_pts, frame->i_dts );
     }
 
+    if ( tracer != NULL )
+        vlc_tracer_TraceBegin( tracer, "DEC", p_owner->psz_id, "decode" );
     int ret = p_dec->pf_decode( p_dec, frame );
+    if ( tracer != NULL )
+        vlc_tracer_TraceEnd( tracer, "DEC", p_owner->psz_id, "decode" );
     switch( ret )
     {
         case VLCDEC_SUCCESS:
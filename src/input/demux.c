@@ -36,6 +36,9 @@
 #include <vlc_strings.h>
 #include "input_internal.h"
 
+/* Number of leading bytes identifying the media type for the probe cache */
+#define DEMUX_SIGNATURE_SIZE 8
+
 typedef const struct
 {
     char const key[20];
@@ -163,16 +166,16 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_input,
     p_demux->ops        = NULL;
 
     char *modbuf = NULL;
+    char *type = NULL;
     bool strict = true;
+    struct vlc_probe_key key = { .extension = NULL };
 
     if (!strcasecmp(module, "any" ) || module[0] == '\0') {
         /* Look up demux by content type for hard to detect formats */
-        char *type = stream_MimeType(s);
+        type = stream_MimeType(s);
 
-        if (type != NULL) {
+        if (type != NULL)
             module = demux_NameFromMimeType(type);
-            free(type);
-        }
         strict = false;
     }
 
@@ -181,20 +184,41 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_input,
         const char *ext = strrchr(p_demux->psz_filepath, '.');
 
         if (ext != NULL) {
+            key.extension = ext + 1;
             if (b_preparsing && !vlc_ascii_strcasecmp(ext, ".mp3"))
                 module = "mpga";
             else
             if (likely(asprintf(&modbuf, "ext-%s", ext + 1) >= 0))
                 module = modbuf;
             else
+            {
+                free(type);
                 goto error;
+            }
         }
         strict = false;
     }
 
-    priv->module = vlc_module_load(p_demux, "demux", module, strict,
-                                   demux_Probe, p_demux);
+    /* Remember which demux accepted media of the same type */
+    bool cached = !strict && var_InheritBool(p_obj, "module-probe-cache");
+
+    if (cached) {
+        const uint8_t *peek;
+        ssize_t len = vlc_stream_Peek(s, &peek, DEMUX_SIGNATURE_SIZE);
+
+        key.mime = type;
+        if (len > 0) {
+            key.signature = peek;
+            key.signature_size = len;
+        }
+    }
+
+    priv->module = vlc_module_load_cached(vlc_object_logger(VLC_OBJECT(p_demux)),
+                                          "demux", module, strict,
+                                          cached ? &key : NULL,
+                                          demux_Probe, p_demux);
     free(modbuf);
+    free(type);
 
     if (priv->module == NULL)
         goto error;
@@ -395,7 +395,8 @@ decoder_on_thumbnail_ready(vlc_input_decoder_t *decoder, picture_t *pic, void *u
 
 static void
 decoder_on_new_video_stats(vlc_input_decoder_t *decoder, unsigned decoded, unsigned lost,
-                           unsigned displayed, unsigned late, void *userdata)
+                           unsigned displayed, unsigned late, unsigned pool_waits,
+                           void *userdata)
 {
     (void) decoder;
 
@@ -418,6 +419,8 @@ decoder_on_new_video_stats(vlc_input_decoder_t *decoder, unsigned decoded, unsig
                               memory_order_relaxed);
     atomic_fetch_add_explicit(&stats->late_pictures, late,
                               memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->pool_waits, pool_waits,
+                              memory_order_relaxed);
 }
 
 static void
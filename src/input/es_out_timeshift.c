@@ -193,6 +193,11 @@ struct ts_storage_t
 {
     ts_storage_t *p_next;
 
+    /* Memory storage, blocks are kept as is instead of being written to a
+     * file. The memory size is shared by all the storages of a thread. */
+    int64_t *pi_memory_size;/* Current size in bytes, NULL for file storage */
+    int64_t i_memory_max;   /* Max size in bytes */
+
     /* */
 #ifdef _WIN32
     char    *psz_file;  /* Filename */
@@ -217,6 +222,7 @@ typedef struct
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
     const char     *psz_tmp_path;
+    int64_t        i_memory_max;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -239,6 +245,7 @@ typedef struct
     /* */
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    int64_t        i_memory_size;
 
     vlc_tick_t     i_cmd_delay;
 
@@ -257,6 +264,7 @@ typedef struct
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
+    int64_t        i_memory_max;      /* Maximal memory storage size in byte */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -294,9 +302,11 @@ static int          TsChangeRate( ts_thread_t *, float src_rate, float rate );
 static void         *TsRun( void * );
 
 static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static ts_storage_t *TsStorageNewMemory( int64_t *pi_memory_size, int64_t i_memory_max );
 static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
+static int64_t      TsStorageSizeofBlock( const block_t * );
 static bool         TsStorageIsEmpty( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
@@ -837,6 +847,12 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    const int64_t i_memory_max = var_InheritInteger( p_input, "input-timeshift-memory" );
+    p_sys->i_memory_max = __MAX( i_memory_max, 0 ) * 1024 * 1024;
+    if( p_sys->i_memory_max > 0 )
+        msg_Dbg( p_input, "using up to %"PRId64" MiB of timeshift memory",
+                 p_sys->i_memory_max/(1024*1024) );
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !defined(VLC_WINSTORE_APP)
     if( p_sys->psz_tmp_path == NULL )
@@ -915,6 +931,7 @@ static int TsStart( es_out_t *p_out )
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
+    p_ts->i_memory_max = p_sys->i_memory_max;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
     p_ts->p_tsout = p_out;
@@ -931,6 +948,7 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_cmd_delay = 0;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_memory_size = 0;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts ) )
@@ -988,7 +1006,17 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
     if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        ts_storage_t *p_storage = NULL;
+
+        /* Keep the commands in memory while there is room for them, and
+         * overflow to temporary files otherwise */
+        if( p_ts->i_memory_max > 0 &&
+            ( p_cmd->header.i_type != C_SEND ||
+              p_ts->i_memory_size + TsStorageSizeofBlock( p_cmd->send.p_block )
+                  <= p_ts->i_memory_max ) )
+            p_storage = TsStorageNewMemory( &p_ts->i_memory_size, p_ts->i_memory_max );
+        if( !p_storage )
+            p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
 
         if( !p_storage )
         {
@@ -1271,6 +1299,8 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->psz_file = psz_file;
 #endif
     p_storage->p_next = NULL;
+    p_storage->pi_memory_size = NULL;
+    p_storage->i_memory_max = 0;
 
     /* */
     p_storage->i_file_max = i_tmp_size_max;
@@ -1295,6 +1325,39 @@ error:
     return NULL;
 }
 
+static ts_storage_t *TsStorageNewMemory( int64_t *pi_memory_size, int64_t i_memory_max )
+{
+    ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
+    if( unlikely(p_storage == NULL) )
+        return NULL;
+
+    p_storage->p_next = NULL;
+    p_storage->pi_memory_size = pi_memory_size;
+    p_storage->i_memory_max = i_memory_max;
+
+    /* */
+#ifdef _WIN32
+    p_storage->psz_file = NULL;
+#endif
+    p_storage->i_file_max = 0;
+    p_storage->i_file_size = 0;
+    p_storage->p_filew = NULL;
+    p_storage->p_filer = NULL;
+
+    /* */
+    p_storage->p_cmd_buf = vlc_alloc( TS_STORAGE_COMMAND_PREALLOC, MAX_COMMAND_SIZE );
+    p_storage->i_cmd_buf = TS_STORAGE_COMMAND_PREALLOC * MAX_COMMAND_SIZE;
+    p_storage->p_cmd_w = p_storage->p_cmd_buf;
+    p_storage->p_cmd_r = p_storage->p_cmd_buf;
+
+    if( !p_storage->p_cmd_buf )
+    {
+        free( p_storage );
+        return NULL;
+    }
+    return p_storage;
+}
+
 static void TsStorageDelete( ts_storage_t *p_storage )
 {
     while( p_storage->p_cmd_r < p_storage->p_cmd_w )
@@ -1307,12 +1370,15 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd_buf );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+    if( p_storage->pi_memory_size == NULL )
+    {
+        fclose( p_storage->p_filer );
+        fclose( p_storage->p_filew );
 #ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
-    free( p_storage->psz_file );
+        vlc_unlink( p_storage->psz_file );
+        free( p_storage->psz_file );
 #endif
+    }
     free( p_storage );
 }
 
@@ -1333,13 +1399,23 @@ static void TsStoragePack( ts_storage_t *p_storage )
     }
 }
 
+static int64_t TsStorageSizeofBlock( const block_t *p_block )
+{
+    return sizeof(*p_block) + p_block->i_buffer;
+}
+
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->header.i_type == C_SEND && p_storage->p_cmd_w )
     {
-        size_t i_size = sizeof(*p_cmd->send.p_block) + p_cmd->send.p_block->i_buffer;
+        int64_t i_size = TsStorageSizeofBlock( p_cmd->send.p_block );
 
-        if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
+        if( p_storage->pi_memory_size != NULL )
+        {
+            if( *p_storage->pi_memory_size + i_size > p_storage->i_memory_max )
+                return true;
+        }
+        else if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
     }
     return (size_t)(p_storage->p_cmd_w - p_storage->p_cmd_buf) > p_storage->i_cmd_buf - MAX_COMMAND_SIZE;
@@ -1356,7 +1432,12 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     ts_cmd_t cmd;
     memcpy(&cmd, p_cmd, TsStorageSizeofCommand[p_cmd->header.i_type]);
 
-    if( cmd.header.i_type == C_SEND )
+    if( cmd.header.i_type == C_SEND && p_storage->pi_memory_size != NULL )
+    {
+        /* The block is handed over as is */
+        *p_storage->pi_memory_size += TsStorageSizeofBlock( cmd.send.p_block );
+    }
+    else if( cmd.header.i_type == C_SEND )
     {
         block_t *p_block = cmd.send.p_block;
 
@@ -1397,7 +1478,12 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     memcpy(p_cmd, p_storage->p_cmd_r, i_cmdsize);
     p_storage->p_cmd_r += i_cmdsize;
 
-    if( p_cmd->header.i_type == C_SEND )
+    if( p_cmd->header.i_type == C_SEND && p_storage->pi_memory_size != NULL )
+    {
+        *p_storage->pi_memory_size -= TsStorageSizeofBlock( p_cmd->send.p_block );
+        assert( *p_storage->pi_memory_size >= 0 );
+    }
+    else if( p_cmd->header.i_type == C_SEND )
     {
         block_t block;
 
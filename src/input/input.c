@@ -599,6 +599,16 @@ static void MainLoopStatistics( input_thread_t *p_input )
         struct input_stats_t new_stats;
         input_stats_Compute(priv->stats, &new_stats);
 
+        struct vlc_stream_cache_stats cache;
+        if (priv->master->p_cache != NULL
+         && vlc_stream_GetCacheStats(priv->master->p_cache, &cache) == VLC_SUCCESS)
+        {
+            new_stats.i_cache_hits = cache.hits;
+            new_stats.i_cache_misses = cache.misses;
+        }
+        else
+            new_stats.i_cache_hits = new_stats.i_cache_misses = 0;
+
         vlc_mutex_lock(&priv->p_item->lock);
         *priv->p_item->p_stats = new_stats;
         vlc_mutex_unlock(&priv->p_item->lock);
@@ -2532,6 +2542,8 @@ static demux_t *InputDemuxNew( input_thread_t *p_input, es_out_t *p_es_out,
     if( p_stream == NULL )
         return NULL;
 
+    stream_t *p_cache = p_stream;
+
     p_stream = stream_FilterAutoNew( p_stream );
 
     if( p_stream->pf_read == NULL && p_stream->pf_block == NULL
@@ -2563,7 +2575,10 @@ static demux_t *InputDemuxNew( input_thread_t *p_input, es_out_t *p_es_out,
     demux_t *demux = demux_NewAdvanced( obj, p_input, psz_demux, url, p_stream,
                                         p_es_out, priv->type == INPUT_TYPE_PREPARSING );
     if( demux != NULL )
+    {
+        p_source->p_cache = p_cache;
         return demux;
+    }
 
 error:
     vlc_stream_Delete( p_stream );
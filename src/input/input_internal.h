@@ -359,6 +359,8 @@ struct input_source_t
     vlc_atomic_rc_t rc;
 
     demux_t  *p_demux; /**< Demux object (most downstream) */
+    stream_t *p_cache; /**< Cache filter of the access stream (owned by the
+                            demux), or NULL */
     es_out_t *p_slave_es_out; /**< Slave es out */
 
     char *str_id;
@@ -725,6 +727,7 @@ struct input_stats {
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t late_pictures;
     atomic_uintmax_t lost_pictures;
+    atomic_uintmax_t pool_waits;
 };
 
 struct input_stats *input_stats_Create(void);
@@ -845,6 +845,8 @@ int vlc_stream_vaControl(stream_t *s, int cmd, va_list args)
                 return s->ops->get_type(s, type);
             }
             return VLC_EGENERIC;
+        case STREAM_GET_CACHE_STATS:
+            return VLC_EGENERIC; /* only implemented by stream filters */
         case STREAM_GET_PRIVATE_ID_STATE:
             if (s->ops->stream.get_private_id_state != NULL) {
                 int priv_data = va_arg(args, int);
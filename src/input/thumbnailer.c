@@ -57,15 +57,17 @@ struct vlc_thumbnailer_request_t
     vlc_atomic_rc_t rc;
     vlc_thumbnailer_t *thumbnailer;
 
-    struct seek_target seek_target;
     bool fast_seek;
     input_item_t *item;
     /**
-     * A positive value will be used as the timeout duration
+     * A positive value will be used as the timeout duration of each
+     * thumbnail
      * VLC_TICK_INVALID means no timeout
      */
     vlc_tick_t timeout;
+    /* Exactly one of cb and batch_cb is set */
     vlc_thumbnailer_cb cb;
+    vlc_thumbnailer_batch_cb batch_cb;
     void* userdata;
 
     vlc_mutex_t lock;
@@ -77,27 +79,31 @@ struct vlc_thumbnailer_request_t
         ENDED,
     } status;
     picture_t *pic;
+    bool eos; /**< the current input has stopped */
 
     struct vlc_runnable runnable; /**< to be passed to the executor */
+
+    size_t target_count;
+    struct seek_target targets[];
 };
 
 static void RunnableRun(void *);
 
 static task_t *
-TaskNew(vlc_thumbnailer_t *thumbnailer, input_item_t *item,
-        struct seek_target seek_target, bool fast_seek,
-        vlc_thumbnailer_cb cb, void *userdata, vlc_tick_t timeout)
+TaskNew(vlc_thumbnailer_t *thumbnailer, input_item_t *item, size_t count,
+        bool fast_seek, vlc_tick_t timeout, void *userdata)
 {
-    task_t *task = malloc(sizeof(*task));
+    task_t *task = malloc(sizeof(*task) + count * sizeof(task->targets[0]));
     if (!task)
         return NULL;
 
     vlc_atomic_rc_init(&task->rc);
     task->thumbnailer = thumbnailer;
     task->item = item;
-    task->seek_target = seek_target;
+    task->target_count = count;
     task->fast_seek = fast_seek;
-    task->cb = cb;
+    task->cb = NULL;
+    task->batch_cb = NULL;
     task->userdata = userdata;
     task->timeout = timeout;
 
@@ -105,6 +111,7 @@ TaskNew(vlc_thumbnailer_t *thumbnailer, input_item_t *item,
     vlc_cond_init(&task->cond_ended);
     task->status = RUNNING;
     task->pic = NULL;
+    task->eos = false;
 
     task->runnable.run = RunnableRun;
     task->runnable.userdata = task;
@@ -123,10 +130,16 @@ TaskRelease(task_t *task)
     free(task);
 }
 
-static void NotifyThumbnail(task_t *task, picture_t *pic)
+static void NotifyThumbnail(task_t *task, size_t index, picture_t *pic)
 {
-    assert(task->cb);
-    task->cb(task->userdata, pic);
+    if (task->batch_cb != NULL)
+        task->batch_cb(task->userdata, index, pic);
+    else
+    {
+        assert(task->cb);
+        assert(index == 0);
+        task->cb(task->userdata, pic);
+    }
 }
 
 static void
@@ -142,6 +155,11 @@ on_thumbnailer_input_event( input_thread_t *input,
     task_t *task = userdata;
 
     vlc_mutex_lock(&task->lock);
+    /* Only a stopped input cannot be seeked to the next target */
+    if (event->type == INPUT_EVENT_STATE
+     && (event->state.value == END_S || event->state.value == ERROR_S))
+        task->eos = true;
+
     if (task->status != RUNNING)
     {
         /* We may receive a THUMBNAIL_READY event followed by an
@@ -161,66 +179,153 @@ on_thumbnailer_input_event( input_thread_t *input,
 }
 
 static void
-RunnableRun(void *userdata)
+Seek(input_thread_t *input, const struct seek_target *target, bool fast_seek)
 {
-    vlc_thread_set_name("vlc-run-thumb");
-
-    task_t *task = userdata;
-    vlc_thumbnailer_t *thumbnailer = task->thumbnailer;
-
-    vlc_tick_t now = vlc_tick_now();
+    if (target->type == VLC_THUMBNAILER_SEEK_TIME)
+        input_SetTime(input, target->time, fast_seek);
+    else
+    {
+        assert(target->type == VLC_THUMBNAILER_SEEK_POS);
+        input_SetPosition(input, target->pos, fast_seek);
+    }
+}
 
+static input_thread_t *
+StartInput(task_t *task, const struct seek_target *target)
+{
     input_thread_t* input =
-            input_Create( thumbnailer->parent, on_thumbnailer_input_event, task,
-                          task->item, INPUT_TYPE_THUMBNAILING, NULL, NULL );
+            input_Create( task->thumbnailer->parent, on_thumbnailer_input_event,
+                          task, task->item, INPUT_TYPE_THUMBNAILING, NULL, NULL );
     if (!input)
-        goto error;
+        return NULL;
 
-    if (task->seek_target.type == VLC_THUMBNAILER_SEEK_TIME)
-        input_SetTime(input, task->seek_target.time, task->fast_seek);
-    else
-    {
-        assert(task->seek_target.type == VLC_THUMBNAILER_SEEK_POS);
-        input_SetPosition(input, task->seek_target.pos, task->fast_seek);
-    }
+    vlc_mutex_lock(&task->lock);
+    task->eos = false;
+    vlc_mutex_unlock(&task->lock);
+
+    Seek(input, target, task->fast_seek);
 
     int ret = input_Start(input);
     if (ret != VLC_SUCCESS)
     {
         input_Close(input);
-        goto error;
+        return NULL;
     }
+    return input;
+}
 
-    vlc_mutex_lock(&task->lock);
-    if (task->timeout == VLC_TICK_INVALID)
-    {
-        while (task->status == RUNNING)
-            vlc_cond_wait(&task->cond_ended, &task->lock);
-    }
-    else
+static void
+StopInput(input_thread_t *input)
+{
+    input_Stop(input);
+    input_Close(input);
+}
+
+static void
+RunnableRun(void *userdata)
+{
+    vlc_thread_set_name("vlc-run-thumb");
+
+    task_t *task = userdata;
+    input_thread_t *input = NULL;
+    /* true until the current input has produced a thumbnail */
+    bool fresh = true;
+    size_t i = 0;
+
+    /* The same input is seeked from one target to the next, so that the item
+     * is only opened and probed once per batch. */
+    while (i < task->target_count)
     {
-        vlc_tick_t deadline = now + task->timeout;
-        int timeout = 0;
-        while (task->status == RUNNING && timeout == 0)
-            timeout =
-                vlc_cond_timedwait(&task->cond_ended, &task->lock, deadline);
-    }
-    picture_t* pic = task->pic;
-    task->pic = NULL;
+        const struct seek_target *target = &task->targets[i];
+        vlc_tick_t now = vlc_tick_now();
+
+        vlc_mutex_lock(&task->lock);
+        if (task->status == INTERRUPTED)
+        {
+            vlc_mutex_unlock(&task->lock);
+            goto end;
+        }
+        task->status = RUNNING;
+        bool eos = task->eos;
+        vlc_mutex_unlock(&task->lock);
 
-    bool notify = task->status != INTERRUPTED;
-    vlc_mutex_unlock(&task->lock);
+        if (input != NULL && eos)
+        {
+            StopInput(input);
+            input = NULL;
+        }
+
+        if (input == NULL)
+        {
+            input = StartInput(task, target);
+            if (input == NULL)
+                break;
+            fresh = true;
+        }
+        else
+            Seek(input, target, task->fast_seek);
+
+        vlc_mutex_lock(&task->lock);
+        if (task->timeout == VLC_TICK_INVALID)
+        {
+            while (task->status == RUNNING)
+                vlc_cond_wait(&task->cond_ended, &task->lock);
+        }
+        else
+        {
+            vlc_tick_t deadline = now + task->timeout;
+            int timeout = 0;
+            while (task->status == RUNNING && timeout == 0)
+                timeout =
+                    vlc_cond_timedwait(&task->cond_ended, &task->lock, deadline);
+        }
+        picture_t* pic = task->pic;
+        task->pic = NULL;
+
+        bool interrupted = task->status == INTERRUPTED;
+        bool timed_out = task->status == RUNNING;
+        vlc_mutex_unlock(&task->lock);
 
-    if (notify)
-        NotifyThumbnail(task, pic);
+        if (interrupted)
+        {
+            if (pic)
+                picture_Release(pic);
+            goto end;
+        }
+
+        if (pic == NULL)
+        {
+            /* Never reuse an input that failed, a late picture could be
+             * mistaken for the next target one. */
+            StopInput(input);
+            input = NULL;
+
+            /* Retry this target once from a new input */
+            if (!fresh)
+                continue;
+        }
+
+        NotifyThumbnail(task, i++, pic);
+
+        if (pic)
+        {
+            picture_Release(pic);
+            fresh = false;
+        }
+        else if (timed_out)
+            /* A new input did not produce anything in time: the item is
+             * unlikely to produce any other thumbnail. */
+            break;
+    }
 
-    if (pic)
-        picture_Release(pic);
+    /* Report the targets that could not be processed */
+    while (i < task->target_count)
+        NotifyThumbnail(task, i++, NULL);
 
-    input_Stop(input);
-    input_Close(input);
+end:
+    if (input != NULL)
+        StopInput(input);
 
-error:
     TaskRelease(task);
 }
 
@@ -234,20 +339,27 @@ Interrupt(task_t *task)
     vlc_mutex_unlock(&task->lock);
 }
 
+static void
+Submit(vlc_thumbnailer_t *thumbnailer, task_t *task)
+{
+    /* One ref for the executor */
+    vlc_atomic_rc_inc(&task->rc);
+    vlc_executor_Submit(thumbnailer->executor, &task->runnable);
+}
+
 static task_t *
 RequestCommon(vlc_thumbnailer_t *thumbnailer, struct seek_target seek_target,
               enum vlc_thumbnailer_seek_speed speed, input_item_t *item,
               vlc_tick_t timeout, vlc_thumbnailer_cb cb, void *userdata)
 {
     bool fast_seek = speed == VLC_THUMBNAILER_SEEK_FAST;
-    task_t *task = TaskNew(thumbnailer, item, seek_target, fast_seek, cb,
-                           userdata, timeout);
+    task_t *task = TaskNew(thumbnailer, item, 1, fast_seek, timeout, userdata);
     if (!task)
         return NULL;
 
-    /* One ref for the executor */
-    vlc_atomic_rc_inc(&task->rc);
-    vlc_executor_Submit(thumbnailer->executor, &task->runnable);
+    task->targets[0] = seek_target;
+    task->cb = cb;
+    Submit(thumbnailer, task);
 
     return task;
 }
@@ -281,6 +393,61 @@ vlc_thumbnailer_RequestByPos( vlc_thumbnailer_t *thumbnailer,
                          userdata);
 }
 
+task_t *
+vlc_thumbnailer_RequestBatch( vlc_thumbnailer_t *thumbnailer,
+                              const vlc_tick_t *times, size_t count,
+                              enum vlc_thumbnailer_seek_speed speed,
+                              input_item_t *item, vlc_tick_t timeout,
+                              vlc_thumbnailer_batch_cb cb, void* userdata )
+{
+    assert(count > 0);
+    assert(cb != NULL);
+
+    bool fast_seek = speed == VLC_THUMBNAILER_SEEK_FAST;
+    task_t *task = TaskNew(thumbnailer, item, count, fast_seek, timeout,
+                           userdata);
+    if (!task)
+        return NULL;
+
+    for (size_t i = 0; i < count; i++)
+        task->targets[i] = (struct seek_target) {
+            .type = VLC_THUMBNAILER_SEEK_TIME,
+            .time = times[i],
+        };
+    task->batch_cb = cb;
+    Submit(thumbnailer, task);
+
+    return task;
+}
+
+task_t *
+vlc_thumbnailer_RequestByInterval( vlc_thumbnailer_t *thumbnailer,
+                                   vlc_tick_t start, vlc_tick_t interval,
+                                   size_t count,
+                                   enum vlc_thumbnailer_seek_speed speed,
+                                   input_item_t *item, vlc_tick_t timeout,
+                                   vlc_thumbnailer_batch_cb cb, void* userdata )
+{
+    assert(count > 0);
+    assert(cb != NULL);
+
+    bool fast_seek = speed == VLC_THUMBNAILER_SEEK_FAST;
+    task_t *task = TaskNew(thumbnailer, item, count, fast_seek, timeout,
+                           userdata);
+    if (!task)
+        return NULL;
+
+    for (size_t i = 0; i < count; i++)
+        task->targets[i] = (struct seek_target) {
+            .type = VLC_THUMBNAILER_SEEK_TIME,
+            .time = start + (vlc_tick_t)i * interval,
+        };
+    task->batch_cb = cb;
+    Submit(thumbnailer, task);
+
+    return task;
+}
+
 void vlc_thumbnailer_DestroyRequest( vlc_thumbnailer_t* thumbnailer, task_t* task )
 {
     bool canceled = vlc_executor_Cancel(thumbnailer->executor, &task->runnable);
@@ -297,13 +464,16 @@ void vlc_thumbnailer_DestroyRequest( vlc_thumbnailer_t* thumbnailer, task_t* tas
     TaskRelease(task);
 }
 
-vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
+vlc_thumbnailer_t *
+vlc_thumbnailer_CreateWithThreads( vlc_object_t* parent, unsigned max_threads )
 {
+    assert(max_threads > 0);
+
     vlc_thumbnailer_t *thumbnailer = malloc( sizeof( *thumbnailer ) );
     if ( unlikely( thumbnailer == NULL ) )
         return NULL;
 
-    thumbnailer->executor = vlc_executor_New(1);
+    thumbnailer->executor = vlc_executor_New(max_threads);
     if (!thumbnailer->executor)
     {
         free(thumbnailer);
@@ -315,6 +485,11 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
     return thumbnailer;
 }
 
+vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
+{
+    return vlc_thumbnailer_CreateWithThreads( parent, 1 );
+}
+
 void vlc_thumbnailer_Release( vlc_thumbnailer_t *thumbnailer )
 {
     vlc_executor_Delete(thumbnailer->executor);
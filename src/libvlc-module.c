@@ -761,6 +761,11 @@ static const char* const ppsz_restore_playback_desc[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_MEMORY_TEXT N_("Timeshift memory size (MiB)")
+#define INPUT_TIMESHIFT_MEMORY_LONGTEXT N_( \
+    "Maximum amount of memory used to keep the timeshifted streams " \
+    "before falling back to temporary files. 0 disables memory storage." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -1104,6 +1109,13 @@ static const char* const ppsz_restore_playback_desc[] = {
     "Scan plugin directories for new plugins at startup. " \
     "This increases the startup time of VLC.")
 
+#define PROBE_CACHE_TEXT N_("Remember probed modules")
+#define PROBE_CACHE_LONGTEXT N_( \
+    "Skip the demuxers and packetizers that rejected similar media before " \
+    "(same format signature, file extension, content type or codec). This " \
+    "speeds up opening media, but a skipped module would not be used even " \
+    "if it could have handled the media.")
+
 #define KEYSTORE_TEXT N_("Preferred keystore list")
 #define KEYSTORE_LONGTEXT N_( \
     "List of keystores that VLC will use in priority." )
@@ -1985,6 +1997,9 @@ vlc_module_begin ()
                   INPUT_TIMESHIFT_PATH_TEXT, INPUT_TIMESHIFT_PATH_LONGTEXT)
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT )
+    add_integer( "input-timeshift-memory", 0, INPUT_TIMESHIFT_MEMORY_TEXT,
+                 INPUT_TIMESHIFT_MEMORY_LONGTEXT )
+        change_integer_range( 0, INT_MAX )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT );
 
@@ -2069,6 +2084,8 @@ vlc_module_begin ()
               PLUGINS_SCAN_LONGTEXT )
         change_volatile ()
 #endif
+    add_bool( "module-probe-cache", false, PROBE_CACHE_TEXT,
+              PROBE_CACHE_LONGTEXT )
     add_string( "keystore", NULL, KEYSTORE_TEXT,
                 KEYSTORE_LONGTEXT )
 
@@ -24,28 +24,44 @@
 
 #include <vlc_executor.h>
 
+#include <stdatomic.h>
 #include <vlc_atomic.h>
 #include <vlc_list.h>
 #include <vlc_threads.h>
 #include "libvlc.h"
 
+/**
+ * Queue of runnables.
+ *
+ * Each executor thread owns a queue. A thread takes the runnables from its
+ * own queue first, and steals from the queues of the other threads when its
+ * own queue is empty, so that submitting and taking runnables do not all
+ * contend on a single lock.
+ */
+struct vlc_executor_queue {
+    vlc_mutex_t lock;
+
+    /** List of vlc_runnable */
+    struct vlc_list runnables;
+
+    /** Number of runnables in the list (readable without the lock) */
+    atomic_uint size;
+};
+
 /**
  * An executor can spawn several threads.
  *
  * This structure contains the data specific to one thread.
  */
 struct vlc_executor_thread {
-    /** Node of vlc_executor.threads list */
-    struct vlc_list node;
-
     /** The executor owning the thread */
     vlc_executor_t *owner;
 
     /** The system thread */
     vlc_thread_t thread;
 
-    /** The current task executed by the thread, NULL if none */
-    struct vlc_runnable *current_task;
+    /** The queue owned by the thread */
+    struct vlc_executor_queue queue;
 };
 
 /**
@@ -58,61 +74,142 @@ struct vlc_executor {
     /** Maximum number of threads to run the tasks */
     unsigned max_threads;
 
-    /** List of active vlc_executor_thread */
-    struct vlc_list threads;
+    /** Thread slots (max_threads items), the first nthreads are running */
+    struct vlc_executor_thread *threads;
 
-    /** Thread count (in a separate field to quickly compare to max_threads) */
-    unsigned nthreads;
+    /** Thread count (only written with the lock held) */
+    atomic_uint nthreads;
+
+    /** Index of the queue to submit the next runnable to, when submitting
+     * from outside the executor threads */
+    atomic_uint next_queue;
+
+    /** Number of runnables queued but not taken yet (updated with the lock
+     * of the queue held, along with the queue itself) */
+    atomic_uint pending;
 
     /* Number of tasks requested but not finished. */
-    unsigned unfinished;
+    atomic_uint unfinished;
+
+    /** Number of threads waiting for a runnable */
+    atomic_uint sleeping;
 
     /** Wait for the executor to be idle (i.e. unfinished == 0) */
     vlc_cond_t idle_wait;
 
-    /** Queue of vlc_runnable */
-    struct vlc_list queue;
-
-    /** Wait for the queue to be non-empty */
+    /** Wait for a runnable to be queued */
     vlc_cond_t queue_wait;
 
     /** True if executor deletion is requested */
-    bool closing;
+    atomic_bool closing;
 };
 
+/** The executor thread running on the current thread, if any */
+static thread_local struct vlc_executor_thread *current_thread;
+
 static void
-QueuePush(vlc_executor_t *executor, struct vlc_runnable *runnable)
+QueueInit(struct vlc_executor_queue *queue)
 {
-    vlc_mutex_assert(&executor->lock);
+    vlc_mutex_init(&queue->lock);
+    vlc_list_init(&queue->runnables);
+    atomic_init(&queue->size, 0);
+}
 
-    vlc_list_append(&runnable->node, &executor->queue);
-    vlc_cond_signal(&executor->queue_wait);
+static void
+QueuePush(vlc_executor_t *executor, struct vlc_executor_queue *queue,
+          struct vlc_runnable *runnable)
+{
+    vlc_mutex_lock(&queue->lock);
+    runnable->queue = queue;
+    vlc_list_append(&runnable->node, &queue->runnables);
+    atomic_fetch_add_explicit(&queue->size, 1, memory_order_relaxed);
+    atomic_fetch_add(&executor->pending, 1);
+    vlc_mutex_unlock(&queue->lock);
 }
 
 static struct vlc_runnable *
-QueueTake(vlc_executor_t *executor)
+QueuePop(vlc_executor_t *executor, struct vlc_executor_queue *queue)
 {
-    vlc_mutex_assert(&executor->lock);
-
-    while (!executor->closing && vlc_list_is_empty(&executor->queue))
-        vlc_cond_wait(&executor->queue_wait, &executor->lock);
-
-    if (executor->closing)
+    if (atomic_load_explicit(&queue->size, memory_order_relaxed) == 0)
         return NULL;
 
+    vlc_mutex_lock(&queue->lock);
+
     struct vlc_runnable *runnable =
-        vlc_list_first_entry_or_null(&executor->queue, struct vlc_runnable,
+        vlc_list_first_entry_or_null(&queue->runnables, struct vlc_runnable,
                                      node);
-    assert(runnable);
-    vlc_list_remove(&runnable->node);
+    if (runnable)
+    {
+        vlc_list_remove(&runnable->node);
+        atomic_fetch_sub_explicit(&queue->size, 1, memory_order_relaxed);
+        /* Account for it on dequeue, so that no other thread keeps waking
+         * up for a runnable which is not queued anymore */
+        atomic_fetch_sub(&executor->pending, 1);
+
+        /* Set links to NULL to know that it has been taken by a thread in
+         * vlc_executor_Cancel() */
+        runnable->node.prev = runnable->node.next = NULL;
+    }
 
-    /* Set links to NULL to know that it has been taken by a thread in
-     * vlc_executor_Cancel() */
-    runnable->node.prev = runnable->node.next = NULL;
+    vlc_mutex_unlock(&queue->lock);
 
     return runnable;
 }
 
+static void
+ReleaseUnfinished(vlc_executor_t *executor)
+{
+    unsigned unfinished = atomic_fetch_sub(&executor->unfinished, 1);
+    assert(unfinished > 0);
+    if (unfinished == 1)
+    {
+        vlc_mutex_lock(&executor->lock);
+        vlc_cond_broadcast(&executor->idle_wait);
+        vlc_mutex_unlock(&executor->lock);
+    }
+}
+
+/* Take a runnable from the thread queue, or steal one from another queue */
+static struct vlc_runnable *
+TryTake(struct vlc_executor_thread *thread)
+{
+    vlc_executor_t *executor = thread->owner;
+
+    struct vlc_runnable *runnable = QueuePop(executor, &thread->queue);
+    if (runnable)
+        return runnable;
+
+    unsigned nthreads = atomic_load(&executor->nthreads);
+    unsigned self = thread - executor->threads;
+    for (unsigned i = 1; i < nthreads; ++i)
+    {
+        unsigned victim = (self + i) % nthreads;
+        runnable = QueuePop(executor, &executor->threads[victim].queue);
+        if (runnable)
+            return runnable;
+    }
+
+    return NULL;
+}
+
+/* Wait for a runnable to be queued, return false if the executor is closing */
+static bool
+WaitPending(vlc_executor_t *executor)
+{
+    vlc_mutex_lock(&executor->lock);
+
+    atomic_fetch_add(&executor->sleeping, 1);
+    while (!atomic_load(&executor->closing)
+        && atomic_load(&executor->pending) == 0)
+        vlc_cond_wait(&executor->queue_wait, &executor->lock);
+    atomic_fetch_sub(&executor->sleeping, 1);
+
+    bool closing = atomic_load(&executor->closing);
+    vlc_mutex_unlock(&executor->lock);
+
+    return !closing;
+}
+
 static void *
 ThreadRun(void *userdata)
 {
@@ -120,55 +217,45 @@ ThreadRun(void *userdata)
     vlc_executor_t *executor = thread->owner;
 
     vlc_thread_set_name("vlc-exec-runner");
+    current_thread = thread;
 
-    vlc_mutex_lock(&executor->lock);
-
-    struct vlc_runnable *runnable;
-    /* When the executor is closing, QueueTake() returns NULL */
-    while ((runnable = QueueTake(executor)))
+    for (;;)
     {
-        thread->current_task = runnable;
-        vlc_mutex_unlock(&executor->lock);
-
-        /* Execute the user-provided runnable, without the executor lock */
+        struct vlc_runnable *runnable = TryTake(thread);
+        if (!runnable)
+        {
+            /* When the executor is closing, WaitPending() returns false */
+            if (!WaitPending(executor))
+                break;
+            continue;
+        }
+
+        /* Execute the user-provided runnable, without any lock */
         runnable->run(runnable->userdata);
 
-        vlc_mutex_lock(&executor->lock);
-        thread->current_task = NULL;
-
         vlc_thread_set_name("vlc-exec-runner");
 
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        ReleaseUnfinished(executor);
     }
 
-    vlc_mutex_unlock(&executor->lock);
-
     return NULL;
 }
 
 static int
 SpawnThread(vlc_executor_t *executor)
 {
-    assert(executor->nthreads < executor->max_threads);
+    vlc_mutex_assert(&executor->lock);
 
-    struct vlc_executor_thread *thread = malloc(sizeof(*thread));
-    if (!thread)
-        return VLC_ENOMEM;
+    unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                             memory_order_relaxed);
+    assert(nthreads < executor->max_threads);
 
-    thread->owner = executor;
-    thread->current_task = NULL;
+    struct vlc_executor_thread *thread = &executor->threads[nthreads];
 
     if (vlc_clone(&thread->thread, ThreadRun, thread))
-    {
-        free(thread);
         return VLC_EGENERIC;
-    }
 
-    executor->nthreads++;
-    vlc_list_append(&thread->node, &executor->threads);
+    atomic_store(&executor->nthreads, nthreads + 1);
 
     return VLC_SUCCESS;
 }
@@ -181,24 +268,40 @@ vlc_executor_New(unsigned max_threads)
     if (!executor)
         return NULL;
 
+    executor->threads = vlc_alloc(max_threads, sizeof(*executor->threads));
+    if (!executor->threads)
+    {
+        free(executor);
+        return NULL;
+    }
+
     vlc_mutex_init(&executor->lock);
 
     executor->max_threads = max_threads;
-    executor->nthreads = 0;
-    executor->unfinished = 0;
+    atomic_init(&executor->nthreads, 0);
+    atomic_init(&executor->next_queue, 0);
+    atomic_init(&executor->pending, 0);
+    atomic_init(&executor->unfinished, 0);
+    atomic_init(&executor->sleeping, 0);
 
-    vlc_list_init(&executor->threads);
-    vlc_list_init(&executor->queue);
+    for (unsigned i = 0; i < max_threads; ++i)
+    {
+        executor->threads[i].owner = executor;
+        QueueInit(&executor->threads[i].queue);
+    }
 
     vlc_cond_init(&executor->idle_wait);
     vlc_cond_init(&executor->queue_wait);
 
-    executor->closing = false;
+    atomic_init(&executor->closing, false);
 
     /* Create one thread on init so that vlc_executor_Submit() may never fail */
+    vlc_mutex_lock(&executor->lock);
     int ret = SpawnThread(executor);
+    vlc_mutex_unlock(&executor->lock);
     if (ret != VLC_SUCCESS)
     {
+        free(executor->threads);
         free(executor);
         return NULL;
     }
@@ -209,24 +312,50 @@ vlc_executor_New(unsigned max_threads)
 void
 vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable)
 {
-    vlc_mutex_lock(&executor->lock);
+    assert(!atomic_load_explicit(&executor->closing, memory_order_relaxed));
+
+    unsigned unfinished = atomic_fetch_add(&executor->unfinished, 1) + 1;
+
+    /* Runnables submitted from an executor thread (e.g. a task spawning
+     * sub-tasks) are queued locally, the others are spread over the running
+     * threads. */
+    struct vlc_executor_thread *thread = current_thread;
+    if (!thread || thread->owner != executor)
+    {
+        unsigned nthreads = atomic_load(&executor->nthreads);
+        unsigned index = atomic_fetch_add_explicit(&executor->next_queue, 1,
+                                                   memory_order_relaxed);
+        thread = &executor->threads[index % nthreads];
+    }
+
+    QueuePush(executor, &thread->queue, runnable);
 
-    assert(!executor->closing);
+    bool spawn = unfinished > atomic_load(&executor->nthreads)
+              && atomic_load(&executor->nthreads) < executor->max_threads;
 
-    QueuePush(executor, runnable);
+    if (spawn || atomic_load(&executor->sleeping) > 0)
+    {
+        vlc_mutex_lock(&executor->lock);
 
-    if (++executor->unfinished > executor->nthreads
-            && executor->nthreads < executor->max_threads)
-        /* If it fails, this is not an error, there is at least one thread */
-        SpawnThread(executor);
+        unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                                 memory_order_relaxed);
+        if (spawn && unfinished > nthreads && nthreads < executor->max_threads)
+            /* If it fails, this is not an error, there is at least one
+             * thread */
+            SpawnThread(executor);
 
-    vlc_mutex_unlock(&executor->lock);
+        vlc_cond_signal(&executor->queue_wait);
+        vlc_mutex_unlock(&executor->lock);
+    }
 }
 
 bool
 vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
 {
-    vlc_mutex_lock(&executor->lock);
+    struct vlc_executor_queue *queue = runnable->queue;
+    assert(queue);
+
+    vlc_mutex_lock(&queue->lock);
 
     /* Either both prev and next are set, either both are NULL */
     assert(!runnable->node.prev == !runnable->node.next);
@@ -235,14 +364,15 @@ vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
     if (in_queue)
     {
         vlc_list_remove(&runnable->node);
-
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        atomic_fetch_sub_explicit(&queue->size, 1, memory_order_relaxed);
+        atomic_fetch_sub(&executor->pending, 1);
+        runnable->node.prev = runnable->node.next = NULL;
     }
 
-    vlc_mutex_unlock(&executor->lock);
+    vlc_mutex_unlock(&queue->lock);
+
+    if (in_queue)
+        ReleaseUnfinished(executor);
 
     return in_queue;
 }
@@ -251,7 +381,7 @@ void
 vlc_executor_WaitIdle(vlc_executor_t *executor)
 {
     vlc_mutex_lock(&executor->lock);
-    while (executor->unfinished)
+    while (atomic_load(&executor->unfinished))
         vlc_cond_wait(&executor->idle_wait, &executor->lock);
     vlc_mutex_unlock(&executor->lock);
 }
@@ -261,32 +391,30 @@ vlc_executor_Delete(vlc_executor_t *executor)
 {
     vlc_mutex_lock(&executor->lock);
 
-    executor->closing = true;
+    atomic_store(&executor->closing, true);
 
     /* All the tasks must be canceled on delete */
-    assert(vlc_list_is_empty(&executor->queue));
+    assert(atomic_load(&executor->pending) == 0);
 
     vlc_mutex_unlock(&executor->lock);
 
     /* "closing" is now true, this will wake up threads */
     vlc_cond_broadcast(&executor->queue_wait);
 
-    /* The threads list may not be written at this point, so it is safe to read
-     * it without mutex locked (the mutex must be released to join the
+    /* No thread may be spawned at this point, so it is safe to read nthreads
+     * without mutex locked (the mutex must be released to join the
      * threads). */
+    unsigned nthreads = atomic_load(&executor->nthreads);
+    for (unsigned i = 0; i < nthreads; ++i)
+        vlc_join(executor->threads[i].thread, NULL);
 
-    struct vlc_executor_thread *thread;
-    vlc_list_foreach(thread, &executor->threads, node)
-    {
-        vlc_join(thread->thread, NULL);
-        free(thread);
-    }
-
-    /* The queue must still be empty (no runnable submitted a new runnable) */
-    assert(vlc_list_is_empty(&executor->queue));
+    /* The queues must still be empty (no runnable submitted a new runnable) */
+    for (unsigned i = 0; i < executor->max_threads; ++i)
+        assert(vlc_list_is_empty(&executor->threads[i].queue.runnables));
 
     /* There are no tasks anymore */
-    assert(!executor->unfinished);
+    assert(!atomic_load(&executor->unfinished));
 
+    free(executor->threads);
     free(executor);
 }
@@ -35,18 +35,28 @@
 #include <vlc_atomic.h>
 #include "picture.h"
 
-#define POOL_MAX (CHAR_BIT * sizeof (unsigned long long))
-
-static_assert ((POOL_MAX & (POOL_MAX - 1)) == 0, "Not a power of two");
+#define POOL_WORD_BITS (CHAR_BIT * sizeof (unsigned long long))
+
+/*
+ * The pool is lock-free: free pictures are tracked in a bitmap of atomic
+ * words. Taking a picture clears its bit with a compare-and-swap, returning
+ * it sets the bit back. Threads waiting for a picture sleep on a generation
+ * counter, which is only notified if there are waiters.
+ */
+struct picture_pool_slot {
+    picture_pool_t *pool;
+    picture_t *picture;
+};
 
 struct picture_pool_t {
-    vlc_mutex_t lock;
-    vlc_cond_t  wait;
-
-    unsigned long long available;
     vlc_atomic_rc_t    refs;
-    unsigned short     picture_count;
-    picture_t  *picture[];
+    atomic_uint        generation; /* incremented whenever a picture is freed */
+    atomic_uint        waiters;
+    atomic_uint        waits; /* number of times a thread had to wait */
+    unsigned           picture_count;
+    unsigned           word_count;
+    _Atomic unsigned long long *available;
+    struct picture_pool_slot slots[];
 };
 
 static void picture_pool_Destroy(picture_pool_t *pool)
@@ -54,31 +64,34 @@ static void picture_pool_Destroy(picture_pool_t *pool)
     if (!vlc_atomic_rc_dec(&pool->refs))
         return;
 
-    aligned_free(pool);
+    free(pool);
 }
 
 void picture_pool_Release(picture_pool_t *pool)
 {
     for (unsigned i = 0; i < pool->picture_count; i++)
-        picture_Release(pool->picture[i]);
+        picture_Release(pool->slots[i].picture);
     picture_pool_Destroy(pool);
 }
 
 static void picture_pool_ReleaseClone(picture_t *clone)
 {
     picture_priv_t *priv = (picture_priv_t *)clone;
-    uintptr_t sys = (uintptr_t)priv->gc.opaque;
-    picture_pool_t *pool = (void *)(sys & ~(POOL_MAX - 1));
-    unsigned offset = sys & (POOL_MAX - 1);
-    picture_t *picture = pool->picture[offset];
+    struct picture_pool_slot *slot = priv->gc.opaque;
+    picture_pool_t *pool = slot->pool;
+    unsigned offset = slot - pool->slots;
+    unsigned long long bit = 1ULL << (offset % POOL_WORD_BITS);
 
-    picture_Release(picture);
+    picture_Release(slot->picture);
 
-    vlc_mutex_lock(&pool->lock);
-    assert(!(pool->available & (1ULL << offset)));
-    pool->available |= 1ULL << offset;
-    vlc_cond_signal(&pool->wait);
-    vlc_mutex_unlock(&pool->lock);
+    unsigned long long prev =
+        atomic_fetch_or(&pool->available[offset / POOL_WORD_BITS], bit);
+    assert(!(prev & bit));
+    (void) prev;
+
+    atomic_fetch_add(&pool->generation, 1);
+    if (atomic_load(&pool->waiters) > 0)
+        vlc_atomic_notify_all(&pool->generation);
 
     picture_pool_Destroy(pool);
 }
@@ -86,11 +99,10 @@ static void picture_pool_ReleaseClone(picture_t *clone)
 static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
                                             unsigned offset)
 {
-    picture_t *picture = pool->picture[offset];
-    uintptr_t sys = ((uintptr_t)pool) + offset;
+    struct picture_pool_slot *slot = &pool->slots[offset];
 
-    picture_t *clone = picture_InternalClone(picture, picture_pool_ReleaseClone,
-                                 (void*)sys);
+    picture_t *clone = picture_InternalClone(slot->picture,
+                                             picture_pool_ReleaseClone, slot);
     if (clone != NULL) {
         assert(!picture_HasChainedPics(clone));
         vlc_atomic_rc_inc(&pool->refs);
@@ -98,28 +110,53 @@ static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
     return clone;
 }
 
-picture_pool_t *picture_pool_New(unsigned count, picture_t *const *tab)
+/* Claims a free picture, returns its offset or -1 if none is available */
+static int picture_pool_Take(picture_pool_t *pool)
 {
-    if (unlikely(count > POOL_MAX))
-        return NULL;
+    for (unsigned w = 0; w < pool->word_count; w++) {
+        unsigned long long avail = atomic_load(&pool->available[w]);
+
+        while (avail != 0) {
+            unsigned long long bit = avail & -avail;
 
+            if (atomic_compare_exchange_weak(&pool->available[w], &avail,
+                                             avail & ~bit))
+                return w * POOL_WORD_BITS + ctz(bit);
+        }
+    }
+    return -1;
+}
+
+picture_pool_t *picture_pool_New(unsigned count, picture_t *const *tab)
+{
     picture_pool_t *pool;
-    size_t size = sizeof (*pool) + count * sizeof (picture_t *);
+    unsigned words = (count + POOL_WORD_BITS - 1) / POOL_WORD_BITS;
+    size_t size = sizeof (*pool) + count * sizeof (pool->slots[0]);
 
-    size += (-size) & (POOL_MAX - 1);
-    pool = aligned_alloc(POOL_MAX, size);
+    size += (-size) & (_Alignof (unsigned long long) - 1);
+    pool = malloc(size + words * sizeof (*pool->available));
     if (unlikely(pool == NULL))
         return NULL;
 
-    vlc_mutex_init(&pool->lock);
-    vlc_cond_init(&pool->wait);
-    if (count == POOL_MAX)
-        pool->available = ~0ULL;
-    else
-        pool->available = (1ULL << count) - 1;
     vlc_atomic_rc_init(&pool->refs);
+    atomic_init(&pool->generation, 0);
+    atomic_init(&pool->waiters, 0);
+    atomic_init(&pool->waits, 0);
     pool->picture_count = count;
-    memcpy(pool->picture, tab, count * sizeof (picture_t *));
+    pool->word_count = words;
+    pool->available = (void *)(((char *)pool) + size);
+
+    for (unsigned w = 0; w < words; w++) {
+        unsigned bits = count - w * POOL_WORD_BITS;
+
+        atomic_init(&pool->available[w], (bits >= POOL_WORD_BITS)
+                                         ? ~0ULL : (1ULL << bits) - 1);
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        pool->slots[i].pool = pool;
+        pool->slots[i].picture = tab[i];
+    }
     return pool;
 }
 
@@ -128,10 +165,11 @@ picture_pool_t *picture_pool_NewFromFormat(const video_format_t *fmt,
 {
     if (count == 0)
         vlc_assert_unreachable();
-    if (unlikely(count > POOL_MAX))
+
+    picture_t **picture = vlc_alloc(count, sizeof (*picture));
+    if (unlikely(picture == NULL))
         return NULL;
 
-    picture_t *picture[POOL_MAX];
     unsigned i;
 
     for (i = 0; i < count; i++) {
@@ -144,11 +182,13 @@ picture_pool_t *picture_pool_NewFromFormat(const video_format_t *fmt,
     if (!pool)
         goto error;
 
+    free(picture);
     return pool;
 
 error:
     while (i > 0)
         picture_Release(picture[--i]);
+    free(picture);
     return NULL;
 }
 
@@ -156,10 +196,11 @@ picture_pool_t *picture_pool_Reserve(picture_pool_t *master, unsigned count)
 {
     if (count == 0)
         vlc_assert_unreachable();
-    if (unlikely(count > POOL_MAX))
+
+    picture_t **picture = vlc_alloc(count, sizeof (*picture));
+    if (unlikely(picture == NULL))
         return NULL;
 
-    picture_t *picture[POOL_MAX];
     unsigned i;
 
     for (i = 0; i < count; i++) {
@@ -172,44 +213,47 @@ picture_pool_t *picture_pool_Reserve(picture_pool_t *master, unsigned count)
     if (!pool)
         goto error;
 
+    free(picture);
     return pool;
 
 error:
     while (i > 0)
         picture_Release(picture[--i]);
+    free(picture);
     return NULL;
 }
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-
-    vlc_mutex_lock(&pool->lock);
     assert(vlc_atomic_rc_get(&pool->refs) > 0);
 
-    if (pool->available == 0)
-    {
-        vlc_mutex_unlock(&pool->lock);
+    int i = picture_pool_Take(pool);
+    if (i < 0)
         return NULL;
-    }
-
-    int i = ctz(pool->available);
-    pool->available &= ~(1ULL << i);
-    vlc_mutex_unlock(&pool->lock);
 
     return picture_pool_ClonePicture(pool, i);
 }
 
 picture_t *picture_pool_Wait(picture_pool_t *pool)
 {
-    vlc_mutex_lock(&pool->lock);
     assert(vlc_atomic_rc_get(&pool->refs) > 0);
 
-    while (pool->available == 0)
-        vlc_cond_wait(&pool->wait, &pool->lock);
+    int i = picture_pool_Take(pool);
+    if (i < 0) {
+        atomic_fetch_add_explicit(&pool->waits, 1, memory_order_relaxed);
+        atomic_fetch_add(&pool->waiters, 1);
+
+        for (;;) {
+            unsigned generation = atomic_load(&pool->generation);
 
-    int i = ctz(pool->available);
-    pool->available &= ~(1ULL << i);
-    vlc_mutex_unlock(&pool->lock);
+            i = picture_pool_Take(pool);
+            if (i >= 0)
+                break;
+            vlc_atomic_wait(&pool->generation, generation);
+        }
+
+        atomic_fetch_sub(&pool->waiters, 1);
+    }
 
     return picture_pool_ClonePicture(pool, i);
 }
@@ -218,3 +262,8 @@ unsigned picture_pool_GetSize(const picture_pool_t *pool)
 {
     return pool->picture_count;
 }
+
+unsigned picture_pool_GetResetWaits(picture_pool_t *pool)
+{
+    return atomic_exchange_explicit(&pool->waits, 0, memory_order_relaxed);
+}
@@ -27,19 +27,18 @@
 # include "config.h"
 #endif
 
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 #include <assert.h>
 #include <float.h>
 #include <math.h>
 #include <limits.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_arrays.h>
 #include <vlc_charset.h>
 #include "libvlc.h"
 #include "variables.h"
+#include "rcu.h"
 #include "config/configuration.h"
 
 typedef struct callback_entry_t
@@ -56,6 +55,7 @@ typedef struct callback_entry_t
 
 typedef struct variable_ops_t
 {
+    int    i_class; /**< VLC_VAR_CLASS of the variable */
     int  (*pf_cmp) ( vlc_value_t, vlc_value_t );
     void (*pf_dup) ( vlc_value_t * );
     void (*pf_free) ( vlc_value_t * );
@@ -67,10 +67,18 @@ typedef struct variable_ops_t
  */
 struct variable_t
 {
-    char *       psz_name; /**< The variable unique name (must be first) */
+    char *       psz_name; /**< The variable unique name */
+    uint32_t     i_hash;   /**< Hash of the name */
+
+    /** Next variable in the same hash bucket (RCU-protected) */
+    variable_t *_Atomic next;
+    /** Next retired variable, once unlinked (see VarRetire()) */
+    variable_t *retired;
 
     /** The variable's exported value */
     vlc_value_t  val;
+    /** Lock-free copy of the value, for non-string types */
+    _Atomic uint64_t fast_val;
 
     /** The variable display name, mainly for use by the interfaces */
     char *       psz_text;
@@ -130,31 +138,189 @@ static void FreeDummy( vlc_value_t *p_val ) { (void)p_val; /* unused */ }
 static void FreeString( vlc_value_t *p_val ) { free( p_val->psz_string ); }
 
 static const struct variable_ops_t
-void_ops   = { NULL,       DupDummy,  FreeDummy,  },
-addr_ops   = { CmpAddress, DupDummy,  FreeDummy,  },
-bool_ops   = { CmpBool,    DupDummy,  FreeDummy,  },
-float_ops  = { CmpFloat,   DupDummy,  FreeDummy,  },
-int_ops    = { CmpInt,     DupDummy,  FreeDummy,  },
-string_ops = { CmpString,  DupString, FreeString, },
-coords_ops = { NULL,       DupDummy,  FreeDummy,  };
-
-static int varcmp( const void *a, const void *b )
+void_ops   = { VLC_VAR_VOID,    NULL,       DupDummy,  FreeDummy,  },
+addr_ops   = { VLC_VAR_ADDRESS, CmpAddress, DupDummy,  FreeDummy,  },
+bool_ops   = { VLC_VAR_BOOL,    CmpBool,    DupDummy,  FreeDummy,  },
+float_ops  = { VLC_VAR_FLOAT,   CmpFloat,   DupDummy,  FreeDummy,  },
+int_ops    = { VLC_VAR_INTEGER, CmpInt,     DupDummy,  FreeDummy,  },
+string_ops = { VLC_VAR_STRING,  CmpString,  DupString, FreeString, },
+coords_ops = { VLC_VAR_COORDS,  NULL,       DupDummy,  FreeDummy,  };
+
+/**
+ * Hash table of the variables of an object.
+ *
+ * Writers hold the object variable lock. Readers may instead walk the table
+ * within an RCU read-side critical section: a bucket may then be observed
+ * while it is being rehashed, so a failed lock-less lookup must be retried
+ * with the lock held.
+ */
+struct vlc_var_table
+{
+    size_t mask; /**< Number of buckets minus one */
+    struct vlc_var_table *retired; /**< Next superseded table */
+    variable_t *_Atomic buckets[];
+};
+
+#define VAR_TABLE_MIN_SIZE 8
+
+static_assert(sizeof (vlc_value_t) == sizeof (uint64_t),
+              "Variable value does not fit in 64 bits");
+
+static uint32_t VarHash( const char *psz_name )
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+
+    for( const unsigned char *p = (const unsigned char *)psz_name; *p; p++ )
+        h = (h ^ *p) * 16777619u;
+    return h;
+}
+
+static struct vlc_var_table *VarTableNew( size_t size )
+{
+    struct vlc_var_table *table =
+        malloc( sizeof (*table) + size * sizeof (table->buckets[0]) );
+    if( unlikely(table == NULL) )
+        return NULL;
+
+    table->mask = size - 1;
+    for( size_t i = 0; i < size; i++ )
+        atomic_init( &table->buckets[i], NULL );
+    return table;
+}
+
+/**
+ * Finds a variable by name and hash.
+ * The caller must hold either the object variable lock, or the RCU read lock.
+ */
+static variable_t *VarFind( vlc_object_internals_t *priv,
+                            const char *psz_name, uint32_t hash )
+{
+    const struct vlc_var_table *table =
+        atomic_load_explicit( &priv->var_table, memory_order_acquire );
+    if( table == NULL )
+        return NULL;
+
+    variable_t *var = atomic_load_explicit( &table->buckets[hash & table->mask],
+                                            memory_order_acquire );
+    while( var != NULL )
+    {
+        if( var->i_hash == hash && strcmp( var->psz_name, psz_name ) == 0 )
+            break;
+        var = atomic_load_explicit( &var->next, memory_order_acquire );
+    }
+    return var;
+}
+
+/**
+ * Inserts a variable in the table, growing the table as needed.
+ * The caller must hold the object variable lock.
+ *
+ * \param oldtable [OUT] superseded table to be freed after RCU
+ *                       synchronization, or NULL
+ */
+static int VarInsert( vlc_object_internals_t *priv, variable_t *var,
+                      struct vlc_var_table **restrict oldtable )
+{
+    struct vlc_var_table *table =
+        atomic_load_explicit( &priv->var_table, memory_order_relaxed );
+
+    *oldtable = NULL;
+
+    if( table == NULL || priv->var_count > table->mask )
+    {
+        size_t size = (table != NULL) ? 2 * (table->mask + 1)
+                                      : VAR_TABLE_MIN_SIZE;
+        struct vlc_var_table *newtable = VarTableNew( size );
+        if( unlikely(newtable == NULL) )
+        {
+            if( table == NULL )
+                return VLC_ENOMEM;
+            /* Keep going with the overloaded table */
+        }
+        else
+        {
+            if( table != NULL )
+                for( size_t i = 0; i <= table->mask; i++ )
+                {
+                    variable_t *cur = atomic_load_explicit( &table->buckets[i],
+                                                    memory_order_relaxed );
+                    while( cur != NULL )
+                    {
+                        variable_t *next = atomic_load_explicit( &cur->next,
+                                                    memory_order_relaxed );
+                        size_t idx = cur->i_hash & newtable->mask;
+
+                        atomic_store_explicit( &cur->next,
+                            atomic_load_explicit( &newtable->buckets[idx],
+                                                  memory_order_relaxed ),
+                            memory_order_release );
+                        atomic_store_explicit( &newtable->buckets[idx], cur,
+                                               memory_order_relaxed );
+                        cur = next;
+                    }
+                }
+
+            atomic_store_explicit( &priv->var_table, newtable,
+                                   memory_order_release );
+            *oldtable = table;
+            table = newtable;
+        }
+    }
+
+    variable_t *_Atomic *bucket = &table->buckets[var->i_hash & table->mask];
+
+    atomic_store_explicit( &var->next,
+                           atomic_load_explicit( bucket, memory_order_relaxed ),
+                           memory_order_relaxed );
+    atomic_store_explicit( bucket, var, memory_order_release );
+    priv->var_count++;
+    return VLC_SUCCESS;
+}
+
+/**
+ * Unlinks a variable from the table.
+ * The caller must hold the object variable lock, and must synchronize RCU
+ * before destroying the variable.
+ */
+static void VarRemove( vlc_object_internals_t *priv, variable_t *var )
+{
+    struct vlc_var_table *table =
+        atomic_load_explicit( &priv->var_table, memory_order_relaxed );
+    variable_t *_Atomic *pp = &table->buckets[var->i_hash & table->mask];
+    variable_t *cur;
+
+    while( (cur = atomic_load_explicit( pp, memory_order_relaxed )) != var )
+    {
+        assert( cur != NULL );
+        pp = &cur->next;
+    }
+
+    atomic_store_explicit( pp, atomic_load_explicit( &var->next,
+                                                     memory_order_relaxed ),
+                           memory_order_release );
+    priv->var_count--;
+}
+
+/**
+ * Updates the lock-less copy of the variable value.
+ * This must be called, with the object variable lock held, whenever the value
+ * changes.
+ */
+static void VarPublish( variable_t *var )
 {
-    const variable_t *va = a, *vb = b;
+    uint64_t raw;
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
-    return strcmp( va->psz_name, vb->psz_name );
+    memcpy( &raw, &var->val, sizeof (raw) );
+    atomic_store_explicit( &var->fast_val, raw, memory_order_release );
 }
 
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
-    void **pp_var;
 
     vlc_mutex_lock(&priv->var_lock);
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
-    return (pp_var != NULL) ? *pp_var : NULL;
+    return VarFind( priv, psz_name, VarHash( psz_name ) );
 }
 
 static void Destroy( variable_t *p_var )
@@ -182,6 +348,71 @@ static void Destroy( variable_t *p_var )
     free( p_var );
 }
 
+/** Number of retired variables and tables before waiting for RCU readers */
+#define VAR_RETIRED_MAX 32
+
+/**
+ * Defers the destruction of an unlinked variable and/or superseded table.
+ *
+ * vlc_rcu_synchronize() waits for every RCU reader in the process, so it is
+ * only called once per batch of retired items, or never if the object is
+ * deleted first (see var_DestroyAll()).
+ * This must be called with the object variable lock held.
+ *
+ * \param batch [OUT] retired items to reclaim once the lock is released
+ * \return true if the batch must be passed to VarReclaim()
+ */
+static bool VarRetire( vlc_object_internals_t *priv, variable_t *var,
+                       struct vlc_var_table *table,
+                       struct vlc_var_retired *restrict batch )
+{
+    struct vlc_var_retired *retired = &priv->var_retired;
+
+    if( var != NULL )
+    {
+        var->retired = retired->vars;
+        retired->vars = var;
+        retired->count++;
+    }
+
+    if( table != NULL )
+    {
+        table->retired = retired->tables;
+        retired->tables = table;
+        retired->count++;
+    }
+
+    if( retired->count < VAR_RETIRED_MAX )
+        return false;
+
+    *batch = *retired;
+    *retired = (struct vlc_var_retired){ NULL, NULL, 0 };
+    return true;
+}
+
+static void VarFreeRetired( const struct vlc_var_retired *batch )
+{
+    for( variable_t *var = batch->vars, *next; var != NULL; var = next )
+    {
+        next = var->retired;
+        Destroy( var );
+    }
+
+    for( struct vlc_var_table *table = batch->tables, *next;
+         table != NULL; table = next )
+    {
+        next = table->retired;
+        free( table );
+    }
+}
+
+static void VarReclaim( const struct vlc_var_retired *batch )
+{
+    /* Wait for lock-less readers to let go of the variables and tables */
+    vlc_rcu_synchronize();
+    VarFreeRetired( batch );
+}
+
 /**
  * Adjusts a value to fit the constraints for a certain variable:
  * - If the value is lower than the minimum, use the minimum.
@@ -295,6 +526,7 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
         return VLC_ENOMEM;
 
     p_var->psz_name = strdup( psz_name );
+    p_var->i_hash = VarHash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -352,27 +584,37 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
 
     if (i_type & VLC_VAR_DOINHERIT)
         var_Inherit(p_this, psz_name, i_type, &p_var->val);
+    VarPublish( p_var );
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
-    void **pp_var;
+    struct vlc_var_table *p_oldtable = NULL;
+    struct vlc_var_retired retired;
     variable_t *p_oldvar;
     int ret = VLC_SUCCESS;
+    bool reclaim = false;
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
-    if( unlikely(pp_var == NULL) )
-        ret = VLC_ENOMEM;
-    else if( (p_oldvar = *pp_var) == p_var ) /* Variable create */
-        p_var = NULL; /* Variable created */
+    p_oldvar = VarFind( p_priv, p_var->psz_name, p_var->i_hash );
+    if( p_oldvar == NULL ) /* Variable create */
+    {
+        ret = VarInsert( p_priv, p_var, &p_oldtable );
+        if( likely(ret == VLC_SUCCESS) )
+            p_var = NULL; /* Variable created */
+    }
     else /* Variable already exists */
     {
         assert (((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) == 0);
         p_oldvar->i_usage++;
         p_oldvar->i_type |= i_type & VLC_VAR_ISCOMMAND;
     }
+    if( p_oldtable != NULL )
+        reclaim = VarRetire( p_priv, NULL, p_oldtable, &retired );
     vlc_mutex_unlock( &p_priv->var_lock );
 
+    if( reclaim )
+        VarReclaim( &retired );
+
     /* If we did not need to create a new variable, free everything... */
     if( p_var != NULL )
         Destroy( p_var );
@@ -382,6 +624,8 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
 void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
 {
     variable_t *p_var;
+    struct vlc_var_retired retired;
+    bool reclaim = false;
 
     assert( p_this );
 
@@ -394,30 +638,45 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
     else if( --p_var->i_usage == 0 )
     {
         assert(!p_var->b_incallback);
-        tdelete( p_var, &p_priv->var_root, varcmp );
+        VarRemove( p_priv, p_var );
+        reclaim = VarRetire( p_priv, p_var, NULL, &retired );
     }
     else
-    {
         assert(p_var->i_usage != -1u);
-        p_var = NULL;
-    }
     vlc_mutex_unlock( &p_priv->var_lock );
 
-    if( p_var != NULL )
-        Destroy( p_var );
-}
-
-static void CleanupVar( void *var )
-{
-    Destroy( var );
+    if( reclaim )
+        VarReclaim( &retired );
 }
 
 void var_DestroyAll( vlc_object_t *obj )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
+    struct vlc_var_table *table =
+        atomic_load_explicit( &priv->var_table, memory_order_relaxed );
+
+    /* The object is being deleted: no other threads can look variables up. */
+    VarFreeRetired( &priv->var_retired );
+    priv->var_retired = (struct vlc_var_retired){ NULL, NULL, 0 };
+
+    if( table == NULL )
+        return;
 
-    tdestroy( priv->var_root, CleanupVar );
-    priv->var_root = NULL;
+    for( size_t i = 0; i <= table->mask; i++ )
+    {
+        variable_t *var = atomic_load_explicit( &table->buckets[i],
+                                                memory_order_relaxed );
+        while( var != NULL )
+        {
+            variable_t *next = atomic_load_explicit( &var->next,
+                                                     memory_order_relaxed );
+            Destroy( var );
+            var = next;
+        }
+    }
+    free( table );
+    atomic_store_explicit( &priv->var_table, NULL, memory_order_relaxed );
+    priv->var_count = 0;
 }
 
 int (var_Change)(vlc_object_t *p_this, const char *psz_name, int i_action, ...)
@@ -457,6 +716,7 @@ int (var_Change)(vlc_object_t *p_this, const char *psz_name, int i_action, ...)
             assert(p_var->ops->pf_free == FreeDummy);
             p_var->step = va_arg(ap, vlc_value_t);
             CheckValue( p_var, &p_var->val );
+            VarPublish( p_var );
             break;
         case VLC_VAR_GETSTEP:
             switch (p_var->i_type & VLC_VAR_TYPE)
@@ -541,6 +801,7 @@ int (var_Change)(vlc_object_t *p_this, const char *psz_name, int i_action, ...)
             CheckValue( p_var, &newval );
             /* Set the variable */
             p_var->val = newval;
+            VarPublish( p_var );
             /* Free data if needed */
             p_var->ops->pf_free( &oldval );
             break;
@@ -643,6 +904,7 @@ int (var_GetAndSet)(vlc_object_t *p_this, const char *psz_name, int i_action,
 
     /*  Check boundaries */
     CheckValue( p_var, &p_var->val );
+    VarPublish( p_var );
     *p_val = p_var->val;
 
     /* Deal with callbacks.*/
@@ -707,6 +969,7 @@ int (var_SetChecked)(vlc_object_t *p_this, const char *psz_name,
 
     /* Set the variable */
     p_var->val = val;
+    VarPublish( p_var );
 
     /* Deal with callbacks */
     TriggerCallback( p_this, p_var, psz_name, oldval );
@@ -729,10 +992,28 @@ int (var_GetChecked)(vlc_object_t *p_this, const char *psz_name,
     assert( p_this );
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
+    uint32_t hash = VarHash( psz_name );
     variable_t *p_var;
     int err = VLC_SUCCESS;
 
-    p_var = Lookup( p_this, psz_name );
+    /* Fast path: values without dynamic storage are read lock-less */
+    vlc_rcu_read_lock();
+    p_var = VarFind( p_priv, psz_name, hash );
+    if( p_var != NULL && p_var->ops->pf_dup == DupDummy )
+    {
+        assert( expected_type == 0 || p_var->ops->i_class == expected_type );
+        assert( p_var->ops->i_class != VLC_VAR_VOID );
+
+        uint64_t raw = atomic_load_explicit( &p_var->fast_val,
+                                             memory_order_acquire );
+        vlc_rcu_read_unlock();
+        memcpy( p_val, &raw, sizeof (raw) );
+        return VLC_SUCCESS;
+    }
+    vlc_rcu_read_unlock();
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    p_var = VarFind( p_priv, psz_name, hash );
     if( p_var != NULL )
     {
         assert( expected_type == 0 ||
@@ -1137,21 +1418,6 @@ error:
     return VLC_EGENERIC;
 }
 
-static thread_local void *twalk_ctx;
-
-static void TwalkGetNames(const void *data, const VISIT which, const int depth)
-{
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
-
-    const variable_t *var = *(const variable_t **)data;
-    DECL_ARRAY(char *) *names = twalk_ctx;
-    char *dup = strdup(var->psz_name);
-    if (dup != NULL)
-        ARRAY_APPEND(*names, dup);
-}
-
 char **var_GetAllNames(vlc_object_t *obj)
 {
     vlc_object_internals_t *priv = vlc_internals(obj);
@@ -1159,9 +1425,22 @@ char **var_GetAllNames(vlc_object_t *obj)
     DECL_ARRAY(char *) names;
     ARRAY_INIT(names);
 
-    twalk_ctx = &names;
     vlc_mutex_lock(&priv->var_lock);
-    twalk(priv->var_root, TwalkGetNames);
+    const struct vlc_var_table *table =
+        atomic_load_explicit(&priv->var_table, memory_order_relaxed);
+
+    if (table != NULL)
+        for (size_t i = 0; i <= table->mask; i++)
+            for (const variable_t *var =
+                     atomic_load_explicit(&table->buckets[i],
+                                          memory_order_relaxed);
+                 var != NULL;
+                 var = atomic_load_explicit(&var->next, memory_order_relaxed))
+            {
+                char *dup = strdup(var->psz_name);
+                if (dup != NULL)
+                    ARRAY_APPEND(names, dup);
+            }
     vlc_mutex_unlock(&priv->var_lock);
 
     if (names.i_size == 0)
@@ -23,9 +23,22 @@
 #ifndef LIBVLC_VARIABLES_H
 # define LIBVLC_VARIABLES_H 1
 
+# include <stdatomic.h>
 # include <vlc_list.h>
 
 struct vlc_res;
+struct vlc_var_table;
+
+/**
+ * Variables and hash tables unlinked from an object, which lock-less readers
+ * may still be looking at.
+ */
+struct vlc_var_retired
+{
+    struct variable_t *vars;
+    struct vlc_var_table *tables;
+    size_t count;
+};
 
 /**
  * Private LibVLC data for each object.
@@ -38,7 +51,9 @@ struct vlc_object_internals
     const char *typename; /**< Object type human-readable name */
 
     /* Object variables */
-    void           *var_root;
+    struct vlc_var_table *_Atomic var_table; /**< RCU-protected hash index */
+    size_t          var_count;
+    struct vlc_var_retired var_retired; /**< Awaiting RCU grace period */
     vlc_mutex_t     var_lock;
 
     /* Object resources */
@@ -771,6 +771,7 @@ void module_EndBank (bool b_plugins)
         modules.caches = NULL;
         modules.caps_tree = NULL;
         modules.count = 0;
+        vlc_probe_cache_Clear();
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -39,6 +39,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_vector.h>
 #include "libvlc.h"
 
 #include <vlc_plugin.h>
@@ -57,80 +58,135 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 36
+#define CACHE_SUBVERSION_NUM 37
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
 /* Magic for the cache filename */
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
 
+/*
+ * Cache file layout
+ *
+ * After the magic strings and sub-version number, the cache consists of
+ * a header and of tables of fixed-size records. The header gives the offset
+ * (relative to itself) and the element count of each table. Records never
+ * contain pointers; strings are referred to by their byte offset in the
+ * strings pool, whereby offset zero denotes a NULL string; shortcuts and
+ * choices lists are referred to by the index of their first element in the
+ * 32-bits indices pool. As such, the file is position-independent and is
+ * used in place from its memory mapping.
+ *
+ * Only the data needed to look modules and configuration items up is loaded
+ * with the module bank. The rest of the configuration items is loaded on
+ * first use, see vlc_cache_load_params().
+ */
+#define CACHE_ALIGN 8
 
-static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
+struct vlc_cache_section
 {
-    if (in->i_buffer < size)
-        return -1;
+    uint32_t offset; /**< Byte offset from the header */
+    uint32_t count; /**< Element count */
+};
 
-    memcpy(out, in->p_buffer, size);
-    in->p_buffer += size;
-    in->i_buffer -= size;
-    return 0;
-}
-
-static int vlc_cache_load_bool(bool *out, block_t *in)
+struct vlc_cache_header
+{
+    struct vlc_cache_section plugins;
+    struct vlc_cache_section modules;
+    struct vlc_cache_section params;
+    struct vlc_cache_section indices;
+    struct vlc_cache_section strings;
+};
+
+struct vlc_cache_plugin
 {
-    unsigned char b;
+    int64_t mtime;
+    uint64_t size;
+    uint32_t path;
+    uint32_t textdomain;
+    uint32_t modules; /**< Index of the first module */
+    uint32_t modules_count;
+    uint32_t params; /**< Index of the first configuration item */
+    uint32_t params_count;
+    uint8_t unloadable;
+};
+
+struct vlc_cache_module
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t capability;
+    uint32_t activate;
+    uint32_t deactivate;
+    uint32_t shortcuts; /**< Index of the first shortcut */
+    uint32_t shortcuts_count;
+    int32_t score;
+};
+
+union vlc_cache_value
+{
+    int64_t i;
+    float f;
+};
 
-    if (vlc_cache_load_immediate(&b, in, 1) || b > 1)
-        return -1;
+#define CACHE_PARAM_INTERNAL 0x1
+#define CACHE_PARAM_UNSAVED  0x2
+#define CACHE_PARAM_SAFE     0x4
+#define CACHE_PARAM_OBSOLETE 0x8
 
-    *out = b;
-    return 0;
+struct vlc_cache_param
+{
+    union vlc_cache_value orig;
+    union vlc_cache_value min;
+    union vlc_cache_value max;
+    uint32_t name;
+    uint32_t type_name;
+    uint32_t text;
+    uint32_t longtext;
+    uint32_t orig_psz;
+    uint32_t list; /**< Index of the first choice */
+    uint32_t list_text; /**< Index of the first choice name */
+    uint16_t list_count;
+    uint8_t type;
+    uint8_t shortname;
+    uint8_t flags;
+};
+
+static const void *vlc_cache_section(const struct vlc_cache_header *hdr,
+                                     const struct vlc_cache_section *section)
+{
+    return (const unsigned char *)hdr + section->offset;
 }
 
-static int vlc_cache_load_array(const void **p, size_t size, size_t n,
-                                block_t *file)
+static const char *vlc_cache_string(const struct vlc_cache_header *hdr,
+                                    uint32_t offset)
 {
-    if (n == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    if (unlikely(size * n < size))
-        return -1;
-
-    size *= n;
-
-    if (file->i_buffer < size)
-        return -1;
+    if (offset == 0 || offset >= hdr->strings.count)
+        return NULL;
 
-    *p = file->p_buffer;
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    return 0;
+    const char *strings = vlc_cache_section(hdr, &hdr->strings);
+    return strings + offset;
 }
 
-static int vlc_cache_load_string(const char **restrict p, block_t *file)
+static const uint32_t *vlc_cache_indices(const struct vlc_cache_header *hdr,
+                                         uint32_t first, size_t count)
 {
-    uint16_t size;
-
-    if (vlc_cache_load_immediate(&size, file, sizeof (size)) || size > 16384)
-        return -1;
-
-    if (size == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
+    if (first > hdr->indices.count || count > hdr->indices.count - first)
+        return NULL;
 
-    const char *str = (char *)file->p_buffer;
+    const uint32_t *indices = vlc_cache_section(hdr, &hdr->indices);
+    return indices + first;
+}
 
-    if (file->i_buffer < size || str[size - 1] != '\0')
+static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
+{
+    if (in->i_buffer < size)
         return -1;
 
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    *p = str;
+    memcpy(out, in->p_buffer, size);
+    in->p_buffer += size;
+    in->i_buffer -= size;
     return 0;
 }
 
@@ -153,206 +209,256 @@ static int vlc_cache_load_align(size_t align, block_t *file)
     return 0;
 }
 
-#define LOAD_IMMEDIATE(a) \
-    if (vlc_cache_load_immediate(&(a), file, sizeof (a))) \
-        goto error
-#define LOAD_FLAG(a) \
-    do \
-    { \
-        bool b; \
-        if (vlc_cache_load_bool(&b, file)) \
-            goto error; \
-        (a) = b; \
-    } while (0)
-#define LOAD_ARRAY(a,n) \
-    do \
-    { \
-        const void *base; \
-        if (vlc_cache_load_array(&base, sizeof (*(a)), (n), file)) \
-            goto error; \
-        (a) = base; \
-    } while (0)
-#define LOAD_STRING(a) \
-    if (vlc_cache_load_string(&(a), file)) \
-        goto error
-#define LOAD_ALIGNOF(t) \
-    if (vlc_cache_load_align(alignof(t), file)) \
-        goto error
-
-static int vlc_cache_load_config(struct vlc_param *param, block_t *file)
+static int vlc_cache_check_section(const struct vlc_cache_section *section,
+                                   size_t elemsize, size_t size)
+{
+    if ((section->offset % CACHE_ALIGN) != 0 || section->offset > size)
+        return -1;
+    return (section->count <= (size - section->offset) / elemsize) ? 0 : -1;
+}
+
+static void vlc_cache_load_param(struct vlc_param *param,
+                                 const struct vlc_cache_header *hdr,
+                                 const struct vlc_cache_param *cp)
 {
     module_config_t *cfg = &param->item;
+    size_t count = cp->list_count;
+    const uint32_t *list = vlc_cache_indices(hdr, cp->list, count);
+    const uint32_t *list_text = vlc_cache_indices(hdr, cp->list_text, count);
 
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (param->shortname);
-    LOAD_FLAG (param->internal);
-    LOAD_FLAG (param->unsaved);
-    LOAD_FLAG (param->safe);
-    LOAD_FLAG (param->obsolete);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
+    cfg->psz_type = vlc_cache_string(hdr, cp->type_name);
+    cfg->psz_text = vlc_cache_string(hdr, cp->text);
+    cfg->psz_longtext = vlc_cache_string(hdr, cp->longtext);
 
-    if (IsConfigStringType (cfg->i_type))
+    if (list == NULL || list_text == NULL)
+        count = 0;
+    if (count > 0)
+    {
+        cfg->list_text = vlc_alloc(count, sizeof (*cfg->list_text));
+        if (unlikely(cfg->list_text == NULL))
+            count = 0;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *text = vlc_cache_string(hdr, list_text[i]);
+        cfg->list_text[i] = (text != NULL) ? text : "";
+    }
+
+    if (IsConfigStringType(cfg->i_type))
     {
-        const char *psz;
-        LOAD_STRING(psz);
+        const char *psz = vlc_cache_string(hdr, cp->orig_psz);
+        char *str = NULL;
+
+        if (psz != NULL && psz[0] != '\0')
+            str = strdup(psz);
+
         cfg->orig.psz = (char *)psz;
-        atomic_init(&param->value.str, NULL);
-        vlc_param_SetString(param, psz);
+        cfg->value.psz = str;
+        atomic_store_explicit(&param->value.str, str, memory_order_relaxed);
 
-        if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        for (unsigned i = 0; i < cfg->list_count; i++)
+        if (count > 0)
         {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
-                goto error;
+            cfg->list.psz = vlc_alloc(count, sizeof (*cfg->list.psz));
+            if (unlikely(cfg->list.psz == NULL))
+            {
+                free(cfg->list_text);
+                cfg->list_text = NULL;
+                count = 0;
+            }
         }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const char *value = vlc_cache_string(hdr, list[i]);
+            cfg->list.psz[i] = (value != NULL) ? value : "";
+        }
+    }
+    else if (IsConfigFloatType(cfg->i_type))
+    {
+        cfg->orig.f = cp->orig.f;
+        cfg->min.f = cp->min.f;
+        cfg->max.f = cp->max.f;
+        cfg->value = cfg->orig;
+        atomic_store_explicit(&param->value.f, cfg->orig.f,
+                              memory_order_relaxed);
+        cfg->list.i = (const int *)list;
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
-        if (IsConfigFloatType(cfg->i_type))
-            atomic_store_explicit(&param->value.f, cfg->orig.f,
-                                  memory_order_relaxed);
-        else
-            atomic_store_explicit(&param->value.i, cfg->orig.i,
-                                  memory_order_relaxed);
+        cfg->orig.i = cp->orig.i;
+        cfg->min.i = cp->min.i;
+        cfg->max.i = cp->max.i;
         cfg->value = cfg->orig;
+        atomic_store_explicit(&param->value.i, cfg->orig.i,
+                              memory_order_relaxed);
+        cfg->list.i = (const int *)list;
+    }
 
-        if (cfg->list_count)
-        {
-            LOAD_ALIGNOF(int);
-        }
+    cfg->list_count = count;
+}
 
-        LOAD_ARRAY(cfg->list.i, cfg->list_count);
-    }
+static vlc_mutex_t cache_lock = VLC_STATIC_MUTEX;
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
-    for (unsigned i = 0; i < cfg->list_count; i++)
+/**
+ * Completes the configuration items of a plug-in loaded from the cache.
+ *
+ * Descriptions, default values and choices are only read from the cache file
+ * when the configuration of the plug-in is actually used.
+ */
+void vlc_cache_load_params(vlc_plugin_t *plugin)
+{
+    vlc_mutex_lock(&cache_lock);
+    if (!atomic_load_explicit(&plugin->conf.loaded, memory_order_relaxed))
     {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
-    }
+        const struct vlc_cache_header *hdr = plugin->conf.cache;
+        const struct vlc_cache_param *params =
+            vlc_cache_section(hdr, &hdr->params);
 
-    return 0;
-error:
-    return -1; /* FIXME: leaks */
+        params += plugin->conf.cache_offset;
+
+        for (size_t i = 0; i < plugin->conf.size; i++)
+            vlc_cache_load_param(plugin->conf.params + i, hdr, params + i);
+
+        atomic_store_explicit(&plugin->conf.loaded, true,
+                              memory_order_release);
+    }
+    vlc_mutex_unlock(&cache_lock);
 }
 
-static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin,
+                                        const struct vlc_cache_header *hdr,
+                                        const struct vlc_cache_plugin *cp)
 {
-    uint16_t lines;
+    size_t lines = cp->params_count;
 
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (lines);
+    if (cp->params > hdr->params.count
+     || lines > hdr->params.count - cp->params)
+        return -1;
+    if (lines == 0)
+        return 0;
 
     /* Allocate memory */
-    if (lines)
-    {
-        plugin->conf.params = calloc(sizeof (struct vlc_param), lines);
-        if (unlikely(plugin->conf.params == NULL))
-        {
-            plugin->conf.size = 0;
-            return -1;
-        }
-    }
-    else
-        plugin->conf.params = NULL;
+    plugin->conf.params = calloc(lines, sizeof (struct vlc_param));
+    if (unlikely(plugin->conf.params == NULL))
+        return -1;
 
     plugin->conf.size = lines;
 
-    /* Do the duplication job */
+    const struct vlc_cache_param *params =
+        vlc_cache_section(hdr, &hdr->params);
+
+    params += cp->params;
+
+    /* Only load what is needed to look the items up */
     for (size_t i = 0; i < lines; i++)
     {
         struct vlc_param *param = plugin->conf.params + i;
         module_config_t *item = &param->item;
 
-        if (vlc_cache_load_config(param, file))
-            return -1;
+        param->owner = plugin;
+        param->shortname = params[i].shortname;
+        param->internal = (params[i].flags & CACHE_PARAM_INTERNAL) != 0;
+        param->unsaved = (params[i].flags & CACHE_PARAM_UNSAVED) != 0;
+        param->safe = (params[i].flags & CACHE_PARAM_SAFE) != 0;
+        param->obsolete = (params[i].flags & CACHE_PARAM_OBSOLETE) != 0;
+        item->i_type = params[i].type;
+        item->psz_name = vlc_cache_string(hdr, params[i].name);
+
+        if (IsConfigStringType(item->i_type))
+            atomic_init(&param->value.str, NULL);
 
         if (CONFIG_ITEM(item->i_type))
         {
+            if (item->psz_name == NULL)
+                return -1;
+
             plugin->conf.count++;
             if (item->i_type == CONFIG_ITEM_BOOL)
                 plugin->conf.booleans++;
         }
-        param->owner = plugin;
     }
 
+    plugin->conf.cache = hdr;
+    plugin->conf.cache_offset = cp->params;
+    atomic_store_explicit(&plugin->conf.loaded, false, memory_order_relaxed);
     return 0;
-error:
-    return -1; /* FIXME: leaks */
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_module(vlc_plugin_t *plugin,
+                                 const struct vlc_cache_header *hdr,
+                                 const struct vlc_cache_module *cm)
 {
+    const uint32_t *shortcuts = vlc_cache_indices(hdr, cm->shortcuts,
+                                                  cm->shortcuts_count);
+    if (shortcuts == NULL || cm->shortcuts_count > MODULE_SHORTCUT_MAX)
+        return -1;
+
     module_t *module = vlc_module_create(plugin);
     if (unlikely(module == NULL))
         return -1;
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
+    module->psz_shortname = vlc_cache_string(hdr, cm->shortname);
+    module->psz_longname = vlc_cache_string(hdr, cm->longname);
+    module->psz_help = vlc_cache_string(hdr, cm->help);
 
-    LOAD_IMMEDIATE(module->i_shortcuts);
-    if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
-        goto error;
-    else
+    if (cm->shortcuts_count > 0)
     {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            LOAD_STRING(module->pp_shortcuts[j]);
+        module->pp_shortcuts = vlc_alloc(cm->shortcuts_count,
+                                         sizeof (*module->pp_shortcuts));
+        if (unlikely(module->pp_shortcuts == NULL))
+            return -1;
+    }
+
+    module->i_shortcuts = cm->shortcuts_count;
+    for (unsigned j = 0; j < module->i_shortcuts; j++)
+    {
+        module->pp_shortcuts[j] = vlc_cache_string(hdr, shortcuts[j]);
+        if (module->pp_shortcuts[j] == NULL)
+            return -1;
     }
 
-    LOAD_STRING(module->activate_name);
-    LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
+    module->activate_name = vlc_cache_string(hdr, cm->activate);
+    module->deactivate_name = vlc_cache_string(hdr, cm->deactivate);
+    module->psz_capability = vlc_cache_string(hdr, cm->capability);
+    module->i_score = cm->score;
     return 0;
-error:
-    return -1;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+static vlc_plugin_t *vlc_cache_load_plugin(const struct vlc_cache_header *hdr,
+                                           const struct vlc_cache_plugin *cp)
 {
+    const char *path = vlc_cache_string(hdr, cp->path);
+
+    if (path == NULL || cp->modules > hdr->modules.count
+     || cp->modules_count > hdr->modules.count - cp->modules)
+        return NULL;
+
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
         return NULL;
 
-    uint32_t modules;
-    LOAD_IMMEDIATE(modules);
+    const struct vlc_cache_module *modules =
+        vlc_cache_section(hdr, &hdr->modules);
 
-    for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+    for (size_t i = 0; i < cp->modules_count; i++)
+        if (vlc_cache_load_module(plugin, hdr, modules + cp->modules + i))
             goto error;
 
-    if (vlc_cache_load_plugin_config(plugin, file))
-        goto error;
-
-    LOAD_STRING(plugin->textdomain);
-
-    const char *path;
-    LOAD_STRING(path);
-    if (path == NULL)
+    if (vlc_cache_load_plugin_config(plugin, hdr, cp))
         goto error;
 
+    plugin->textdomain = vlc_cache_string(hdr, cp->textdomain);
     plugin->path = strdup(path);
     if (unlikely(plugin->path == NULL))
         goto error;
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+    if (cp->unloadable > 1)
+        goto error;
+
+    plugin->unloadable = cp->unloadable;
+    plugin->mtime = cp->mtime;
+    plugin->size = cp->size;
 
     if (plugin->textdomain != NULL)
         vlc_bindtextdomain(plugin->textdomain);
@@ -445,9 +551,38 @@ vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
 
     vlc_plugin_t *cache = NULL;
 
-    while (file->i_buffer > 0)
+    if (vlc_cache_load_align(CACHE_ALIGN, file)
+     || file->i_buffer < sizeof (struct vlc_cache_header))
+        goto error;
+
+    /* Check the tables bounds once and for all */
+    const struct vlc_cache_header *hdr = (const void *)file->p_buffer;
+
+    if (vlc_cache_check_section(&hdr->plugins,
+                                sizeof (struct vlc_cache_plugin),
+                                file->i_buffer)
+     || vlc_cache_check_section(&hdr->modules,
+                                sizeof (struct vlc_cache_module),
+                                file->i_buffer)
+     || vlc_cache_check_section(&hdr->params,
+                                sizeof (struct vlc_cache_param),
+                                file->i_buffer)
+     || vlc_cache_check_section(&hdr->indices, sizeof (uint32_t),
+                                file->i_buffer)
+     || vlc_cache_check_section(&hdr->strings, 1, file->i_buffer)
+     || hdr->strings.count == 0)
+        goto error;
+
+    const char *strings = vlc_cache_section(hdr, &hdr->strings);
+    if (strings[hdr->strings.count - 1] != '\0')
+        goto error;
+
+    const struct vlc_cache_plugin *plugins =
+        vlc_cache_section(hdr, &hdr->plugins);
+
+    for (size_t i = 0; i < hdr->plugins.count; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(hdr, plugins + i);
         if (plugin == NULL)
             goto error;
 
@@ -470,135 +605,219 @@ vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
+    while (cache != NULL)
+    {
+        vlc_plugin_t *plugin = cache;
+
+        cache = plugin->next;
+        vlc_plugin_destroy(plugin);
+    }
     block_Release(file);
     return NULL;
 }
 
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&(a), sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
-
-static int CacheSaveString (FILE *file, const char *str)
+/**
+ * Plugins cache tables being built in memory.
+ */
+struct vlc_cache_writer
 {
-    uint16_t size = (str != NULL) ? (strlen (str) + 1) : 0;
-
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite(str, 1, size, file) != size)
-    {
-error:
-        return -1;
-    }
-    return 0;
-}
-
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
-        goto error
-
-static int CacheSaveAlign(FILE *file, size_t align)
+    struct VLC_VECTOR(struct vlc_cache_plugin) plugins;
+    struct VLC_VECTOR(struct vlc_cache_module) modules;
+    struct VLC_VECTOR(struct vlc_cache_param) params;
+    struct VLC_VECTOR(uint32_t) indices;
+    struct VLC_VECTOR(char) strings;
+    bool error;
+};
+
+static uint32_t CacheSaveString(struct vlc_cache_writer *w, const char *str)
 {
-    assert(align > 0);
-
-    size_t skip = (-ftell(file)) % align;
-    if (skip == 0)
+    if (str == NULL)
         return 0;
 
-    assert(((ftell(file) + skip) % align) == 0);
-    return fseek(file, skip, SEEK_CUR);
+    size_t offset = w->strings.size;
+
+    if (!vlc_vector_push_all(&w->strings, str, strlen(str) + 1))
+        w->error = true;
+    return offset;
 }
 
-#define SAVE_ALIGNOF(t) \
-    if (CacheSaveAlign(file, alignof (t))) \
-        goto error
+static void CacheSaveIndex(struct vlc_cache_writer *w, uint32_t value)
+{
+    if (!vlc_vector_push(&w->indices, value))
+        w->error = true;
+}
 
-static int CacheSaveConfig(FILE *file, const struct vlc_param *param)
+static void CacheSaveConfig(struct vlc_cache_writer *w,
+                            const struct vlc_param *param)
 {
     const module_config_t *cfg = &param->item;
-
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (param->shortname);
-    SAVE_FLAG (param->internal);
-    SAVE_FLAG (param->unsaved);
-    SAVE_FLAG (param->safe);
-    SAVE_FLAG (param->obsolete);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
+    struct vlc_cache_param cp = {
+        .name = CacheSaveString(w, cfg->psz_name),
+        .type_name = CacheSaveString(w, cfg->psz_type),
+        .text = CacheSaveString(w, cfg->psz_text),
+        .longtext = CacheSaveString(w, cfg->psz_longtext),
+        .list_count = cfg->list_count,
+        .type = cfg->i_type,
+        .shortname = param->shortname,
+        .flags = (param->internal ? CACHE_PARAM_INTERNAL : 0)
+               | (param->unsaved ? CACHE_PARAM_UNSAVED : 0)
+               | (param->safe ? CACHE_PARAM_SAFE : 0)
+               | (param->obsolete ? CACHE_PARAM_OBSOLETE : 0),
+    };
+
+    cp.list = w->indices.size;
 
     if (IsConfigStringType (cfg->i_type))
     {
-        SAVE_STRING (cfg->orig.psz);
+        cp.orig_psz = CacheSaveString(w, cfg->orig.psz);
 
         for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
+            CacheSaveIndex(w, CacheSaveString(w, cfg->list.psz[i]));
     }
     else
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
-
-        if (cfg->list_count > 0)
+        if (IsConfigFloatType (cfg->i_type))
         {
-            SAVE_ALIGNOF(int);
+            cp.orig.f = cfg->orig.f;
+            cp.min.f = cfg->min.f;
+            cp.max.f = cfg->max.f;
+        }
+        else
+        {
+            cp.orig.i = cfg->orig.i;
+            cp.min.i = cfg->min.i;
+            cp.max.i = cfg->max.i;
         }
 
         for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
+            CacheSaveIndex(w, cfg->list.i[i]);
     }
+
+    cp.list_text = w->indices.size;
+
     for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
+        CacheSaveIndex(w, CacheSaveString(w, cfg->list_text[i]));
 
-    return 0;
-error:
-    return -1;
+    if (!vlc_vector_push(&w->params, cp))
+        w->error = true;
 }
 
-static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
+static void CacheSaveModule(struct vlc_cache_writer *w,
+                            const module_t *module)
 {
-    uint16_t lines = plugin->conf.size;
+    struct vlc_cache_module cm = {
+        .shortname = CacheSaveString(w, module->psz_shortname),
+        .longname = CacheSaveString(w, module->psz_longname),
+        .help = CacheSaveString(w, module->psz_help),
+        .capability = CacheSaveString(w, module->psz_capability),
+        .activate = CacheSaveString(w, module->activate_name),
+        .deactivate = CacheSaveString(w, module->deactivate_name),
+        .shortcuts_count = module->i_shortcuts,
+        .score = module->i_score,
+    };
+
+    cm.shortcuts = w->indices.size;
 
-    SAVE_IMMEDIATE (lines);
+    for (size_t j = 0; j < module->i_shortcuts; j++)
+        CacheSaveIndex(w, CacheSaveString(w, module->pp_shortcuts[j]));
 
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig(file, plugin->conf.params + i))
-           goto error;
+    if (!vlc_vector_push(&w->modules, cm))
+        w->error = true;
+}
 
-    return 0;
-error:
-    return -1;
+static void CacheSavePlugin(struct vlc_cache_writer *w,
+                            const vlc_plugin_t *plugin)
+{
+    struct vlc_cache_plugin cp = {
+        .mtime = plugin->mtime,
+        .size = plugin->size,
+        .path = CacheSaveString(w, plugin->path),
+        .textdomain = CacheSaveString(w, plugin->textdomain),
+        .modules = w->modules.size,
+        .modules_count = plugin->modules_count,
+        .params = w->params.size,
+        .params_count = plugin->conf.size,
+        .unloadable = plugin->unloadable,
+    };
+
+    for (module_t *module = plugin->module;
+         module != NULL;
+         module = module->next)
+        CacheSaveModule(w, module);
+
+    for (size_t i = 0; i < plugin->conf.size; i++)
+        CacheSaveConfig(w, plugin->conf.params + i);
+
+    if (!vlc_vector_push(&w->plugins, cp))
+        w->error = true;
 }
 
-static int CacheSaveModule(FILE *file, const module_t *module)
+static int CacheSaveAlign(FILE *file, size_t align)
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
-    SAVE_IMMEDIATE(module->i_shortcuts);
+    assert(align > 0);
 
-    for (size_t j = 0; j < module->i_shortcuts; j++)
-         SAVE_STRING(module->pp_shortcuts[j]);
+    size_t skip = (-ftell(file)) % align;
+    if (skip == 0)
+        return 0;
 
-    SAVE_STRING(module->activate_name);
-    SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
-    return 0;
-error:
-    return -1;
+    assert(((ftell(file) + skip) % align) == 0);
+    return fseek(file, skip, SEEK_CUR);
+}
+
+static int CacheSaveSection(FILE *file, const void *data, size_t size)
+{
+    if (CacheSaveAlign(file, CACHE_ALIGN))
+        return -1;
+    return (size == 0 || fwrite(data, size, 1, file) == 1) ? 0 : -1;
+}
+
+static uint64_t CacheSetSection(struct vlc_cache_section *section,
+                                uint64_t offset, size_t count, size_t size)
+{
+    offset = (offset + CACHE_ALIGN - 1) & ~(uint64_t)(CACHE_ALIGN - 1);
+    section->offset = offset;
+    section->count = count;
+    return offset + (uint64_t)count * size;
 }
 
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
+    struct vlc_cache_writer w = { .error = false };
     uint32_t i_file_size = 0;
+    int ret = -1;
+
+    vlc_vector_init(&w.plugins);
+    vlc_vector_init(&w.modules);
+    vlc_vector_init(&w.params);
+    vlc_vector_init(&w.indices);
+    vlc_vector_init(&w.strings);
+
+    /* Offset zero is reserved for NULL strings */
+    if (!vlc_vector_push(&w.strings, '\0'))
+        goto error;
+
+    for (size_t i = 0; i < n; i++)
+        CacheSavePlugin(&w, cache[i]);
+
+    if (w.error)
+        goto error;
+
+    /* Lay the tables out */
+    struct vlc_cache_header hdr;
+    uint64_t offset = sizeof (hdr);
+
+    offset = CacheSetSection(&hdr.plugins, offset, w.plugins.size,
+                             sizeof (*w.plugins.data));
+    offset = CacheSetSection(&hdr.modules, offset, w.modules.size,
+                             sizeof (*w.modules.data));
+    offset = CacheSetSection(&hdr.params, offset, w.params.size,
+                             sizeof (*w.params.data));
+    offset = CacheSetSection(&hdr.indices, offset, w.indices.size,
+                             sizeof (*w.indices.data));
+    offset = CacheSetSection(&hdr.strings, offset, w.strings.size,
+                             sizeof (*w.strings.data));
+    if (offset > UINT32_MAX)
+        goto error;
 
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
@@ -619,37 +838,30 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
-    for (size_t i = 0; i < n; i++)
-    {
-        const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
-
-        SAVE_IMMEDIATE(count);
-
-        for (module_t *module = plugin->module;
-             module != NULL;
-             module = module->next)
-            if (CacheSaveModule(file, module))
-                goto error;
-
-        /* Config stuff */
-        if (CacheSaveModuleConfig(file, plugin))
-            goto error;
-
-        /* Save common info */
-        SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
-    }
+    if (CacheSaveSection(file, &hdr, sizeof (hdr))
+     || CacheSaveSection(file, w.plugins.data,
+                         w.plugins.size * sizeof (*w.plugins.data))
+     || CacheSaveSection(file, w.modules.data,
+                         w.modules.size * sizeof (*w.modules.data))
+     || CacheSaveSection(file, w.params.data,
+                         w.params.size * sizeof (*w.params.data))
+     || CacheSaveSection(file, w.indices.data,
+                         w.indices.size * sizeof (*w.indices.data))
+     || CacheSaveSection(file, w.strings.data,
+                         w.strings.size * sizeof (*w.strings.data)))
+        goto error;
 
     if (fflush (file)) /* flush libc buffers */
         goto error;
-    return 0; /* success! */
+    ret = 0; /* success! */
 
 error:
-    return -1;
+    vlc_vector_destroy(&w.strings);
+    vlc_vector_destroy(&w.indices);
+    vlc_vector_destroy(&w.params);
+    vlc_vector_destroy(&w.modules);
+    vlc_vector_destroy(&w.plugins);
+    return ret;
 }
 
 /**
@@ -660,6 +872,10 @@ void CacheSave(libvlc_int_t *p_this, const char *dir,
 {
     char *filename = NULL, *tmpname = NULL;
 
+    /* Entries from the previous cache must be complete to be saved */
+    for (size_t i = 0; i < n; i++)
+        vlc_plugin_LoadParams(entries[i]);
+
     if (asprintf (&filename, "%s"DIR_SEP CACHE_NAME, dir ) == -1)
         return;
 
@@ -105,6 +105,9 @@ vlc_plugin_t *vlc_plugin_create(void)
     plugin->conf.count = 0;
     plugin->conf.booleans = 0;
 #ifdef HAVE_DYNAMIC_PLUGINS
+    atomic_init(&plugin->conf.loaded, true);
+    plugin->conf.cache = NULL;
+    plugin->conf.cache_offset = 0;
     plugin->unloadable = true;
     atomic_init(&plugin->handle, 0);
     plugin->abspath = NULL;
@@ -28,6 +28,8 @@
 # include "config.h"
 #endif
 
+#include <ctype.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #ifdef ENABLE_NLS
@@ -187,29 +189,115 @@ void *vlc_module_map(vlc_logger_t *log, module_t *module)
     return vlc_plugin_Map(log, module->plugin) ? NULL : module->pf_activate;
 }
 
-/**
- * Finds and instantiates the best module of a certain type.
- * All candidates modules having the specified capability and name will be
- * sorted in decreasing order of priority. Then the probe callback will be
- * invoked for each module, until it succeeds (returns 0), or all candidate
- * module failed to initialize.
+/*
+ * Probe results cache
  *
- * The probe callback first parameter is the address of the module entry point.
- * Further parameters are passed as an argument list; it corresponds to the
- * variable arguments passed to this function. This scheme is meant to
- * support arbitrary prototypes for the module entry point.
- *
- * \param log logger (or NULL to ignore)
- * \param capability capability, i.e. class of module
- * \param name name of the module asked, if any
- * \param strict if true, do not fallback to plugin with a different name
- *                 but the same capability
- * \param probe module probe callback
- * \return the module or NULL in case of a failure
+ * Remembers which module accepted a given kind of media (as described by the
+ * caller with a vlc_probe_key). All the higher priority candidates rejected
+ * that media, so they are skipped the next time, unless the remembered module
+ * rejects the media too.
+ * The table is direct-mapped: colliding keys simply evict one another.
  */
-module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
-                            const char *name, bool strict,
-                            vlc_activate_t probe, ...)
+#define PROBE_CACHE_SIZE 256
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct
+    {
+        uint64_t key;
+        module_t *module;
+    } entries[PROBE_CACHE_SIZE];
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+    atomic_uint_fast64_t stale;
+} probe_cache = { .lock = VLC_STATIC_MUTEX };
+
+static uint64_t vlc_probe_hash(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * UINT64_C(0x100000001b3);
+    return h;
+}
+
+static uint64_t vlc_probe_hash_string(uint64_t h, const char *str)
+{
+    if (str == NULL)
+        str = "";
+    return vlc_probe_hash(h, str, strlen(str) + 1);
+}
+
+static uint64_t vlc_probe_key_hash(const char *capability, const char *name,
+                                   const struct vlc_probe_key *key)
+{
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+    char ext[16];
+    size_t len = 0;
+
+    /* File extensions are case-insensitive */
+    if (key->extension != NULL)
+        for (; key->extension[len] != '\0' && len < sizeof (ext); len++)
+            ext[len] = tolower((unsigned char)key->extension[len]);
+
+    /* The candidates, and their order, depend on the capability and name */
+    h = vlc_probe_hash_string(h, capability);
+    h = vlc_probe_hash_string(h, name);
+    h = vlc_probe_hash(h, &key->fourcc, sizeof (key->fourcc));
+    h = vlc_probe_hash(h, &key->profile, sizeof (key->profile));
+    h = vlc_probe_hash_string(h, key->mime);
+    h = vlc_probe_hash(h, &len, sizeof (len));
+    h = vlc_probe_hash(h, ext, len);
+    h = vlc_probe_hash(h, &key->signature_size, sizeof (key->signature_size));
+    h = vlc_probe_hash(h, key->signature, key->signature_size);
+    return h ? h : 1; /* zero denotes an empty slot */
+}
+
+static module_t *vlc_probe_cache_get(uint64_t key)
+{
+    module_t *module = NULL;
+    size_t slot = key % PROBE_CACHE_SIZE;
+
+    vlc_mutex_lock(&probe_cache.lock);
+    if (probe_cache.entries[slot].key == key)
+        module = probe_cache.entries[slot].module;
+    vlc_mutex_unlock(&probe_cache.lock);
+    return module;
+}
+
+static void vlc_probe_cache_put(uint64_t key, module_t *module)
+{
+    size_t slot = key % PROBE_CACHE_SIZE;
+
+    vlc_mutex_lock(&probe_cache.lock);
+    probe_cache.entries[slot].key = key;
+    probe_cache.entries[slot].module = module;
+    vlc_mutex_unlock(&probe_cache.lock);
+}
+
+void vlc_probe_cache_Clear(void)
+{
+    vlc_mutex_lock(&probe_cache.lock);
+    memset(probe_cache.entries, 0, sizeof (probe_cache.entries));
+    vlc_mutex_unlock(&probe_cache.lock);
+}
+
+void vlc_module_GetProbeStats(struct vlc_probe_stats *stats)
+{
+    stats->hits = atomic_load_explicit(&probe_cache.hits,
+                                       memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&probe_cache.misses,
+                                         memory_order_relaxed);
+    stats->stale = atomic_load_explicit(&probe_cache.stale,
+                                        memory_order_relaxed);
+}
+
+static module_t *vlc_module_load_va(struct vlc_logger *log,
+                                    const char *capability, const char *name,
+                                    bool strict,
+                                    const struct vlc_probe_key *key,
+                                    vlc_activate_t probe, va_list args)
 {
     if (name == NULL || name[0] == '\0')
         name = "any";
@@ -226,12 +314,31 @@ module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
     vlc_debug(log, "looking for %s module matching \"%s\": %zd candidates",
               capability, name, total);
 
-    module_t *module = NULL;
-    va_list args;
+    /* Skip the candidates that rejected similar media last time, i.e. those
+     * ranked before the module that accepted it. */
+    uint64_t hash = 0;
+    module_t *cached = NULL;
+    size_t first = 0, skip = total;
 
-    va_start(args, probe);
+    if (key != NULL)
+    {
+        hash = vlc_probe_key_hash(capability, name, key);
+
+        module_t *prev = vlc_probe_cache_get(hash);
 
-    for (size_t i = 0; i < (size_t)total; i++) {
+        for (size_t i = 0; prev != NULL && i < (size_t)total; i++)
+            if (mods[i] == prev)
+            {
+                cached = prev;
+                first = i;
+                break;
+            }
+    }
+
+    module_t *module = NULL;
+    size_t i = first;
+
+    while (i < (size_t)total) {
         module_t *cand = mods[i];
         int ret = VLC_EGENERIC;
         void *cb = vlc_module_map(log, cand);
@@ -253,10 +360,36 @@ module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
             case VLC_ETIMEOUT:
                 goto done;
         }
+
+        if (i == first && first > 0)
+        {
+            /* Not similar media after all: probe in order from the start */
+            vlc_debug(log, "cached %s module \"%s\" did not match",
+                      capability, module_get_object(cand));
+            skip = first;
+            first = 0;
+            i = 0;
+        }
+        else if (++i == skip)
+            i++; /* already probed */
     }
 
 done:
-    va_end (args);
+    if (key != NULL)
+    {
+        atomic_uint_fast64_t *counter;
+
+        if (cached == NULL)
+            counter = &probe_cache.misses;
+        else if (module == cached)
+            counter = &probe_cache.hits;
+        else
+            counter = &probe_cache.stale;
+        atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+
+        if (module != NULL && module != cached)
+            vlc_probe_cache_put(hash, module);
+    }
 
     if (module == NULL)
         vlc_debug(log, "no %s modules matched with name %s", capability, name);
@@ -265,6 +398,53 @@ done:
     return module;
 }
 
+/**
+ * Finds and instantiates the best module of a certain type.
+ * All candidates modules having the specified capability and name will be
+ * sorted in decreasing order of priority. Then the probe callback will be
+ * invoked for each module, until it succeeds (returns 0), or all candidate
+ * module failed to initialize.
+ *
+ * The probe callback first parameter is the address of the module entry point.
+ * Further parameters are passed as an argument list; it corresponds to the
+ * variable arguments passed to this function. This scheme is meant to
+ * support arbitrary prototypes for the module entry point.
+ *
+ * \param log logger (or NULL to ignore)
+ * \param capability capability, i.e. class of module
+ * \param name name of the module asked, if any
+ * \param strict if true, do not fallback to plugin with a different name
+ *                 but the same capability
+ * \param probe module probe callback
+ * \return the module or NULL in case of a failure
+ */
+module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
+                            const char *name, bool strict,
+                            vlc_activate_t probe, ...)
+{
+    va_list args;
+
+    va_start(args, probe);
+    module_t *module = vlc_module_load_va(log, capability, name, strict, NULL,
+                                          probe, args);
+    va_end(args);
+    return module;
+}
+
+module_t *vlc_module_load_cached(struct vlc_logger *log,
+                                 const char *capability, const char *name,
+                                 bool strict, const struct vlc_probe_key *key,
+                                 vlc_activate_t probe, ...)
+{
+    va_list args;
+
+    va_start(args, probe);
+    module_t *module = vlc_module_load_va(log, capability, name, strict, key,
+                                          probe, args);
+    va_end(args);
+    return module;
+}
+
 static int generic_start(void *func, bool forced, va_list ap)
 {
     vlc_object_t *obj = va_arg(ap, vlc_object_t *);
@@ -278,13 +458,13 @@ static int generic_start(void *func, bool forced, va_list ap)
     return ret;
 }
 
-#undef module_need
-module_t *module_need(vlc_object_t *obj, const char *cap, const char *name,
-                      bool strict)
+static module_t *vlc_module_need(vlc_object_t *obj, const char *cap,
+                                 const char *name, bool strict,
+                                 const struct vlc_probe_key *key)
 {
     const bool b_force_backup = obj->force; /* FIXME: remove this */
-    module_t *module = vlc_module_load(obj->logger, cap, name, strict,
-                                       generic_start, obj);
+    module_t *module = vlc_module_load_cached(obj->logger, cap, name, strict,
+                                              key, generic_start, obj);
     if (module != NULL) {
         var_Create(obj, "module-name", VLC_VAR_STRING);
         var_SetString(obj, "module-name", module_get_object(module));
@@ -294,6 +474,27 @@ module_t *module_need(vlc_object_t *obj, const char *cap, const char *name,
     return module;
 }
 
+#undef module_need
+module_t *module_need(vlc_object_t *obj, const char *cap, const char *name,
+                      bool strict)
+{
+    return vlc_module_need(obj, cap, name, strict, NULL);
+}
+
+module_t *module_need_cached(vlc_object_t *obj, const char *cap,
+                             const char *varname,
+                             const struct vlc_probe_key *key)
+{
+    char *list = var_InheritString(obj, varname);
+    if (unlikely(list == NULL))
+        return NULL;
+
+    module_t *m = vlc_module_need(obj, cap, list, false, key);
+
+    free(list);
+    return m;
+}
+
 #undef module_unneed
 void module_unneed(vlc_object_t *obj, module_t *module)
 {
@@ -332,7 +533,7 @@ module_t *module_find (const char *name)
 
 module_config_t *module_config_get( const module_t *module, unsigned *restrict psize )
 {
-    const vlc_plugin_t *plugin = module->plugin;
+    vlc_plugin_t *plugin = module->plugin;
 
     assert( psize != NULL );
     *psize = 0;
@@ -343,6 +544,8 @@ module_config_t *module_config_get( const module_t *module, unsigned *restrict p
         return NULL;
     }
 
+    vlc_plugin_LoadParams(plugin);
+
     size_t size = plugin->conf.size;
     module_config_t *config = vlc_alloc( size, sizeof( *config ) );
 
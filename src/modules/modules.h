@@ -25,8 +25,10 @@
 
 # include <stdatomic.h>
 # include <vlc_plugin.h>
+# include <vlc_modules.h>
 
 struct vlc_param;
+struct vlc_cache_header;
 
 /** VLC plugin */
 typedef struct vlc_plugin_t
@@ -46,6 +48,11 @@ typedef struct vlc_plugin_t
         size_t size; /**< Total count of all items */
         size_t count; /**< Count of real options (excludes hints) */
         size_t booleans; /**< Count of options that are of boolean type */
+#ifdef HAVE_DYNAMIC_PLUGINS
+        atomic_bool loaded; /**< Whether the items are completely loaded */
+        const struct vlc_cache_header *cache; /**< Cache to load items from */
+        size_t cache_offset; /**< Index of the first item in the cache */
+#endif
     } conf;
 
 #ifdef HAVE_DYNAMIC_PLUGINS
@@ -106,6 +113,11 @@ void vlc_module_destroy (module_t *);
 vlc_plugin_t *vlc_plugin_describe(vlc_plugin_cb);
 int vlc_plugin_resolve(vlc_plugin_t *, vlc_plugin_cb);
 
+/**
+ * Forgets all probe results (when the module bank is emptied).
+ */
+void vlc_probe_cache_Clear(void);
+
 void module_InitBank (void);
 void module_LoadPlugins(libvlc_int_t *);
 void module_EndBank (bool);
@@ -179,5 +191,24 @@ vlc_plugin_t *vlc_cache_load(libvlc_int_t *, const char *, block_t **);
 vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
 
 void CacheSave(libvlc_int_t *, const char *, vlc_plugin_t *const *, size_t);
+void vlc_cache_load_params(vlc_plugin_t *);
+
+/**
+ * Loads the configuration items of a plug-in completely.
+ *
+ * Configuration items from the plugins cache are loaded only partially with
+ * the module bank: names, types and flags. This function must be called
+ * before any other property of the items of a plug-in is used.
+ * vlc_param_Find() takes care of it for the looked up item.
+ */
+static inline void vlc_plugin_LoadParams(vlc_plugin_t *plugin)
+{
+#ifdef HAVE_DYNAMIC_PLUGINS
+    if (!atomic_load_explicit(&plugin->conf.loaded, memory_order_acquire))
+        vlc_cache_load_params(plugin);
+#else
+    (void) plugin;
+#endif
+}
 
 #endif /* !LIBVLC_MODULES_H */
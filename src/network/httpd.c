@@ -42,6 +42,7 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #include <string.h>
@@ -54,6 +55,10 @@
 #ifdef HAVE_POLL_H
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -68,8 +73,21 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+/* Maximum number of events handled per host loop iteration */
+# define HTTPD_EPOLL_EVENTS 64
+#endif
+
+/* Number of times a stream client can fall behind before it is evicted */
+#define HTTPD_STREAM_MAX_OVERRUNS 3
+
+typedef struct httpd_stream_chunk httpd_stream_chunk_t;
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+#ifdef HAVE_SYS_EPOLL_H
+static void httpd_ClientQueue(httpd_host_t *host, httpd_client_t *cl);
+#endif
+static void httpd_ChunkRelease(httpd_stream_chunk_t *chunk);
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -87,6 +105,11 @@ struct httpd_host_t
 
     vlc_thread_t thread;
     vlc_mutex_t lock;
+#ifdef HAVE_SYS_EPOLL_H
+    int         epfd;
+    int         wakefd; /* signaled when stream clients have new data */
+    struct vlc_list ready; /* clients to serve on the next iteration */
+#endif
 
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
      * This will slow down the url research but make my live easier
@@ -95,7 +118,7 @@ struct httpd_host_t
     struct vlc_list urls;
 
     size_t client_count;
-    struct vlc_list clients;
+    struct vlc_list clients; /* with epoll, ordered by timeout date */
     unsigned timeout_sec;
 
     /* TLS data */
@@ -118,6 +141,13 @@ struct httpd_url_t
         httpd_callback_t     cb;
         httpd_callback_sys_t *p_sys;
     } catch[HTTPD_MSG_MAX];
+
+#ifdef HAVE_SYS_EPOLL_H
+    /* Stream clients waiting for data (protected by the host lock) */
+    struct vlc_list waiting;
+    atomic_bool armed; /* a client is about to wait */
+    atomic_bool signaled; /* new data since the clients were armed */
+#endif
 };
 
 /* status */
@@ -143,8 +173,13 @@ struct httpd_client_t
     vlc_tls_t   *sock;
 
     struct vlc_list node;
+#ifdef HAVE_SYS_EPOLL_H
+    struct vlc_list queue_node; /* in the host ready list or a waiting list */
+    bool    b_queued;
+#endif
 
     bool    b_stream_mode;
+    bool    b_ready; /* socket may not block, always set if polling */
     uint8_t i_state;
 
     vlc_tick_t i_timeout_date;
@@ -154,6 +189,15 @@ struct httpd_client_t
     int     i_buffer;
     uint8_t *p_buffer;
 
+    /* Stream data that the buffer and the answer body point to, if any.
+     * Such data is shared by all the clients of the stream. */
+    httpd_stream_chunk_t *buffer_chunk;
+    httpd_stream_chunk_t *answer_chunk;
+
+    /* Stream mode statistics */
+    int64_t  i_stream_lag_max; /* bytes */
+    unsigned i_stream_overruns;
+
     /*
      * If waiting for a keyframe, this is the position (in bytes) of the
      * last keyframe the stream saw before this client connected.
@@ -625,9 +669,16 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* Circular array of the retained data blocks, each of them is sent
+     * as is to all the clients */
+    httpd_stream_chunk_t **pp_chunks;
+    size_t      i_chunks_max;       /* array size */
+    size_t      i_chunks_first;     /* index of the oldest block */
+    size_t      i_chunks;           /* count of blocks */
+    size_t      i_chunks_bytes;     /* size of the blocks */
+
+    int         i_buffer_size;      /* maximum size of the retained blocks */
+    int64_t     i_buffer_first_pos; /* position of the oldest block */
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -636,6 +687,63 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
+struct httpd_stream_chunk
+{
+    vlc_atomic_rc_t rc;
+    int64_t i_pos; /* absolute position of the block */
+    block_t *p_block;
+};
+
+static void httpd_ChunkRelease(httpd_stream_chunk_t *chunk)
+{
+    if (vlc_atomic_rc_dec(&chunk->rc)) {
+        block_Release(chunk->p_block);
+        free(chunk);
+    }
+}
+
+static httpd_stream_chunk_t *httpd_StreamChunkAt(const httpd_stream_t *stream,
+                                                  size_t i)
+{
+    assert(i < stream->i_chunks);
+    return stream->pp_chunks[(stream->i_chunks_first + i)
+                             % stream->i_chunks_max];
+}
+
+/* Finds the block holding the given position */
+static httpd_stream_chunk_t *httpd_StreamFindChunk(const httpd_stream_t *stream,
+                                                    int64_t i_pos)
+{
+    assert(stream->i_chunks > 0);
+    assert(i_pos >= stream->i_buffer_first_pos && i_pos < stream->i_buffer_pos);
+
+    size_t lo = 0, hi = stream->i_chunks - 1;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+
+        if (httpd_StreamChunkAt(stream, mid)->i_pos <= i_pos)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return httpd_StreamChunkAt(stream, lo);
+}
+
+/* Wakes the host thread up if stream clients wait for data on the URL.
+ * The host lock is not taken: the host thread holds it while sending. */
+static void httpd_UrlSignal(httpd_url_t *url)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (atomic_exchange(&url->armed, false)) {
+        atomic_store(&url->signaled, true);
+        eventfd_write(url->host->wakefd, 1);
+    }
+#else
+    VLC_UNUSED(url);
+#endif
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -646,47 +754,67 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
+        vlc_mutex_lock(&stream->lock);
 
         if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
+            goto wait;    /* wait, no data available */
+
+        bool b_first_keyframe = false;
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
             if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
                 /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
+                goto wait;
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
+            b_first_keyframe = true;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+        if (answer->i_body_offset < stream->i_buffer_first_pos) {
+            /* this client isn't fast enough (unless it has not received
+             * anything yet, and its keyframe already left the buffer) */
+            if (!b_first_keyframe
+             && ++cl->i_stream_overruns > HTTPD_STREAM_MAX_OVERRUNS) {
+                msg_Warn(stream->url->host, "evicting slow client of %s "
+                         "(%"PRId64" bytes behind)", stream->url->psz_url,
+                         stream->i_buffer_pos - answer->i_body_offset);
+                cl->i_state = HTTPD_CLIENT_DEAD;
+                goto wait;
+            }
+            answer->i_body_offset = stream->i_buffer_last_pos;
+        }
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        int64_t i_lag = stream->i_buffer_pos - answer->i_body_offset;
+        if (i_lag > cl->i_stream_lag_max)
+            cl->i_stream_lag_max = i_lag;
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+        /* Send from the shared block, without copying */
+        httpd_stream_chunk_t *chunk =
+            httpd_StreamFindChunk(stream, answer->i_body_offset);
+        size_t i_skip = answer->i_body_offset - chunk->i_pos;
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        assert(i_skip < chunk->p_block->i_buffer);
+        vlc_atomic_rc_inc(&chunk->rc);
+        vlc_mutex_unlock(&stream->lock);
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
+        assert(cl->answer_chunk == NULL);
+        cl->answer_chunk = chunk;
+        answer->i_body = chunk->p_block->i_buffer - i_skip;
+        answer->p_body = chunk->p_block->p_buffer + i_skip;
 
-        answer->i_body_offset += i_write;
+        answer->i_body_offset += answer->i_body;
 
         return VLC_SUCCESS;
+wait:
+        vlc_mutex_unlock(&stream->lock);
+        return VLC_EGENERIC;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
@@ -770,7 +898,6 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
         return NULL;
 
     stream->psz_mime = NULL;
-    stream->p_buffer = NULL;
 
     stream->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
     if (!stream->url)
@@ -787,13 +914,15 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-
-    stream->p_buffer = malloc(stream->i_buffer_size);
-    if (stream->p_buffer == NULL)
-        goto error;
+    stream->pp_chunks = NULL;
+    stream->i_chunks_max = 0;
+    stream->i_chunks_first = 0;
+    stream->i_chunks = 0;
+    stream->i_chunks_bytes = 0;
 
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
+    stream->i_buffer_first_pos = 1;
     stream->i_buffer_pos = 1;
     stream->i_buffer_last_pos = 1;
     stream->b_has_keyframes = false;
@@ -837,30 +966,68 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+static void httpd_StreamDropChunk(httpd_stream_t *stream)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
+    httpd_stream_chunk_t *chunk = httpd_StreamChunkAt(stream, 0);
+
+    stream->i_chunks_first = (stream->i_chunks_first + 1)
+                             % stream->i_chunks_max;
+    stream->i_chunks--;
+    stream->i_chunks_bytes -= chunk->p_block->i_buffer;
+    stream->i_buffer_first_pos = chunk->i_pos + chunk->p_block->i_buffer;
+    httpd_ChunkRelease(chunk);
+}
 
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+static int httpd_StreamAppendChunk(httpd_stream_t *stream,
+                                   httpd_stream_chunk_t *chunk)
+{
+    if (stream->i_chunks == stream->i_chunks_max) {
+        size_t max = stream->i_chunks_max ? 2 * stream->i_chunks_max : 64;
+        httpd_stream_chunk_t **pp = vlc_alloc(max, sizeof (*pp));
+        if (unlikely(pp == NULL))
+            return VLC_ENOMEM;
+
+        for (size_t i = 0; i < stream->i_chunks; i++)
+            pp[i] = httpd_StreamChunkAt(stream, i);
+        free(stream->pp_chunks);
+        stream->pp_chunks = pp;
+        stream->i_chunks_max = max;
+        stream->i_chunks_first = 0;
     }
 
-    stream->i_buffer_pos += i_data;
+    stream->pp_chunks[(stream->i_chunks_first + stream->i_chunks)
+                      % stream->i_chunks_max] = chunk;
+    stream->i_chunks++;
+    stream->i_chunks_bytes += chunk->p_block->i_buffer;
+    return VLC_SUCCESS;
 }
 
-int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
+int httpd_StreamSendBlock(httpd_stream_t *stream, block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block)
+        return VLC_SUCCESS;
+    if (!p_block->p_buffer || p_block->i_buffer == 0) {
+        block_Release(p_block);
         return VLC_SUCCESS;
+    }
+
+    httpd_stream_chunk_t *chunk = malloc(sizeof (*chunk));
+    if (unlikely(chunk == NULL)) {
+        block_Release(p_block);
+        return VLC_ENOMEM;
+    }
+
+    vlc_atomic_rc_init(&chunk->rc);
+    chunk->p_block = p_block;
 
     vlc_mutex_lock(&stream->lock);
+    chunk->i_pos = stream->i_buffer_pos;
+
+    if (httpd_StreamAppendChunk(stream, chunk)) {
+        vlc_mutex_unlock(&stream->lock);
+        httpd_ChunkRelease(chunk);
+        return VLC_ENOMEM;
+    }
 
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
@@ -870,12 +1037,29 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    stream->i_buffer_pos += p_block->i_buffer;
+
+    /* Forget the oldest blocks, clients still sending them keep them */
+    while (stream->i_chunks > 1
+        && stream->i_chunks_bytes > (size_t)stream->i_buffer_size)
+        httpd_StreamDropChunk(stream);
 
     vlc_mutex_unlock(&stream->lock);
+    httpd_UrlSignal(stream->url);
     return VLC_SUCCESS;
 }
 
+int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
+{
+    if (!p_block || !p_block->p_buffer)
+        return VLC_SUCCESS;
+
+    block_t *p_dup = block_Duplicate(p_block);
+    if (unlikely(p_dup == NULL))
+        return VLC_ENOMEM;
+    return httpd_StreamSendBlock(stream, p_dup);
+}
+
 void httpd_StreamDelete(httpd_stream_t *stream)
 {
     httpd_UrlDelete(stream->url);
@@ -886,7 +1070,9 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     free(stream->p_http_headers);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    while (stream->i_chunks > 0)
+        httpd_StreamDropChunk(stream);
+    free(stream->pp_chunks);
     free(stream);
 }
 
@@ -975,6 +1161,11 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     vlc_mutex_init(&host->lock);
     atomic_init(&host->ref, 1);
+#ifdef HAVE_SYS_EPOLL_H
+    host->epfd = -1;
+    host->wakefd = -1;
+    vlc_list_init(&host->ready);
+#endif
 
     char *hostname = var_InheritString(p_this, hostvar);
 
@@ -987,6 +1178,42 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     }
     for (host->nfd = 0; host->fds[host->nfd] != -1; host->nfd++);
 
+#ifdef HAVE_SYS_EPOLL_H
+    /* Listening sockets are level-triggered and have no client data,
+     * client sockets are edge-triggered (see httpdLoop()). */
+    host->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (host->epfd == -1) {
+        msg_Err(p_this, "cannot create HTTP host poller: %s",
+                vlc_strerror_c(errno));
+        goto error;
+    }
+
+    for (unsigned i = 0; i < host->nfd; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+
+        if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->fds[i], &ev)) {
+            msg_Err(p_this, "cannot poll HTTP host socket: %s",
+                    vlc_strerror_c(errno));
+            goto error;
+        }
+    }
+
+    host->wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (host->wakefd == -1) {
+        msg_Err(p_this, "cannot create HTTP host event: %s",
+                vlc_strerror_c(errno));
+        goto error;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = host };
+
+    if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->wakefd, &ev)) {
+        msg_Err(p_this, "cannot poll HTTP host event: %s",
+                vlc_strerror_c(errno));
+        goto error;
+    }
+#endif
+
     host->port     = port;
     vlc_list_init(&host->urls);
     host->client_count = 0;
@@ -1010,6 +1237,12 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+#ifdef HAVE_SYS_EPOLL_H
+        if (host->wakefd != -1)
+            vlc_close(host->wakefd);
+        if (host->epfd != -1)
+            vlc_close(host->epfd);
+#endif
         net_ListenClose(host->fds);
         vlc_object_delete(host);
     }
@@ -1045,6 +1278,10 @@ void httpd_HostDelete(httpd_host_t *host)
 
     assert(vlc_list_is_empty(&host->urls));
     vlc_tls_ServerDelete(host->p_tls);
+#ifdef HAVE_SYS_EPOLL_H
+    vlc_close(host->wakefd);
+    vlc_close(host->epfd);
+#endif
     net_ListenClose(host->fds);
     vlc_object_delete(host);
     vlc_mutex_unlock(&httpd.mutex);
@@ -1095,6 +1332,11 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
         url->catch[i].cb = NULL;
         url->catch[i].p_sys = NULL;
     }
+#ifdef HAVE_SYS_EPOLL_H
+    vlc_list_init(&url->waiting);
+    atomic_init(&url->armed, false);
+    atomic_init(&url->signaled, false);
+#endif
 
     vlc_list_append(&url->node, &host->urls);
     vlc_mutex_unlock(&host->lock);
@@ -1141,8 +1383,21 @@ void httpd_UrlDelete(httpd_url_t *url)
 
         /* TODO complete it */
         msg_Warn(host, "force closing connections");
+#ifdef HAVE_SYS_EPOLL_H
+        /* The host thread may hold pending events for this client: close
+         * the socket now, but leave the client to be freed by the thread. */
+        epoll_ctl(host->epfd, EPOLL_CTL_DEL, vlc_tls_GetFD(client->sock),
+                  NULL);
+        vlc_tls_Close(client->sock);
+        client->sock = NULL;
+        client->url = NULL;
+        client->i_state = HTTPD_CLIENT_DEAD;
+        httpd_ClientQueue(host, client);
+        eventfd_write(host->wakefd, 1);
+#else
         host->client_count--;
         httpd_ClientDestroy(client);
+#endif
     }
     free(url);
     vlc_mutex_unlock(&host->lock);
@@ -1227,17 +1482,73 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(vlc_tls_GetFD(cl->sock), ip, port) ? NULL : ip;
 }
 
+static void httpd_ClientReleaseBuffer(httpd_client_t *cl)
+{
+    if (cl->buffer_chunk != NULL) {
+        httpd_ChunkRelease(cl->buffer_chunk);
+        cl->buffer_chunk = NULL;
+    } else
+        free(cl->p_buffer);
+    cl->p_buffer = NULL;
+}
+
+/* Moves the answer body to the send buffer */
+static void httpd_ClientTakeBody(httpd_client_t *cl)
+{
+    httpd_ClientReleaseBuffer(cl);
+    cl->p_buffer      = cl->answer.p_body;
+    cl->buffer_chunk  = cl->answer_chunk;
+    cl->i_buffer_size = cl->answer.i_body;
+    cl->i_buffer      = 0;
+
+    cl->answer.p_body = NULL;
+    cl->answer.i_body = 0;
+    cl->answer_chunk  = NULL;
+}
+
 static void httpd_ClientDestroy(httpd_client_t *cl)
 {
     vlc_list_remove(&cl->node);
-    vlc_tls_Close(cl->sock);
+#ifdef HAVE_SYS_EPOLL_H
+    if (cl->b_queued)
+        vlc_list_remove(&cl->queue_node);
+#endif
+    if (cl->sock != NULL)
+        vlc_tls_Close(cl->sock);
+    if (cl->answer_chunk != NULL) {
+        cl->answer.p_body = NULL;
+        httpd_ChunkRelease(cl->answer_chunk);
+    }
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
-    free(cl->p_buffer);
+    httpd_ClientReleaseBuffer(cl);
     free(cl);
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+/* Queues the client to be served on the next iteration of the host thread */
+static void httpd_ClientQueue(httpd_host_t *host, httpd_client_t *cl)
+{
+    if (cl->b_queued)
+        vlc_list_remove(&cl->queue_node);
+    vlc_list_append(&cl->queue_node, &host->ready);
+    cl->b_queued = true;
+}
+
+/* Serves the waiting clients of the URLs which received stream data */
+static void httpd_HostWakeWaiting(httpd_host_t *host)
+{
+    httpd_url_t *url;
+    httpd_client_t *cl;
+
+    vlc_list_foreach(url, &host->urls, node)
+        if (atomic_exchange(&url->signaled, false))
+            vlc_list_foreach(cl, &url->waiting, queue_node)
+                httpd_ClientQueue(host, cl);
+}
+#endif
+
 static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock)
 {
     httpd_client_t *cl = malloc(sizeof(httpd_client_t));
@@ -1250,8 +1561,16 @@ static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock)
     cl->i_buffer_size = HTTPD_CL_BUFSIZE;
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc(cl->i_buffer_size);
+    cl->buffer_chunk = NULL;
+    cl->answer_chunk = NULL;
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->b_ready = true;
+#ifdef HAVE_SYS_EPOLL_H
+    cl->b_queued = false;
+#endif
+    cl->i_stream_lag_max = 0;
+    cl->i_stream_overruns = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1597,9 +1916,9 @@ static int httpd_ClientSend(httpd_client_t *cl)
             i_size += strlen(cl->answer.p_headers[i].name) + 2 +
                       strlen(cl->answer.p_headers[i].value) + 2;
 
-        if (cl->i_buffer_size < i_size) {
+        if (cl->buffer_chunk != NULL || cl->i_buffer_size < i_size) {
             cl->i_buffer_size = i_size;
-            free(cl->p_buffer);
+            httpd_ClientReleaseBuffer(cl);
             cl->p_buffer = xmalloc(i_size);
         }
         p = (char *)cl->p_buffer;
@@ -1646,17 +1965,13 @@ static int httpd_ClientSend(httpd_client_t *cl)
 
             cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
                                      &cl->answer, &cl->query);
+            if (cl->i_state == HTTPD_CLIENT_DEAD)
+                return 0; /* evicted */
         }
 
         if (cl->answer.i_body > 0) {
             /* send the body data */
-            free(cl->p_buffer);
-            cl->p_buffer = cl->answer.p_body;
-            cl->i_buffer_size = cl->answer.i_body;
-            cl->i_buffer = 0;
-
-            cl->answer.i_body = 0;
-            cl->answer.p_body = NULL;
+            httpd_ClientTakeBody(cl);
         } else /* send finished */
             cl->i_state = HTTPD_CLIENT_SEND_DONE;
     }
@@ -1714,8 +2029,79 @@ auth_failed:
     return false;
 }
 
+static void httpd_HostAccept(httpd_host_t *host, int fd, vlc_tick_t now)
+{
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
+    {
+        vlc_close(fd);
+        return;
+    }
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
+
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return;
+        }
+        sk = tls;
+    }
+
+    httpd_client_t *cl = httpd_ClientNew(sk);
+
+    if (unlikely(cl == NULL))
+    {
+        vlc_tls_Close(sk);
+        return;
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    /* Edge-triggered: the client is flagged ready on any event, and remains
+     * so until an I/O operation would block. Both directions are watched so
+     * that the registration never needs to be modified. */
+    struct epoll_event ev = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+        .data.ptr = cl,
+    };
+
+    if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, vlc_tls_GetFD(sk), &ev))
+    {
+        msg_Err(host, "cannot poll HTTP client socket: %s",
+                vlc_strerror_c(errno));
+        httpd_MsgClean(&cl->answer);
+        httpd_MsgClean(&cl->query);
+        free(cl->p_buffer);
+        free(cl);
+        vlc_tls_Close(sk);
+        return;
+    }
+#endif
+
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+
+    cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
+    host->client_count++;
+    vlc_list_append(&cl->node, &host->clients);
+#ifdef HAVE_SYS_EPOLL_H
+    httpd_ClientQueue(host, cl);
+#endif
+}
+
 static void httpdLoop(httpd_host_t *host)
 {
+#ifndef HAVE_SYS_EPOLL_H
     struct pollfd ufd[host->nfd + host->client_count];
     unsigned nfd;
     for (nfd = 0; nfd < host->nfd; nfd++) {
@@ -1723,6 +2109,7 @@ static void httpdLoop(httpd_host_t *host)
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
     }
+#endif
 
     vlc_mutex_lock(&host->lock);
     /* add all socket that should be read/write and close dead connection */
@@ -1731,24 +2118,79 @@ static void httpdLoop(httpd_host_t *host)
     httpd_client_t *cl;
 
     int canc = vlc_savecancel();
+#ifdef HAVE_SYS_EPOLL_H
+    /* Clients are ordered by timeout date: only visit the expired ones */
+    if (host->timeout_sec > 0)
+        vlc_list_foreach(cl, &host->clients, node) {
+            if (cl->i_timeout_date >= now)
+                break;
+            if (cl->b_stream_mode)
+                msg_Dbg(host, "stream client closed (maximum lag %"PRId64
+                        " bytes, %u overrun(s))", cl->i_stream_lag_max,
+                        cl->i_stream_overruns);
+            host->client_count--;
+            httpd_ClientDestroy(cl);
+        }
+
+    /* Only serve the clients with events, new stream data or progress to
+     * make; the others stay idle until then */
+    struct vlc_list ready;
+
+    vlc_list_init(&ready);
+    vlc_list_foreach(cl, &host->ready, queue_node) {
+        vlc_list_remove(&cl->queue_node);
+        vlc_list_append(&cl->queue_node, &ready);
+    }
+
+    vlc_list_foreach(cl, &ready, queue_node) {
+        int val = -1;
+        bool waited = cl->i_state == HTTPD_CLIENT_WAITING;
+
+        vlc_list_remove(&cl->queue_node);
+        cl->b_queued = false;
+
+        /* Arm before looking for stream data, see httpd_UrlSignal() */
+        if (waited)
+            atomic_store(&cl->url->armed, true);
+#else
     vlc_list_foreach(cl, &host->clients, node) {
         int val = -1;
+#endif
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-                val = httpd_ClientRecv(cl);
-                break;
-            case HTTPD_CLIENT_SENDING:
-                val = httpd_ClientSend(cl);
-                break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+        if (cl->b_ready)
+            switch (cl->i_state) {
+                case HTTPD_CLIENT_RECEIVING:
+                    val = httpd_ClientRecv(cl);
+                    break;
+                case HTTPD_CLIENT_SENDING:
+                    val = httpd_ClientSend(cl);
+                    break;
+                case HTTPD_CLIENT_TLS_HS_IN:
+                case HTTPD_CLIENT_TLS_HS_OUT:
+                    httpd_ClientTlsHandshake(host, cl);
+                    if (cl->i_state == HTTPD_CLIENT_RECEIVING)
+                        val = 0;
+                    break;
+            }
+#ifdef HAVE_SYS_EPOLL_H
+        if (val < 0)
+            switch (cl->i_state) {
+                case HTTPD_CLIENT_RECEIVING:
+                case HTTPD_CLIENT_SENDING:
+                case HTTPD_CLIENT_TLS_HS_IN:
+                case HTTPD_CLIENT_TLS_HS_OUT:
+                    /* would block, wait for the next event */
+                    cl->b_ready = false;
+                    break;
+            }
+#endif
 
         if (cl->i_state == HTTPD_CLIENT_DEAD
          || (host->timeout_sec > 0 && cl->i_timeout_date < now)) {
+            if (cl->b_stream_mode)
+                msg_Dbg(host, "stream client closed (maximum lag %"PRId64
+                        " bytes, %u overrun(s))", cl->i_stream_lag_max,
+                        cl->i_stream_overruns);
             host->client_count--;
             httpd_ClientDestroy(cl);
             continue;
@@ -1757,22 +2199,33 @@ static void httpdLoop(httpd_host_t *host)
         if (val == 0) {
             cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
             delay = 0;
+#ifdef HAVE_SYS_EPOLL_H
+            /* Keep the list ordered by timeout date */
+            vlc_list_remove(&cl->node);
+            vlc_list_append(&cl->node, &host->clients);
+#endif
         }
 
+#ifndef HAVE_SYS_EPOLL_H
         struct pollfd *pufd = ufd + nfd;
         assert (pufd < ufd + ARRAY_SIZE (ufd));
 
         pufd->events = pufd->revents = 0;
+#endif
 
         switch (cl->i_state) {
             case HTTPD_CLIENT_RECEIVING:
             case HTTPD_CLIENT_TLS_HS_IN:
+#ifndef HAVE_SYS_EPOLL_H
                 pufd->events = POLLIN;
+#endif
                 break;
 
             case HTTPD_CLIENT_SENDING:
             case HTTPD_CLIENT_TLS_HS_OUT:
+#ifndef HAVE_SYS_EPOLL_H
                 pufd->events = POLLOUT;
+#endif
                 break;
 
             case HTTPD_CLIENT_RECEIVE_DONE: {
@@ -1942,7 +2395,7 @@ static void httpdLoop(httpd_host_t *host)
 
                         cl->i_buffer = 0;
                         cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
+                        httpd_ClientReleaseBuffer(cl);
                         // Allocate an extra byte for the null terminating byte
                         cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
                         cl->i_state = HTTPD_CLIENT_RECEIVING;
@@ -1954,8 +2407,7 @@ static void httpdLoop(httpd_host_t *host)
                     httpd_MsgClean(&cl->answer);
 
                     cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
+                    httpd_ClientReleaseBuffer(cl);
                     cl->i_buffer = 0;
                     cl->i_buffer_size = 0;
 
@@ -1974,16 +2426,32 @@ static void httpdLoop(httpd_host_t *host)
                         &cl->answer, &cl->query);
                 if (cl->answer.i_type != HTTPD_MSG_NONE) {
                     /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
+                    httpd_ClientTakeBody(cl);
                     cl->i_state = HTTPD_CLIENT_SENDING;
                 }
             }
         }
 
+#ifdef HAVE_SYS_EPOLL_H
+        switch (cl->i_state) {
+            case HTTPD_CLIENT_DEAD:
+                httpd_ClientQueue(host, cl);
+                break;
+            case HTTPD_CLIENT_WAITING:
+                if (waited) {
+                    /* No data yet, httpd_UrlSignal() wakes the client up */
+                    vlc_list_append(&cl->queue_node, &cl->url->waiting);
+                    cl->b_queued = true;
+                } else
+                    httpd_ClientQueue(host, cl);
+                break;
+            default:
+                /* No edge will be reported for data already pending */
+                if (cl->b_ready)
+                    httpd_ClientQueue(host, cl);
+                break;
+        }
+#else
         pufd->fd = vlc_tls_GetPollFD(cl->sock, &pufd->events);
 
         if (pufd->events != 0)
@@ -1991,10 +2459,68 @@ static void httpdLoop(httpd_host_t *host)
         /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
         else if (delay != 0)
             delay = 20;
+#endif
     }
+#ifdef HAVE_SYS_EPOLL_H
+    /* Sleep until the first timeout at most */
+    if (!vlc_list_is_empty(&host->ready))
+        delay = 0;
+    else if (host->timeout_sec > 0 && !vlc_list_is_empty(&host->clients)) {
+        cl = vlc_list_first_entry_or_null(&host->clients, httpd_client_t,
+                                          node);
+        delay = MS_FROM_VLC_TICK(cl->i_timeout_date - now) + 1;
+    } else
+        delay = -1;
+#endif
     vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 
+#ifdef HAVE_SYS_EPOLL_H
+    /* Wait through poll() on the epoll descriptor itself: unlike
+     * epoll_wait(), it is a cancellation point on every platform. */
+    struct pollfd ufd = { .fd = host->epfd, .events = POLLIN };
+    struct epoll_event ev[HTTPD_EPOLL_EVENTS];
+    int nev;
+
+    while (poll(&ufd, 1, delay) < 0)
+    {
+        if (errno != EINTR)
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+    }
+
+    nev = epoll_wait(host->epfd, ev, ARRAY_SIZE(ev), 0);
+    if (nev < 0)
+        nev = 0;
+
+    canc = vlc_savecancel();
+    vlc_mutex_lock(&host->lock);
+    now = vlc_tick_now();
+
+    /* Only the host thread destroys clients, so that pending events cannot
+     * refer to deleted clients. */
+    bool accept = false;
+
+    for (int i = 0; i < nev; i++) {
+        if (ev[i].data.ptr == NULL)
+            accept = true;
+        else if (ev[i].data.ptr == host) {
+            eventfd_t dummy;
+
+            eventfd_read(host->wakefd, &dummy);
+        } else {
+            cl = ev[i].data.ptr;
+            cl->b_ready = true;
+            httpd_ClientQueue(host, cl);
+        }
+    }
+
+    httpd_HostWakeWaiting(host);
+
+    /* Handle server sockets (accept new connections) */
+    if (accept)
+        for (unsigned i = 0; i < host->nfd; i++)
+            httpd_HostAccept(host, host->fds[i], now);
+#else
     while (poll(ufd, nfd, delay) < 0)
     {
         if (errno != EINTR)
@@ -2017,49 +2543,9 @@ static void httpdLoop(httpd_host_t *host)
         if (ufd[nfd].revents == 0)
             continue;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
-
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
-            continue;
-        }
-
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
-
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
-        }
-
-        cl = httpd_ClientNew(sk);
-
-        if (unlikely(cl == NULL))
-        {
-            vlc_tls_Close(sk);
-            continue;
-        }
-
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
-
-        cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
-        host->client_count++;
-        vlc_list_append(&cl->node, &host->clients);
+        httpd_HostAccept(host, fd, now);
     }
+#endif
 
     vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
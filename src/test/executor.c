@@ -25,6 +25,7 @@
 #undef NDEBUG
 
 #include <assert.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_executor.h>
@@ -271,6 +272,47 @@ static void test_task_chain(void)
         assert(array[i] == 2 * i);
 }
 
+static void RunNothing(void *userdata)
+{
+    atomic_uint *count = userdata;
+    atomic_fetch_add_explicit(count, 1, memory_order_relaxed);
+}
+
+static void test_many_runnables(void)
+{
+    /* Stress the queues with many short tasks, submitted from outside the
+     * executor, with a fraction of them canceled */
+    enum { COUNT = 100000 };
+
+    vlc_executor_t *executor = vlc_executor_New(4);
+    assert(executor);
+
+    struct vlc_runnable *runnables = malloc(COUNT * sizeof(*runnables));
+    assert(runnables);
+
+    atomic_uint count;
+    atomic_init(&count, 0);
+
+    for (int i = 0; i < COUNT; ++i)
+    {
+        runnables[i].run = RunNothing;
+        runnables[i].userdata = &count;
+        vlc_executor_Submit(executor, &runnables[i]);
+    }
+
+    unsigned canceled = 0;
+    for (int i = 0; i < COUNT; i += 2)
+        if (vlc_executor_Cancel(executor, &runnables[i]))
+            ++canceled;
+
+    vlc_executor_WaitIdle(executor);
+
+    assert(canceled + atomic_load(&count) == COUNT);
+
+    vlc_executor_Delete(executor);
+    free(runnables);
+}
+
 int main(void)
 {
     test_single_runnable();
@@ -278,5 +320,6 @@ int main(void)
     test_blocking_delete();
     test_cancel();
     test_task_chain();
+    test_many_runnables();
     return 0;
 }
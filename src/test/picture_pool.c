@@ -108,6 +108,83 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+static void test_large(void)
+{
+    /* More pictures than fit in a single word of the free bitmap */
+    const unsigned count = 150;
+    picture_t *pics[150];
+
+    pool = picture_pool_NewFromFormat(&fmt, count);
+    assert(pool != NULL);
+    assert(picture_pool_GetSize(pool) == count);
+
+    for (unsigned i = 0; i < count; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    picture_Release(pics[100]);
+    pics[100] = picture_pool_Wait(pool);
+    assert(pics[100] != NULL);
+    assert(picture_pool_GetResetWaits(pool) == 0);
+
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(pics[i]);
+
+    picture_pool_Release(pool);
+}
+
+struct wait_test
+{
+    picture_t *pic;
+    unsigned waits;
+};
+
+static void *test_wait_release(void *data)
+{
+    struct wait_test *wt = data;
+
+    /* Only release once the consumer found the pool empty and waits */
+    while ((wt->waits = picture_pool_GetResetWaits(pool)) == 0)
+        (vlc_tick_sleep)(VLC_TICK_FROM_MS(1));
+
+    picture_Release(wt->pic);
+    return NULL;
+}
+
+static void test_wait(void)
+{
+    picture_t *pics[PICTURES];
+    struct wait_test wt;
+    vlc_thread_t th;
+
+    pool = picture_pool_NewFromFormat(&fmt, PICTURES);
+    assert(pool != NULL);
+
+    for (unsigned i = 0; i < PICTURES; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    wt.pic = pics[PICTURES / 2];
+    wt.waits = 0;
+    if (vlc_clone(&th, test_wait_release, &wt))
+        abort();
+
+    /* Blocks on the empty pool until the other thread releases a picture */
+    pics[PICTURES / 2] = picture_pool_Wait(pool);
+    assert(pics[PICTURES / 2] != NULL);
+    vlc_join(th, NULL);
+    assert(wt.waits == 1);
+
+    for (unsigned i = 0; i < PICTURES; i++)
+        picture_Release(pics[i]);
+
+    picture_pool_Release(pool);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -123,6 +200,8 @@ int main(void)
 
     test(false);
     test(true);
+    test_large();
+    test_wait();
 
     return 0;
 }
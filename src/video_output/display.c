@@ -352,6 +352,8 @@ picture_pool_t *vout_GetPool(vout_display_t *vd, unsigned count)
 {
     vout_display_priv_t *osys = container_of(vd, vout_display_priv_t, display);
 
+    if (osys->pool == NULL && vd->ops->pool != NULL)
+        osys->pool = vd->ops->pool(vd, count);
     if (osys->pool == NULL)
         osys->pool = picture_pool_NewFromFormat(&osys->display_fmt, count);
     return osys->pool;
@@ -1262,12 +1262,19 @@ static int PrerenderPicture(vout_thread_sys_t *sys, picture_t *filtered,
 static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
 {
     vout_display_t *vd = sys->display;
+    struct vlc_tracer *tracer = GetTracer(sys);
 
     vout_chrono_Start(&sys->chrono.render);
+    if (tracer != NULL)
+        vlc_tracer_TraceBegin(tracer, "RENDER", sys->str_id, "render");
 
     picture_t *filtered = FilterPictureInteractive(sys);
     if (!filtered)
+    {
+        if (tracer != NULL)
+            vlc_tracer_TraceEnd(tracer, "RENDER", sys->str_id, "render");
         return VLC_EGENERIC;
+    }
 
     vlc_clock_Lock(sys->clock);
     sys->clock_nowait = false;
@@ -1280,6 +1287,8 @@ static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
     if (ret != VLC_SUCCESS)
     {
         vlc_queuedmutex_unlock(&sys->display_lock);
+        if (tracer != NULL)
+            vlc_tracer_TraceEnd(tracer, "RENDER", sys->str_id, "render");
         return ret;
     }
 
@@ -1303,8 +1312,9 @@ static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
         vd->ops->prepare(vd, todisplay, subpic, system_pts);
 
     vout_chrono_Stop(&sys->chrono.render);
+    if (tracer != NULL)
+        vlc_tracer_TraceEnd(tracer, "RENDER", sys->str_id, "render");
 
-    struct vlc_tracer *tracer = GetTracer(sys);
     system_now = vlc_tick_now();
     if (!render_now)
     {
@@ -1368,7 +1378,11 @@ static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
                                              frame_rate, frame_rate_base);
 
     /* Display the direct buffer returned by vout_RenderPicture */
+    if (tracer != NULL)
+        vlc_tracer_TraceBegin(tracer, "RENDER", sys->str_id, "display");
     vout_display_Display(vd, todisplay);
+    if (tracer != NULL)
+        vlc_tracer_TraceEnd(tracer, "RENDER", sys->str_id, "display");
     vlc_queuedmutex_unlock(&sys->display_lock);
 
     picture_Release(todisplay);
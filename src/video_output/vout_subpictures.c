@@ -76,6 +76,16 @@ struct spu_channel {
 typedef struct VLC_VECTOR(struct spu_channel) spu_channel_vector;
 typedef struct VLC_VECTOR(subpicture_t *) spu_prerender_vector;
 #define SPU_CHROMALIST_COUNT 8
+#define SPU_PRERENDER_MAX_WORKERS 4
+
+struct spu_prerender_worker {
+    spu_t *spu;
+    vlc_thread_t thread;
+    filter_t *text;       /**< own text renderer (unused by the first worker) */
+    unsigned text_generation;             /**< generation of the renderer */
+    bool text_failed;     /**< the renderer of that generation failed to load */
+    subpicture_t *processed;          /**< subpicture being prerendered */
+};
 
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all following fields */
@@ -88,6 +98,10 @@ struct spu_private_t {
     vlc_mutex_t textlock;
     filter_t *scale_yuvp;                     /**< scaling module for YUVP */
     filter_t *scale;                    /**< scaling module (all but YUVP) */
+    struct {
+        unsigned long hits;          /**< regions reused already scaled */
+        unsigned long misses;        /**< regions scaled or converted */
+    } cache;                      /**< scaled/converted regions statistics */
     bool force_crop;                     /**< force cropping of subpicture */
     struct {
         int x;
@@ -117,16 +131,19 @@ struct spu_private_t {
     /**/
     struct
     {
-        vlc_thread_t    thread;
+        struct spu_prerender_worker workers[SPU_PRERENDER_MAX_WORKERS];
+        size_t          worker_count;
         vlc_mutex_t     lock;
         vlc_cond_t      cond;
         vlc_cond_t      output_cond;
         spu_prerender_vector vector;
-        subpicture_t   *p_processed;
         video_format_t  fmtsrc;
         video_format_t  fmtdst;
         vlc_fourcc_t    chroma_list[SPU_CHROMALIST_COUNT+1];
+        unsigned        text_generation; /**< bumped to reload the renderers */
         bool            live;
+        unsigned long   late_count;    /**< subpictures not prerendered in time */
+        vlc_tick_t      late_max;      /**< worst delay past the start date */
     } prerender;
 
     /* */
@@ -134,7 +151,7 @@ struct spu_private_t {
     vout_thread_t       *vout;
 };
 
-static void spu_PrerenderSync(spu_private_t *, const subpicture_t *);
+static void spu_PrerenderSync(spu_t *, const subpicture_t *, vlc_tick_t);
 static void spu_PrerenderCancel(spu_private_t *, const subpicture_t *);
 
 static void spu_channel_Init(struct spu_channel *channel, size_t id,
@@ -314,7 +331,11 @@ static filter_t *SpuRenderCreateAndLoadScale(vlc_object_t *object,
     return scale;
 }
 
-static int SpuRenderText(spu_t *spu,
+/**
+ * Renders a text region, with the given text renderer, or with the shared
+ * one if NULL.
+ */
+static int SpuRenderText(spu_t *spu, filter_t *text,
                           subpicture_region_t *region,
                           int i_original_width,
                           int i_original_height,
@@ -323,12 +344,17 @@ static int SpuRenderText(spu_t *spu,
     spu_private_t *sys = spu->p;
     assert(region->fmt.i_chroma == VLC_CODEC_TEXT);
 
-    vlc_mutex_lock(&sys->textlock);
-    filter_t *text = sys->text;
-    if(!text)
+    vlc_mutex_t *lock = NULL;
+    if (text == NULL)
     {
-        vlc_mutex_unlock(&sys->textlock);
-        return VLC_EGENERIC;
+        lock = &sys->textlock;
+        vlc_mutex_lock(lock);
+        text = sys->text;
+        if(!text)
+        {
+            vlc_mutex_unlock(lock);
+            return VLC_EGENERIC;
+        }
     }
 
     // assume rendered text is in sRGB if nothing is set
@@ -350,7 +376,8 @@ static int SpuRenderText(spu_t *spu,
 
     int i_ret = text->ops->render(text, region, region, chroma_list);
 
-    vlc_mutex_unlock(&sys->textlock);
+    if (lock != NULL)
+        vlc_mutex_unlock(lock);
     return i_ret;
 }
 
@@ -810,7 +837,7 @@ static void SpuRenderRegion(spu_t *spu,
     /* Render text region */
     if (region->fmt.i_chroma == VLC_CODEC_TEXT)
     {
-        if(SpuRenderText(spu, region,
+        if(SpuRenderText(spu, NULL, region,
                       i_original_width, i_original_height,
                       chroma_list) != VLC_SUCCESS)
             return;
@@ -981,10 +1008,15 @@ static void SpuRenderRegion(spu_t *spu,
             }
         }
 
+        if (region->p_private)
+            sys->cache.hits++;
+
         /* Scale if needed into cache */
         if (!region->p_private && dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
 
+            sys->cache.misses++;
+
             picture_t *picture = region->p_picture;
             picture_Hold(picture);
 
@@ -1433,7 +1465,7 @@ static void spu_PrerenderWake(spu_private_t *sys,
             break;
     }
 
-    vlc_cond_signal(&sys->prerender.cond);
+    vlc_cond_broadcast(&sys->prerender.cond);
     vlc_mutex_unlock(&sys->prerender.lock);
 }
 
@@ -1445,6 +1477,19 @@ static void spu_PrerenderEnqueue(spu_private_t *sys, subpicture_t *p_subpic)
     vlc_mutex_unlock(&sys->prerender.lock);
 }
 
+/* Tells if a worker is prerendering the subpicture (or any if NULL) */
+static bool spu_PrerenderIsProcessing(spu_private_t *sys,
+                                      const subpicture_t *p_subpic)
+{
+    for (size_t i = 0; i < sys->prerender.worker_count; i++)
+    {
+        const subpicture_t *processed = sys->prerender.workers[i].processed;
+        if (processed != NULL && (p_subpic == NULL || processed == p_subpic))
+            return true;
+    }
+    return false;
+}
+
 static void spu_PrerenderCancel(spu_private_t *sys, const subpicture_t *p_subpic)
 {
     vlc_mutex_lock(&sys->prerender.lock);
@@ -1452,7 +1497,7 @@ static void spu_PrerenderCancel(spu_private_t *sys, const subpicture_t *p_subpic
     vlc_vector_index_of(&sys->prerender.vector, p_subpic, &i_idx);
     if(i_idx >= 0)
         vlc_vector_remove(&sys->prerender.vector, i_idx);
-    else while(sys->prerender.p_processed == p_subpic)
+    else while(spu_PrerenderIsProcessing(sys, p_subpic))
         vlc_cond_wait(&sys->prerender.output_cond, &sys->prerender.lock);
     vlc_mutex_unlock(&sys->prerender.lock);
 }
@@ -1460,26 +1505,45 @@ static void spu_PrerenderCancel(spu_private_t *sys, const subpicture_t *p_subpic
 static void spu_PrerenderPause(spu_private_t *sys)
 {
     vlc_mutex_lock(&sys->prerender.lock);
-    while(sys->prerender.p_processed)
+    while(spu_PrerenderIsProcessing(sys, NULL))
         vlc_cond_wait(&sys->prerender.output_cond, &sys->prerender.lock);
     sys->prerender.chroma_list[0] = 0;
     vlc_mutex_unlock(&sys->prerender.lock);
 }
 
-static void spu_PrerenderSync(spu_private_t *sys, const subpicture_t *p_subpic)
+static void spu_PrerenderSync(spu_t *spu, const subpicture_t *p_subpic,
+                              vlc_tick_t start)
 {
+    spu_private_t *sys = spu->p;
+    bool waited = false;
+
     vlc_mutex_lock(&sys->prerender.lock);
     ssize_t i_idx;
     vlc_vector_index_of(&sys->prerender.vector, p_subpic, &i_idx);
-    while(i_idx >= 0 || sys->prerender.p_processed == p_subpic)
+    while(i_idx >= 0 || spu_PrerenderIsProcessing(sys, p_subpic))
     {
+        waited = true;
         vlc_cond_wait(&sys->prerender.output_cond, &sys->prerender.lock);
         vlc_vector_index_of(&sys->prerender.vector, p_subpic, &i_idx);
     }
+
+    /* Compare the end of the prerendering with the (system) start date */
+    if (waited && start != VLC_TICK_INVALID)
+    {
+        vlc_tick_t late = vlc_tick_now() - start;
+
+        if (late > 0)
+        {
+            sys->prerender.late_count++;
+            if (late > sys->prerender.late_max)
+                sys->prerender.late_max = late;
+        }
+    }
     vlc_mutex_unlock(&sys->prerender.lock);
 }
 
-static void spu_PrerenderText(spu_t *spu, subpicture_t *p_subpic,
+static void spu_PrerenderText(spu_t *spu, filter_t *text,
+                              subpicture_t *p_subpic,
                               video_format_t *fmtsrc, video_format_t *fmtdst,
                               vlc_fourcc_t *chroma_list)
 {
@@ -1509,15 +1573,45 @@ static void spu_PrerenderText(spu_t *spu, subpicture_t *p_subpic,
     {
         if(region->fmt.i_chroma != VLC_CODEC_TEXT)
             continue;
-        SpuRenderText(spu, region,
+        SpuRenderText(spu, text, region,
                       i_original_picture_width, i_original_picture_height,
                       chroma_list);
     }
 }
 
+/* Text renderers are not reentrant: the first worker shares the SPU one,
+ * the others load their own when they first get some work. If that fails,
+ * they share the SPU one until the next generation. */
+static filter_t *spu_PrerenderGetText(struct spu_prerender_worker *worker,
+                                      unsigned generation)
+{
+    spu_private_t *sys = worker->spu->p;
+
+    if (worker == &sys->prerender.workers[0])
+        return NULL;
+
+    if (worker->text_generation != generation)
+    {
+        if (worker->text != NULL)
+        {
+            FilterRelease(worker->text);
+            worker->text = NULL;
+        }
+        worker->text_generation = generation;
+        worker->text_failed = false;
+    }
+    if (worker->text == NULL && !worker->text_failed)
+    {
+        worker->text = SpuRenderCreateAndLoadText(worker->spu);
+        worker->text_failed = worker->text == NULL;
+    }
+    return worker->text; /* falls back to the shared one if NULL */
+}
+
 static void * spu_PrerenderThread(void *priv)
 {
-    spu_t *spu = priv;
+    struct spu_prerender_worker *worker = priv;
+    spu_t *spu = worker->spu;
     spu_private_t *sys = spu->p;
     vlc_fourcc_t chroma_list[SPU_CHROMALIST_COUNT+1];
 
@@ -1537,35 +1631,41 @@ static void * spu_PrerenderThread(void *priv)
             continue;
         }
 
+        /* Each subpicture goes to a single worker, the earliest first */
         size_t i_idx = 0;
-        sys->prerender.p_processed = sys->prerender.vector.data[0];
+        subpicture_t *subpic = sys->prerender.vector.data[0];
         for(size_t i=1; i<sys->prerender.vector.size; i++)
         {
-             if(sys->prerender.p_processed->i_start > sys->prerender.vector.data[i]->i_start)
+             if(subpic->i_start > sys->prerender.vector.data[i]->i_start)
              {
-                 sys->prerender.p_processed = sys->prerender.vector.data[i];
+                 subpic = sys->prerender.vector.data[i];
                  i_idx = i;
              }
         }
         vlc_vector_remove(&sys->prerender.vector, i_idx);
+        worker->processed = subpic;
         memcpy(chroma_list, sys->prerender.chroma_list, SPU_CHROMALIST_COUNT);
         video_format_Copy(&fmtdst, &sys->prerender.fmtdst);
         video_format_Copy(&fmtsrc, &sys->prerender.fmtsrc);
+        unsigned generation = sys->prerender.text_generation;
 
         vlc_mutex_unlock(&sys->prerender.lock);
 
-        spu_PrerenderText(spu, sys->prerender.p_processed,
-                          &fmtsrc, &fmtdst, chroma_list);
+        filter_t *text = spu_PrerenderGetText(worker, generation);
+        spu_PrerenderText(spu, text, subpic, &fmtsrc, &fmtdst, chroma_list);
 
         video_format_Clean(&fmtdst);
         video_format_Clean(&fmtsrc);
 
         vlc_mutex_lock(&sys->prerender.lock);
-        sys->prerender.p_processed = NULL;
-        vlc_cond_signal(&sys->prerender.output_cond);
+        worker->processed = NULL;
+        vlc_cond_broadcast(&sys->prerender.output_cond);
     }
 
     vlc_mutex_unlock(&sys->prerender.lock);
+
+    if (worker->text != NULL)
+        FilterRelease(worker->text);
     return NULL;
 }
 
@@ -1577,6 +1677,11 @@ static void spu_Cleanup(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    msg_Dbg(spu, "scaled regions cache: %lu hits, %lu misses",
+            sys->cache.hits, sys->cache.misses);
+    msg_Dbg(spu, "%lu subpictures prerendered late (at most %"PRId64" ms)",
+            sys->prerender.late_count, MS_FROM_VLC_TICK(sys->prerender.late_max));
+
     if (sys->text)
         FilterRelease(sys->text);
 
@@ -1622,9 +1727,10 @@ void spu_Destroy(spu_t *spu)
     /* stop prerendering */
     vlc_mutex_lock(&sys->prerender.lock);
     sys->prerender.live = false;
-    vlc_cond_signal(&sys->prerender.cond);
+    vlc_cond_broadcast(&sys->prerender.cond);
     vlc_mutex_unlock(&sys->prerender.lock);
-    vlc_join(sys->prerender.thread, NULL);
+    for (size_t i = 0; i < sys->prerender.worker_count; i++)
+        vlc_join(sys->prerender.workers[i].thread, NULL);
     /* delete filters and free resources */
     spu_Cleanup(spu);
     vlc_object_delete(spu);
@@ -1662,6 +1768,8 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
 
     /* Initialize private fields */
     vlc_mutex_init(&sys->lock);
+    sys->cache.hits = 0;
+    sys->cache.misses = 0;
 
     sys->margin = var_InheritInteger(spu, "sub-margin");
     sys->secondary_margin = var_InheritInteger(spu, "secondary-sub-margin");
@@ -1681,7 +1789,10 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
     vlc_vector_init(&sys->prerender.vector);
     video_format_Init(&sys->prerender.fmtdst, 0);
     video_format_Init(&sys->prerender.fmtsrc, 0);
-    sys->prerender.p_processed = NULL;
+    sys->prerender.worker_count = 0;
+    sys->prerender.text_generation = 0;
+    sys->prerender.late_count = 0;
+    sys->prerender.late_max = 0;
     sys->prerender.chroma_list[0] = 0;
     sys->prerender.chroma_list[SPU_CHROMALIST_COUNT] = 0;
     sys->prerender.live = true;
@@ -1713,7 +1824,26 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
     sys->last_sort_date = -1;
     sys->vout = vout;
 
-    if(vlc_clone(&sys->prerender.thread, spu_PrerenderThread, spu))
+    /* Several subtitle tracks, karaoke and OSD may need prerendering at the
+     * same time: spread them on a few workers, leaving a CPU to the rest of
+     * the pipeline (each worker but the first loads its own text renderer) */
+    unsigned cpus = vlc_GetCPUCount();
+    size_t workers = __MIN(__MAX(cpus, 2) - 1, SPU_PRERENDER_MAX_WORKERS);
+    for (size_t i = 0; i < workers; i++)
+    {
+        struct spu_prerender_worker *worker = &sys->prerender.workers[i];
+
+        worker->spu = spu;
+        worker->text = NULL;
+        worker->text_generation = 0;
+        worker->text_failed = false;
+        worker->processed = NULL;
+        if (vlc_clone(&worker->thread, spu_PrerenderThread, worker))
+            break;
+        sys->prerender.worker_count++;
+    }
+
+    if (sys->prerender.worker_count == 0)
     {
         spu_Cleanup(spu);
         vlc_object_delete(spu);
@@ -1739,6 +1869,11 @@ void spu_Attach(spu_t *spu, input_thread_t *input)
             FilterRelease(spu->p->text);
         spu->p->text = SpuRenderCreateAndLoadText(spu);
         vlc_mutex_unlock(&spu->p->textlock);
+
+        /* The renderers of the other workers load the new attachments too */
+        vlc_mutex_lock(&spu->p->prerender.lock);
+        spu->p->prerender.text_generation++;
+        vlc_mutex_unlock(&spu->p->prerender.lock);
     }
     vlc_mutex_unlock(&spu->p->lock);
 }
@@ -1973,7 +2108,7 @@ subpicture_t *spu_Render(spu_t *spu,
         spu_render_entry_t *entry = &subpicture_array[i];
         subpicture_t *subpic = entry->subpic;
 
-        spu_PrerenderSync(sys, entry->subpic);
+        spu_PrerenderSync(spu, entry->subpic, entry->start);
 
         /* Update time to clock */
         entry->subpic->i_start = entry->start;
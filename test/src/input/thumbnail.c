@@ -27,8 +27,12 @@
 #include <vlc_picture.h>
 
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define MOCK_DURATION VLC_TICK_FROM_SEC( 5 * 60 )
+/* Duration of a frame of the mock video track (at its default 25 fps) */
+#define MOCK_FRAME_DURATION VLC_TICK_FROM_MS( 40 )
 
 const struct
 {
@@ -164,6 +168,116 @@ static void test_thumbnails( libvlc_instance_t* p_vlc )
     vlc_thumbnailer_Release( p_thumbnailer );
 }
 
+struct test_batch_ctx
+{
+    vlc_cond_t cond;
+    vlc_mutex_t lock;
+    const vlc_tick_t *times;
+    size_t count;
+    size_t received;
+};
+
+/* Counts the inputs opening the mock item */
+static void count_inputs_cb( void *data, int level, const libvlc_log_t *ctx,
+                             const char *fmt, va_list ap )
+{
+    atomic_uint *p_count = data;
+    char msg[64];
+
+    (void) level; (void) ctx;
+    vsnprintf( msg, sizeof (msg), fmt, ap );
+    if ( !strcmp( msg, "using access module \"mock\"" ) )
+        atomic_fetch_add( p_count, 1 );
+}
+
+static void thumbnailer_batch_callback( void* data, size_t index,
+                                        picture_t* thumbnail )
+{
+    struct test_batch_ctx* p_ctx = data;
+    vlc_mutex_lock( &p_ctx->lock );
+
+    assert( index == p_ctx->received && "Unexpected thumbnail order" );
+    assert( thumbnail != NULL && "Expected a thumbnail but got a failure" );
+    assert( thumbnail->format.i_chroma == VLC_CODEC_ARGB );
+    assert( llabs( thumbnail->date - p_ctx->times[index] ) < MOCK_FRAME_DURATION
+            && "Unexpected picture date" );
+
+    p_ctx->received++;
+    vlc_cond_signal( &p_ctx->cond );
+    vlc_mutex_unlock( &p_ctx->lock );
+}
+
+static void test_batch_thumbnails( libvlc_instance_t* p_vlc )
+{
+    static const vlc_tick_t times[] = {
+        VLC_TICK_FROM_SEC( 10 ), VLC_TICK_FROM_SEC( 120 ),
+        VLC_TICK_FROM_SEC( 60 ), VLC_TICK_FROM_SEC( 240 ),
+    };
+    vlc_tick_t interval_times[5];
+
+    for ( size_t i = 0; i < ARRAY_SIZE(interval_times); ++i )
+        interval_times[i] = VLC_TICK_FROM_SEC( 15 ) + i * VLC_TICK_FROM_SEC( 50 );
+
+    atomic_uint inputs = 0;
+    libvlc_log_set( p_vlc, count_inputs_cb, &inputs );
+
+    vlc_thumbnailer_t* p_thumbnailer = vlc_thumbnailer_CreateWithThreads(
+                VLC_OBJECT( p_vlc->p_libvlc_int ), 2 );
+    assert( p_thumbnailer != NULL );
+
+    char* psz_mrl;
+    if ( asprintf( &psz_mrl, "mock://video_track_count=1;audio_track_count=1"
+                   ";length=%" PRId64 ";can_control_pace=true;video_chroma=ARGB",
+                   MOCK_DURATION ) < 0 )
+        assert( !"Failed to allocate mock mrl" );
+    input_item_t* p_item = input_item_New( psz_mrl, "mock item" );
+    assert( p_item != NULL );
+
+    struct test_batch_ctx ctx[2];
+    vlc_thumbnailer_request_t* p_req[2];
+
+    for ( size_t i = 0; i < ARRAY_SIZE(ctx); ++i )
+    {
+        vlc_cond_init( &ctx[i].cond );
+        vlc_mutex_init( &ctx[i].lock );
+        ctx[i].received = 0;
+    }
+
+    /* Both requests run concurrently, on the same item */
+    ctx[0].times = times;
+    ctx[0].count = ARRAY_SIZE(times);
+    p_req[0] = vlc_thumbnailer_RequestBatch( p_thumbnailer, times,
+        ARRAY_SIZE(times), VLC_THUMBNAILER_SEEK_FAST, p_item,
+        VLC_TICK_FROM_SEC( 1 ), thumbnailer_batch_callback, &ctx[0] );
+    assert( p_req[0] != NULL );
+
+    ctx[1].times = interval_times;
+    ctx[1].count = ARRAY_SIZE(interval_times);
+    p_req[1] = vlc_thumbnailer_RequestByInterval( p_thumbnailer,
+        interval_times[0], VLC_TICK_FROM_SEC( 50 ), ctx[1].count,
+        VLC_THUMBNAILER_SEEK_PRECISE, p_item, VLC_TICK_FROM_SEC( 1 ),
+        thumbnailer_batch_callback, &ctx[1] );
+    assert( p_req[1] != NULL );
+
+    for ( size_t i = 0; i < ARRAY_SIZE(ctx); ++i )
+    {
+        vlc_mutex_lock( &ctx[i].lock );
+        while ( ctx[i].received < ctx[i].count )
+            vlc_cond_wait( &ctx[i].cond, &ctx[i].lock );
+        vlc_mutex_unlock( &ctx[i].lock );
+
+        vlc_thumbnailer_DestroyRequest( p_thumbnailer, p_req[i] );
+    }
+
+    libvlc_log_unset( p_vlc );
+    /* Each request opened the item once, and seeked it to every time */
+    assert( atomic_load( &inputs ) == ARRAY_SIZE(ctx) );
+
+    input_item_Release( p_item );
+    free( psz_mrl );
+    vlc_thumbnailer_Release( p_thumbnailer );
+}
+
 static void thumbnailer_callback_cancel( void* data, picture_t* p_thumbnail )
 {
     (void) data; (void) p_thumbnail;
@@ -211,6 +325,7 @@ int main()
     assert(vlc);
 
     test_thumbnails( vlc );
+    test_batch_thumbnails( vlc );
     test_cancel_thumbnail( vlc );
 
     libvlc_release( vlc );
@@ -21,6 +21,7 @@
  *****************************************************************************/
 
 #include <limits.h>
+#include <stdatomic.h>
 
 #include "../../libvlc/test.h"
 #include "../lib/libvlc_internal.h"
@@ -444,6 +445,81 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOENT );
 }
 
+#define CONCURRENT_READERS 4
+#define CONCURRENT_VARS    100
+#define CONCURRENT_ROUNDS  200
+
+struct concurrent_ctx
+{
+    libvlc_int_t *p_libvlc;
+    atomic_bool done;
+};
+
+static void *concurrent_reader( void *data )
+{
+    struct concurrent_ctx *ctx = data;
+    char name[16];
+
+    while( !atomic_load( &ctx->done ) )
+    {
+        /* Always present: written concurrently, but never out of range */
+        int64_t stable = var_GetInteger( ctx->p_libvlc, "stable" );
+        assert( stable >= 0 && stable < CONCURRENT_ROUNDS );
+
+        /* Created and destroyed concurrently: either absent (0) or valid */
+        for( unsigned i = 0; i < CONCURRENT_VARS; i++ )
+        {
+            snprintf( name, sizeof (name), "churn-%u", i );
+            int64_t v = var_GetInteger( ctx->p_libvlc, name );
+            assert( v == 0 || v == i + 1 );
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent( libvlc_int_t *p_libvlc )
+{
+    struct concurrent_ctx ctx = { .p_libvlc = p_libvlc };
+    vlc_thread_t readers[CONCURRENT_READERS];
+    char name[16];
+
+    atomic_init( &ctx.done, false );
+    var_Create( p_libvlc, "stable", VLC_VAR_INTEGER );
+
+    for( unsigned i = 0; i < CONCURRENT_READERS; i++ )
+    {
+        int ret = vlc_clone( &readers[i], concurrent_reader, &ctx );
+        assert( ret == 0 );
+        (void) ret;
+    }
+
+    /* Grow the hash table and destroy variables while readers look them up
+     * without the lock. */
+    for( unsigned round = 0; round < CONCURRENT_ROUNDS; round++ )
+    {
+        var_SetInteger( p_libvlc, "stable", round );
+
+        for( unsigned i = 0; i < CONCURRENT_VARS; i++ )
+        {
+            snprintf( name, sizeof (name), "churn-%u", i );
+            var_Create( p_libvlc, name, VLC_VAR_INTEGER );
+            var_SetInteger( p_libvlc, name, i + 1 );
+        }
+
+        for( unsigned i = 0; i < CONCURRENT_VARS; i++ )
+        {
+            snprintf( name, sizeof (name), "churn-%u", i );
+            var_Destroy( p_libvlc, name );
+        }
+    }
+
+    atomic_store( &ctx.done, true );
+    for( unsigned i = 0; i < CONCURRENT_READERS; i++ )
+        vlc_join( readers[i], NULL );
+
+    var_Destroy( p_libvlc, "stable" );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -481,6 +557,9 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     test_log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    test_log( "Testing concurrent lock-less reads\n" );
+    test_concurrent( p_libvlc );
 }
 
 
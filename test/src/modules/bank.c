@@ -0,0 +1,210 @@
+/*****************************************************************************
+ * bank.c: test and benchmark for the module bank start-up
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <inttypes.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../../libvlc/test.h"
+#include <vlc_modules.h>
+#include <vlc_plugin.h>
+
+#define ITERATIONS 3
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * UINT64_C(0x100000001b3);
+    return h;
+}
+
+static uint64_t hash_string(uint64_t h, const char *str)
+{
+    if (str == NULL)
+        return hash_bytes(h, "", 1);
+    return hash_bytes(h, str, strlen(str) + 1);
+}
+
+/* Digests everything the module bank exposes, configuration included,
+ * regardless of the order of the modules */
+static uint64_t hash_bank(void)
+{
+    uint64_t digest = 0;
+    size_t count;
+    module_t **list = module_list_get(&count);
+
+    assert(list != NULL);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const module_t *module = list[i];
+        uint64_t h = UINT64_C(0xcbf29ce484222325);
+        int score = module_get_score(module);
+        unsigned confsize;
+
+        h = hash_string(h, module_get_object(module));
+        h = hash_string(h, module_get_name(module, true));
+        h = hash_string(h, module_get_capability(module));
+        h = hash_bytes(h, &score, sizeof (score));
+
+        module_config_t *config = module_config_get(module, &confsize);
+
+        for (unsigned j = 0; j < confsize; j++)
+        {
+            const module_config_t *item = &config[j];
+
+            h = hash_bytes(h, &item->i_type, sizeof (item->i_type));
+            h = hash_string(h, item->psz_name);
+            h = hash_string(h, item->psz_text);
+            h = hash_string(h, item->psz_longtext);
+
+            if (IsConfigStringType(item->i_type))
+            {
+                h = hash_string(h, item->orig.psz);
+                for (unsigned k = 0; k < item->list_count; k++)
+                    h = hash_string(h, item->list.psz[k]);
+            }
+            else if (IsConfigFloatType(item->i_type))
+            {
+                h = hash_bytes(h, &item->orig.f, sizeof (item->orig.f));
+                h = hash_bytes(h, &item->min.f, sizeof (item->min.f));
+                h = hash_bytes(h, &item->max.f, sizeof (item->max.f));
+            }
+            else if (IsConfigIntegerType(item->i_type))
+            {
+                h = hash_bytes(h, &item->orig.i, sizeof (item->orig.i));
+                h = hash_bytes(h, &item->min.i, sizeof (item->min.i));
+                h = hash_bytes(h, &item->max.i, sizeof (item->max.i));
+                for (unsigned k = 0; k < item->list_count; k++)
+                    h = hash_bytes(h, &item->list.i[k], sizeof (int));
+            }
+
+            if (CONFIG_ITEM(item->i_type))
+                for (unsigned k = 0; k < item->list_count; k++)
+                    h = hash_string(h, item->list_text[k]);
+        }
+        module_config_free(config);
+        digest += h;
+    }
+    module_list_free(list);
+    return digest;
+}
+
+static uint64_t hash_instance(int argc, const char *const *argv)
+{
+    libvlc_instance_t *vlc = libvlc_new(argc, argv);
+    assert(vlc != NULL);
+
+    uint64_t h = hash_bank();
+
+    libvlc_release(vlc);
+    return h;
+}
+
+static uint64_t test_bank(bool cache)
+{
+    const char *argv[test_defaults_nargs + 1];
+    int argc = test_defaults_nargs;
+    vlc_tick_t best = VLC_TICK_MAX;
+
+    memcpy(argv, test_defaults_args, sizeof (test_defaults_args));
+    if (!cache)
+        argv[argc++] = "--no-plugins-cache";
+
+    /* The bank is loaded by the first instance and unloaded with the last */
+    for (unsigned i = 0; i < ITERATIONS; i++)
+    {
+        vlc_tick_t start = vlc_tick_now();
+        libvlc_instance_t *vlc = libvlc_new(argc, argv);
+        vlc_tick_t elapsed = vlc_tick_now() - start;
+
+        assert(vlc != NULL);
+        libvlc_release(vlc);
+
+        if (elapsed < best)
+            best = elapsed;
+    }
+
+    test_log("start-up %s plugins cache: %"PRId64" us\n",
+             cache ? "with" : "without", US_FROM_VLC_TICK(best));
+
+    return hash_instance(argc, argv);
+}
+
+/* Generates a plugins cache, then checks that it is really used */
+static uint64_t test_cache(void)
+{
+    const char *argv[test_defaults_nargs + 1];
+    int argc = test_defaults_nargs;
+
+    memcpy(argv, test_defaults_args, sizeof (test_defaults_args));
+    argv[argc++] = "--reset-plugins-cache";
+
+    uint64_t written = hash_instance(argc, argv);
+
+    /* Without scanning, plug-ins can only come from the cache */
+    argv[argc - 1] = "--no-plugins-scan";
+
+    uint64_t loaded = hash_instance(argc, argv);
+
+    assert(written == loaded);
+    return loaded;
+}
+
+int main(void)
+{
+    test_init();
+
+    /* The build tree has no plugins cache, and may not be writable: use a
+     * temporary plug-ins path pointing to the build tree plug-ins. */
+    char template[] = "/tmp/vlc.test.bank.XXXXXX";
+    const char *tempdir = mkdtemp(template);
+    assert(tempdir != NULL);
+
+    char target[PATH_MAX], link[PATH_MAX], cache[PATH_MAX];
+    const char *modules = getenv("VLC_PLUGIN_PATH");
+
+    assert(realpath(modules, target) != NULL);
+    snprintf(link, sizeof (link), "%s/modules", tempdir);
+    snprintf(cache, sizeof (cache), "%s/plugins.dat", tempdir);
+    assert(symlink(target, link) == 0);
+    setenv("VLC_PLUGIN_PATH", tempdir, 1);
+
+    uint64_t scanned = test_bank(false);
+    uint64_t loaded = test_cache();
+    struct stat st;
+
+    assert(stat(cache, &st) == 0);
+
+    uint64_t cached = test_bank(true);
+
+    /* The cache must describe the plug-ins exactly as they describe
+     * themselves. */
+    assert(scanned == loaded);
+    assert(scanned == cached);
+
+    unlink(cache);
+    unlink(link);
+    rmdir(tempdir);
+    return 0;
+}